@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+** Compares hash_t with the fixed-size chained table it replaced. Keys
+** are "alias_N" strings, and both tables start at order 5, like the
+** alias table. "add" includes the cost of growing the table.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "bench.h"
+
+struct ent {
+	char *name;
+};
+
+/*
+** The old table: 2^order buckets that never grow, each a chain of
+** malloc'd nodes, indexed by the old shift-subtract string hash.
+*/
+
+struct old_node {
+	struct old_node *next;
+	struct old_node *prev;
+	void *data;
+};
+
+struct old_hash {
+	uint32_t order;
+	struct old_node **map;
+};
+
+static uint32_t old_string_hash(const char *str, uint32_t order) {
+	uint32_t hash = 0;
+
+	while (*str != '\0')
+		hash = (hash << 5) - hash + *str++;
+
+	return (hash & ((1 << order) - 1));
+}
+
+static int ent_compare(void *l, void *r) {
+	return (strcmp(l, ((struct ent *) r)->name));
+}
+
+static void old_hash_init(struct old_hash *hash, uint32_t order) {
+	hash->order = order;
+	hash->map = xcalloc((uint32_t) (1 << order), sizeof(*hash->map));
+}
+
+static struct old_node *old_hash_find(struct old_hash *hash, char *key) {
+	struct old_node *cur;
+
+	cur = hash->map[old_string_hash(key, hash->order)];
+	while (cur != NULL && ent_compare(key, cur->data))
+		cur = cur->next;
+
+	return (cur);
+}
+
+static void old_hash_add(struct old_hash *hash, struct ent *ent) {
+	uint32_t bucket = old_string_hash(ent->name, hash->order);
+	struct old_node *node = xmalloc(sizeof(*node));
+
+	node->data = ent;
+	node->prev = NULL;
+	node->next = hash->map[bucket];
+	if (node->next != NULL)
+		node->next->prev = node;
+
+	hash->map[bucket] = node;
+}
+
+static int old_hash_remove(struct old_hash *hash, char *key) {
+	struct old_node *node = old_hash_find(hash, key);
+
+	if (node == NULL)
+		return (-1);
+
+	if (node->prev != NULL)
+		node->prev->next = node->next;
+	else
+		hash->map[old_string_hash(key, hash->order)] = node->next;
+
+	if (node->next != NULL)
+		node->next->prev = node->prev;
+
+	free(node);
+	return (0);
+}
+
+static void old_hash_destroy(struct old_hash *hash) {
+	free(hash->map);
+}
+
+/*
+** "res" gets ns per add, hit, miss and remove. The second half of
+** "ents" is never added, and is used for the misses.
+*/
+
+static void bench_old(struct ent *ents, int n, int rounds, double *res) {
+	struct old_hash hash;
+	long found = 0;
+	double t;
+	int i, r;
+
+	old_hash_init(&hash, 5);
+
+	t = bench_now();
+	for (i = 0 ; i < n ; i++)
+		old_hash_add(&hash, &ents[i]);
+	res[0] = (bench_now() - t) / n;
+
+	t = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			found += old_hash_find(&hash, ents[i].name) != NULL;
+	}
+	res[1] = (bench_now() - t) / ((double) n * rounds);
+
+	t = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			found += old_hash_find(&hash, ents[n + i].name) != NULL;
+	}
+	res[2] = (bench_now() - t) / ((double) n * rounds);
+
+	t = bench_now();
+	for (i = 0 ; i < n ; i++)
+		old_hash_remove(&hash, ents[i].name);
+	res[3] = (bench_now() - t) / n;
+
+	if (found != (long) n * rounds)
+		printf("old: found %ld entries, expected %ld\n", found, (long) n * rounds);
+
+	old_hash_destroy(&hash);
+}
+
+static void bench_new(struct ent *ents, int n, int rounds, double *res) {
+	hash_t hash;
+	long found = 0;
+	double t;
+	int i, r;
+
+	memset(&hash, 0, sizeof(hash));
+	hash_init(&hash, 5, string_hash, ent_compare, NULL);
+
+	t = bench_now();
+	for (i = 0 ; i < n ; i++)
+		hash_add(&hash, ents[i].name, &ents[i]);
+	res[0] = (bench_now() - t) / n;
+
+	t = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			found += hash_find(&hash, ents[i].name) != NULL;
+	}
+	res[1] = (bench_now() - t) / ((double) n * rounds);
+
+	t = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			found += hash_find(&hash, ents[n + i].name) != NULL;
+	}
+	res[2] = (bench_now() - t) / ((double) n * rounds);
+
+	t = bench_now();
+	for (i = 0 ; i < n ; i++) {
+		if (hash_remove(&hash, ents[i].name) != 0)
+			printf("new: couldn't remove %s\n", ents[i].name);
+	}
+	res[3] = (bench_now() - t) / n;
+
+	if (found != (long) n * rounds || hash.used != 0)
+		printf("new: found %ld entries, expected %ld\n", found, (long) n * rounds);
+
+	hash_destroy(&hash);
+}
+
+int main(void) {
+	static const int sizes[] = { 32, 256, 4096, 65536 };
+	size_t s;
+
+	printf("%8s  %-4s %9s %9s %9s %9s   (ns/op)\n",
+		"entries", "impl", "add", "hit", "miss", "remove");
+
+	for (s = 0 ; s < array_elem(sizes) ; s++) {
+		int n = sizes[s];
+		int rounds = max((1 << 22) / n, 4);
+		struct ent *ents = xmalloc(sizeof(*ents) * 2 * n);
+		double old_res[4];
+		double new_res[4];
+		int i;
+
+		for (i = 0 ; i < 2 * n ; i++) {
+			char buf[32];
+
+			snprintf(buf, sizeof(buf), "alias_%d", i * 7919);
+			ents[i].name = xstrdup(buf);
+		}
+
+		/* The old table's chains get long enough that one round will do. */
+		bench_old(ents, n, (n > 4096 ? 1 : rounds), old_res);
+		bench_new(ents, n, rounds, new_res);
+
+		printf("%8d  %-4s %9.1f %9.1f %9.1f %9.1f\n", n, "old",
+			old_res[0], old_res[1], old_res[2], old_res[3]);
+		printf("%8d  %-4s %9.1f %9.1f %9.1f %9.1f\n", n, "new",
+			new_res[0], new_res[1], new_res[2], new_res[3]);
+
+		for (i = 0 ; i < 2 * n ; i++)
+			free(ents[i].name);
+		free(ents);
+	}
+
+	return (0);
+}
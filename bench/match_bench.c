@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+** Times /lastlog pattern matching over a buffer of 1M chat lines of
+** about 100 characters, without the trigram index in front of it:
+**
+** - "regexec": the pattern compiled with regcomp() and run with
+**   regexec(), as every pattern was before.
+** - "literal": match_exec(), which matches plain words with strstr(),
+**   folding each line to lower case on the fly for -i.
+** - "shadow": strstr() over a copy of the buffer folded to lower case
+**   ahead of time, for comparison with keeping one per message.
+**
+** All three must find the same number of lines. Exits with 1 if they
+** don't.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_match.h"
+#include "bench.h"
+
+#define NUM_LINES		1000000
+#define LINE_LEN		100
+
+static const char *words[] = {
+	"the", "a", "to", "and", "of", "is", "it", "in", "that", "you", "for",
+	"on", "with", "was", "just", "but", "have", "not", "what", "this",
+	"window", "Window", "channel", "CHANNEL", "server", "Server", "fox",
+	"quick", "brown", "lazy", "dog", "client", "build", "patch", "log",
+	"scroll", "buffer", "search", "lol", "yeah", "ok", "hmm", "anyone",
+	"know", "why", "does", "my", "connection", "keep", "dropping",
+};
+
+static const char *nicks[] = {
+	"devin", "ryan", "alice", "bob", "carol", "dave", "erin", "frank",
+};
+
+static char *make_line(void) {
+	char *line = xmalloc(LINE_LEN + 64);
+	int len;
+
+	len = snprintf(line, LINE_LEN + 64, "[%02d:%02d] <%s> ",
+		rand() % 24, rand() % 60, nicks[rand() % array_elem(nicks)]);
+
+	while (len < LINE_LEN) {
+		len += snprintf(line + len, LINE_LEN + 64 - len, "%s ",
+			words[rand() % array_elem(words)]);
+	}
+
+	line[len - 1] = '\0';
+	return (line);
+}
+
+static char *fold_line(const char *line) {
+	char *folded = xstrdup(line);
+	char *p;
+
+	for (p = folded ; *p != '\0' ; p++) {
+		if (*p >= 'A' && *p <= 'Z')
+			*p += 'a' - 'A';
+	}
+
+	return (folded);
+}
+
+static int run(char **lines, char **folded, const char *pattern, int icase) {
+	struct match match;
+	regex_t preg;
+	size_t found[3] = { 0, 0, 0 };
+	char label[64];
+	double t[4];
+	size_t i;
+
+	if (regcomp(&preg, pattern, REG_EXTENDED | (icase ? REG_ICASE : 0)) != 0 ||
+		match_compile(&match, pattern, (icase ? MATCH_ICASE : 0)) != 0 ||
+		match.literal == NULL)
+	{
+		printf("can't compile \"%s\" as a plain word\n", pattern);
+		return (-1);
+	}
+
+	t[0] = bench_now();
+	for (i = 0 ; i < NUM_LINES ; i++)
+		found[0] += (regexec(&preg, lines[i], 0, NULL, 0) == 0);
+
+	t[1] = bench_now();
+	for (i = 0 ; i < NUM_LINES ; i++)
+		found[1] += match_exec(&match, lines[i], NULL, NULL);
+
+	t[2] = bench_now();
+	if (icase) {
+		for (i = 0 ; i < NUM_LINES ; i++)
+			found[2] += (strstr(folded[i], match.literal) != NULL);
+	} else
+		found[2] = found[1];
+	t[3] = bench_now();
+
+	snprintf(label, sizeof(label), "%s%s", pattern, (icase ? " -i" : ""));
+	printf("  %-14s %8.0f ms %8.0f ms", label, (t[1] - t[0]) / 1e6,
+		(t[2] - t[1]) / 1e6);
+	if (icase)
+		printf(" %8.0f ms", (t[3] - t[2]) / 1e6);
+	printf("   (%zu lines)\n", found[0]);
+
+	regfree(&preg);
+	match_free(&match);
+
+	if (found[0] != found[1] || found[1] != found[2]) {
+		printf("  mismatch: regexec %zu, literal %zu, shadow %zu\n",
+			found[0], found[1], found[2]);
+		return (-1);
+	}
+
+	return (0);
+}
+
+int main(void) {
+	static const char *patterns[] = { "channel", "window fox", "Server" };
+	char **lines = xmalloc(NUM_LINES * sizeof(*lines));
+	char **folded = xmalloc(NUM_LINES * sizeof(*folded));
+	int bad = 0;
+	size_t i;
+
+	srand(1);
+	for (i = 0 ; i < NUM_LINES ; i++) {
+		lines[i] = make_line();
+		folded[i] = fold_line(lines[i]);
+	}
+
+	printf("  %-14s %11s %11s %11s\n", "pattern", "regexec", "literal",
+		"shadow");
+
+	for (i = 0 ; i < array_elem(patterns) ; i++) {
+		bad |= run(lines, folded, patterns[i], 0);
+		bad |= run(lines, folded, patterns[i], 1);
+	}
+
+	for (i = 0 ; i < NUM_LINES ; i++) {
+		free(lines[i]);
+		free(folded[i]);
+	}
+
+	free(lines);
+	free(folded);
+
+	return (bad != 0);
+}
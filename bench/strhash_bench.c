@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+** Checks and timings for string_hash() and string_hash_nocase(),
+** against the shift-subtract hash they replaced:
+**
+** - string_hash_nocase() gives the same value for a string in upper,
+**   lower and mixed case, for every length up to several words and at
+**   every alignment, so every tail length is covered. Bytes outside
+**   A-Z and a-z must not be folded.
+** - Full 32-bit collisions and bucket spread over 1M keys.
+** - Throughput for a few key lengths.
+**
+** Exits with 1 if a check fails.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "bench.h"
+
+#define NUM_KEYS		1000000
+#define MAX_CHECK_LEN	40
+
+static uint32_t old_string_hash(const void *key) {
+	const char *str = key;
+	uint32_t hash = 0;
+
+	while (*str != '\0')
+		hash = (hash << 5) - hash + *str++;
+
+	return (hash);
+}
+
+/* ASCII only, like strcasecmp() in the C locale. */
+static void ascii_case(char *dst, const char *src, size_t len, int upper) {
+	size_t i;
+
+	for (i = 0 ; i < len ; i++) {
+		char c = src[i];
+
+		if (upper && c >= 'a' && c <= 'z')
+			c -= 'a' - 'A';
+		else if (!upper && c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+
+		dst[i] = c;
+	}
+}
+
+static int check_nocase(void) {
+	char buf[4][MAX_CHECK_LEN + 16];
+	int bad = 0;
+	size_t len;
+
+	srand(1);
+
+	for (len = 0 ; len <= MAX_CHECK_LEN ; len++) {
+		size_t align;
+
+		for (align = 0 ; align < 8 ; align++) {
+			char *orig = &buf[0][align];
+			char *upper = &buf[1][align];
+			char *lower = &buf[2][align];
+			char *mixed = &buf[3][align];
+			int trial;
+
+			for (trial = 0 ; trial < 1000 ; trial++) {
+				uint32_t hash;
+				size_t i;
+
+				/* Every byte but NUL, weighted towards letters. */
+				for (i = 0 ; i < len ; i++) {
+					if (rand() & 1)
+						orig[i] = 'A' + rand() % 26 + (rand() & 1 ? 32 : 0);
+					else
+						orig[i] = 1 + rand() % 255;
+				}
+
+				ascii_case(upper, orig, len, 1);
+				ascii_case(lower, orig, len, 0);
+				for (i = 0 ; i < len ; i++)
+					mixed[i] = (rand() & 1 ? upper[i] : lower[i]);
+
+				orig[len] = upper[len] = lower[len] = mixed[len] = '\0';
+
+				hash = string_hash_nocase(orig);
+				if (string_hash_nocase(upper) != hash ||
+					string_hash_nocase(lower) != hash ||
+					string_hash_nocase(mixed) != hash ||
+					mem_hash_nocase(orig, len) != hash ||
+					strcasecmp(orig, mixed) != 0)
+				{
+					if (bad++ < 10)
+						printf("  mismatch: len %zu, align %zu\n", len, align);
+				}
+			}
+		}
+	}
+
+	printf("nocase: %d mismatches over lengths 0-%d at 8 alignments\n",
+		bad, MAX_CHECK_LEN);
+
+	/* The neighbours of A-Z and a-z, and high bytes, stay as they are. */
+	if (string_hash_nocase("@") == string_hash_nocase("`") ||
+		string_hash_nocase("[") == string_hash_nocase("{") ||
+		string_hash_nocase("xxxxxxx\xc9") == string_hash_nocase("xxxxxxx\xe9"))
+	{
+		printf("nocase: folds bytes outside A-Z\n");
+		bad++;
+	}
+
+	return (bad);
+}
+
+static int compare_u32(const void *l, const void *r) {
+	uint32_t a = *(const uint32_t *) l;
+	uint32_t b = *(const uint32_t *) r;
+
+	return (a < b ? -1 : a > b);
+}
+
+/*
+** Full 32-bit collisions, and chi^2 per degree of freedom over 65536
+** buckets picked the way hash_t picks them. Near 1.0 is what a random
+** function gives.
+*/
+
+static void spread(const char *name, uint32_t (*hashfn)(const void *),
+	char **keys, size_t n)
+{
+	static uint32_t buckets[1 << 16];
+	uint32_t *hashes = xmalloc(n * sizeof(*hashes));
+	double expect = (double) n / array_elem(buckets);
+	double chi2 = 0;
+	size_t collisions = 0;
+	size_t i;
+
+	memset(buckets, 0, sizeof(buckets));
+	for (i = 0 ; i < n ; i++) {
+		hashes[i] = hashfn(keys[i]);
+		buckets[(hashes[i] * 0x9e3779b1U) >> 16]++;
+	}
+
+	for (i = 0 ; i < array_elem(buckets) ; i++)
+		chi2 += (buckets[i] - expect) * (buckets[i] - expect) / expect;
+
+	qsort(hashes, n, sizeof(*hashes), compare_u32);
+	for (i = 1 ; i < n ; i++)
+		collisions += (hashes[i] == hashes[i - 1]);
+
+	printf("  %-8s %6zu collisions (~%.0f by chance), chi^2/df %.2f\n",
+		name, collisions, (double) n * n / 2 / 4294967296.0,
+		chi2 / (array_elem(buckets) - 1));
+
+	free(hashes);
+}
+
+static void spread_all(const char *what, char **keys, size_t n) {
+	printf("%s:\n", what);
+	spread("old", old_string_hash, keys, n);
+	spread("new", string_hash, keys, n);
+	spread("nocase", string_hash_nocase, keys, n);
+}
+
+static void throughput(size_t len) {
+	static const int rounds = 200;
+	static const size_t n = 4096;
+	volatile uint32_t sink = 0;
+	char **keys = xmalloc(n * sizeof(*keys));
+	double t[4];
+	size_t i;
+	int r;
+
+	for (i = 0 ; i < n ; i++) {
+		size_t j;
+
+		keys[i] = xmalloc(len + 1);
+		for (j = 0 ; j < len ; j++)
+			keys[i][j] = 'a' + rand() % 26;
+		keys[i][len] = '\0';
+	}
+
+	t[0] = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			sink += old_string_hash(keys[i]);
+	}
+
+	t[1] = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			sink += string_hash(keys[i]);
+	}
+
+	t[2] = bench_now();
+	for (r = 0 ; r < rounds ; r++) {
+		for (i = 0 ; i < n ; i++)
+			sink += string_hash_nocase(keys[i]);
+	}
+	t[3] = bench_now();
+
+	printf("  len %3zu:  old %6.1f  new %6.1f  nocase %6.1f\n", len,
+		(t[1] - t[0]) / ((double) rounds * n),
+		(t[2] - t[1]) / ((double) rounds * n),
+		(t[3] - t[2]) / ((double) rounds * n));
+
+	for (i = 0 ; i < n ; i++)
+		free(keys[i]);
+	free(keys);
+}
+
+int main(void) {
+	static const char nickchars[] =
+		"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_[]{}|^";
+	char **seq = xmalloc(NUM_KEYS * sizeof(*seq));
+	char **nicks = xmalloc(NUM_KEYS * sizeof(*nicks));
+	char **chans = xmalloc(NUM_KEYS * sizeof(*chans));
+	int bad;
+	size_t i;
+
+	bad = check_nocase();
+
+	srand(1);
+	for (i = 0 ; i < NUM_KEYS ; i++) {
+		char buf[64];
+		size_t len = 8 + rand() % 9;
+		size_t j;
+
+		snprintf(buf, sizeof(buf), "nick%zu", i);
+		seq[i] = xstrdup(buf);
+
+		for (j = 0 ; j < len ; j++)
+			buf[j] = nickchars[rand() % (sizeof(nickchars) - 1)];
+		buf[len] = '\0';
+		nicks[i] = xstrdup(buf);
+
+		snprintf(buf, sizeof(buf), "#chan-%c%c%zu",
+			(int) ('a' + i % 26), (int) ('a' + (i / 26) % 26), i / 676);
+		chans[i] = xstrdup(buf);
+	}
+
+	spread_all("1M \"nickN\" keys", seq, NUM_KEYS);
+	spread_all("1M random nicks", nicks, NUM_KEYS);
+	spread_all("1M \"#chan-xxN\" keys", chans, NUM_KEYS);
+
+	printf("throughput (ns/key):\n");
+	throughput(8);
+	throughput(16);
+	throughput(64);
+	throughput(256);
+
+	for (i = 0 ; i < NUM_KEYS ; i++) {
+		free(seq[i]);
+		free(nicks[i]);
+		free(chans[i]);
+	}
+
+	free(seq);
+	free(nicks);
+	free(chans);
+
+	return (bad != 0);
+}
@@ -55,6 +55,10 @@
 #include "ncic_screen.h"
 #include "ncic_queue.h"
 #include "ncic_inet.h"
+#include "ncic_zblock.h"
+#include "ncic_pool.h"
+#include "ncic_log.h"
+#include "ncic_grep.h"
 
 struct screen screen;
 
@@ -88,6 +92,21 @@ static inline void binding_run(struct binding *binding) {
 		run_mcommand(binding->binding);
 }
 
+/*
+** Keys pressed during an incremental search edit the pattern, and
+** the search is started over with whatever's there afterward.
+*/
+
+static void search_binding_run(struct binding *binding) {
+	binding_run(binding);
+	imwindow_search_update(cur_window());
+}
+
+static void search_binding_insert(int key) {
+	binding_insert(key);
+	imwindow_search_update(cur_window());
+}
+
 static void
 resize_display(void) {
 	struct winsize size;
@@ -132,6 +151,7 @@ keyboard_input(int fd, uint32_t cond, void *data)
 
 	time(&acct->last_input);
 	bind_exec(imwindow->active_binds, key);
+	screen.render.urgent = 1;
 
 	if (acct->connected && acct->marked_idle && opt_get_bool(OPT_REPORT_IDLE)) {
 		if (acct->proto->set_idle_time != NULL)
@@ -149,8 +169,9 @@ main(int argc, char *argv[])
 	char buf[PATH_MAX];
 	struct imwindow *imwindow;
 	int ret;
-	time_t timer_last_run;
+	time_t housekeeping_last_run;
 	time_t status_last_update = 0;
+	int searching = 0;
 
 	pw = getpwuid(getuid());
 	if (pw == NULL) {
@@ -172,6 +193,7 @@ main(int argc, char *argv[])
 	}
 
 	proto_init();
+	command_init();
 	color_init();
 	pork_io_init();
 
@@ -190,6 +212,8 @@ main(int argc, char *argv[])
 	bind_init(&screen.binds);
 	bind_set_handlers(&screen.binds.main, binding_run, binding_insert);
 	bind_set_handlers(&screen.binds.blist, binding_run, NULL);
+	bind_set_handlers(&screen.binds.search,
+		search_binding_run, search_binding_insert);
 
 	alias_init(&screen.alias_hash);
 
@@ -204,26 +228,35 @@ main(int argc, char *argv[])
 	screen_draw_input();
 	screen_doupdate();
 
-	time(&timer_last_run);
+	time(&housekeeping_last_run);
 	while (1) {
 		time_t time_now;
 		int dirty = 0;
+		struct timeval tv = { 0, 600000 };
 
-		pork_io_run();
+		/* Don't wait for input while a search is looking for a match. */
+		if (searching)
+			tv.tv_usec = 0;
+
+		screen_render_wait(&tv);
+		timer_wait(&screen.timer_list, &tv);
+		pork_io_run(&tv);
 		pork_acct_update();
+		timer_run(&screen.timer_list);
 
 		/*
-		** Run the timers at most once per second.
+		** Do housekeeping at most once per second.
 		*/
 
 		time(&time_now);
-		if (timer_last_run < time_now) {
-			timer_last_run = time_now;
-			timer_run(&screen.timer_list);
+		if (housekeeping_last_run < time_now) {
+			housekeeping_last_run = time_now;
 			pork_acct_reconnect_all();
+			screen_compress_scrollbuf();
 		}
 
 		imwindow = cur_window();
+		searching = imwindow_search_run(imwindow);
 		dirty = imwindow_refresh(imwindow);
 
 		/*
@@ -237,10 +270,16 @@ main(int argc, char *argv[])
 			dirty++;
 		}
 
-		dirty += screen_draw_input();
+		/*
+		** Echo typed characters without waiting for the next frame.
+		*/
+
+		if (screen_draw_input()) {
+			screen.render.urgent = 1;
+			dirty++;
+		}
 
-		if (dirty)
-			screen_doupdate();
+		screen_render(dirty);
 	}
 
 	pork_exit(0, NULL, NULL);
@@ -255,8 +294,13 @@ main(int argc, char *argv[])
 void pork_exit(int status, char *msg, char *fmt, ...) {
 	pork_acct_del_all(msg);
 	screen_destroy();
+	log_destroy();
+	grep_destroy();
+	zblock_destroy();
+	pool_destroy();
 	pork_io_destroy();
 	proto_destroy();
+	command_destroy();
 
 	wclear(stdscr);
 	wrefresh(stdscr);
@@ -18,6 +18,7 @@
 #include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_imsg.h"
 #include "ncic_imwindow.h"
 #include "ncic_proto.h"
@@ -43,7 +44,7 @@ static void pork_acct_free(struct pork_acct *acct) {
 
 	free_str_wipe(acct->passwd);
 	free(acct->away_msg);
-	free(acct->username);
+	istr_put(acct->username);
 	free(acct->profile);
 	free(acct->server);
 	free(acct->fport);
@@ -203,7 +204,7 @@ struct pork_acct *pork_acct_init(const char *user, int protocol) {
 	struct pork_acct *acct;
 
 	acct = xcalloc(1, sizeof(*acct));
-	acct->username = xstrdup(user);
+	acct->username = istr_get(user);
 	acct->state = STATE_DISCONNECTED;
 
 	acct->proto = proto_get(protocol);
@@ -224,7 +225,7 @@ struct pork_acct *pork_acct_init(const char *user, int protocol) {
 	return (acct);
 
 out_fail2:
-	free(acct->username);
+	istr_put(acct->username);
 	free(acct);
 	return (NULL);
 }
@@ -36,8 +36,7 @@ static void alias_hash_remove(void *param __notused, void *data) {
 inline int alias_remove(hash_t *alias_hash, char *alias) {
 	int ret;
 
-	ret = hash_remove(alias_hash, alias,
-			string_hash(alias, alias_hash->order));
+	ret = hash_remove(alias_hash, alias);
 
 	return (ret);
 }
@@ -45,7 +44,6 @@ inline int alias_remove(hash_t *alias_hash, char *alias) {
 int alias_add(hash_t *alias_hash, char *alias, char *str) {
 	char *temp;
 	char *args;
-	u_int32_t hash;
 	struct alias *new_alias;
 
 	alias_remove(alias_hash, alias);
@@ -64,22 +62,14 @@ int alias_add(hash_t *alias_hash, char *alias, char *str) {
 
 	new_alias->orig = xstrdup(temp);
 
-	hash = string_hash(alias, alias_hash->order);
-	hash_add(alias_hash, new_alias, hash);
+	hash_add(alias_hash, new_alias->alias, new_alias);
 
 	free(temp);
 	return (0);
 }
 
 struct alias *alias_find(hash_t *alias_hash, char *str) {
-	dlist_t *node;
-	u_int32_t hash = string_hash(str, alias_hash->order);
-
-	node = hash_find(alias_hash, str, hash);
-	if (node != NULL)
-		return (node->data);
-
-	return (NULL);
+	return (hash_find(alias_hash, str));
 }
 
 /*
@@ -191,5 +181,6 @@ int alias_resolve(hash_t *alias_hash, char *str, char **result) {
 
 int alias_init(hash_t *alias_hash) {
 	memset(alias_hash, 0, sizeof(*alias_hash));
-	return (hash_init(alias_hash, 5, alias_compare, alias_hash_remove));
+	return (hash_init(alias_hash, 5, string_hash_nocase, alias_compare,
+		alias_hash_remove));
 }
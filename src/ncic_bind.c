@@ -113,8 +113,7 @@ int bind_exec(struct key_binds *bind_set, int key) {
 inline int bind_remove(struct key_binds *bind_set, int key) {
 	int ret;
 
-	ret = hash_remove(&bind_set->hash,
-                    (void *)(intptr_t)(key), int_hash(key, bind_set->hash.order));
+	ret = hash_remove(&bind_set->hash, (void *)(intptr_t)(key));
 
 	return (ret);
 }
@@ -124,14 +123,13 @@ inline int bind_remove(struct key_binds *bind_set, int key) {
 */
 
 void bind_add(struct key_binds *bind_set, int key, char *command) {
-	u_int32_t hash = int_hash(key, bind_set->hash.order);
 	struct binding *binding = xmalloc(sizeof(*binding));
 
 	bind_remove(bind_set, key);
 
 	binding->key = key;
 	binding->binding = xstrdup(command);
-	hash_add(&bind_set->hash, binding, hash);
+	hash_add(&bind_set->hash, (void *)(intptr_t)(key), binding);
 }
 
 /*
@@ -144,6 +142,13 @@ static void bind_add_default(struct binds *binds) {
 	bind_add(&binds->main, '\n', "input send");
 	bind_add(&binds->main, 127, "input backspace");
 	bind_add(&binds->main, KEY_BACKSPACE, "input backspace");
+
+	bind_add(&binds->search, '\n', "scroll search_done");
+	bind_add(&binds->search, 127, "input backspace");
+	bind_add(&binds->search, KEY_BACKSPACE, "input backspace");
+	bind_add(&binds->search, CTRL_KEY('g'), "scroll search_cancel");
+	bind_add(&binds->search, CTRL_KEY('n'), "scroll search_next");
+	bind_add(&binds->search, CTRL_KEY('p'), "scroll search_prev");
 }
 
 /*
@@ -153,10 +158,16 @@ static void bind_add_default(struct binds *binds) {
 inline int bind_init(struct binds *binds) {
 	memset(binds, 0, sizeof(*binds));
 
-	if (hash_init(&binds->main.hash, 5, bind_compare, bind_hash_remove) != 0)
+	if (hash_init(&binds->main.hash, 5, int_hash, bind_compare,
+		bind_hash_remove) != 0)
+		return (-1);
+
+	if (hash_init(&binds->blist.hash, 3, int_hash, bind_compare,
+		bind_hash_remove) != 0)
 		return (-1);
 
-	if (hash_init(&binds->blist.hash, 3, bind_compare, bind_hash_remove) != 0)
+	if (hash_init(&binds->search.hash, 3, int_hash, bind_compare,
+		bind_hash_remove) != 0)
 		return (-1);
 
 	bind_add_default(binds);
@@ -166,6 +177,7 @@ inline int bind_init(struct binds *binds) {
 void bind_destroy(struct binds *binds) {
 	hash_destroy(&binds->main.hash);
 	hash_destroy(&binds->blist.hash);
+	hash_destroy(&binds->search.hash);
 }
 
 inline void bind_set_handlers(	struct key_binds *bind_set,
@@ -181,14 +193,7 @@ inline void bind_set_handlers(	struct key_binds *bind_set,
 */
 
 struct binding *bind_find(struct key_binds *bind_set, int key) {
-	dlist_t *node;
-	u_int32_t hash = int_hash(key, bind_set->hash.order);
-
-	node = hash_find(&bind_set->hash, (void *)(intptr_t)(key), hash);
-	if (node != NULL)
-		return (node->data);
-
-	return (NULL);
+	return (hash_find(&bind_set->hash, (void *)(intptr_t)(key)));
 }
 
 /*
@@ -30,6 +30,7 @@ struct key_binds {
 struct binds {
 	struct key_binds main;
 	struct key_binds blist;
+	struct key_binds search;
 };
 
 int bind_init(struct binds *binds);
@@ -0,0 +1,841 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#include <unistd.h>
+#include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_log.h"
+#include "ncic_blog.h"
+
+/*
+** The sender of the message that's being printed, if it's known, so
+** that it can be logged along with the message.
+*/
+
+static const char *cur_sender;
+
+static inline void put16(unsigned char *p, uint16_t val) {
+	p[0] = val & 0xff;
+	p[1] = val >> 8;
+}
+
+static inline void put32(unsigned char *p, uint32_t val) {
+	put16(p, val & 0xffff);
+	put16(p + 2, val >> 16);
+}
+
+static inline void put64(unsigned char *p, uint64_t val) {
+	put32(p, val & 0xffffffff);
+	put32(p + 4, val >> 32);
+}
+
+static inline uint16_t get16(const unsigned char *p) {
+	return (p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const unsigned char *p) {
+	return (get16(p) | ((uint32_t) get16(p + 2) << 16));
+}
+
+static inline uint64_t get64(const unsigned char *p) {
+	return (get32(p) | ((uint64_t) get32(p + 4) << 32));
+}
+
+void blog_set_sender(const char *sender) {
+	cur_sender = sender;
+}
+
+const char *blog_get_sender(void) {
+	return (cur_sender);
+}
+
+/*
+** Check that "path" is empty or starts with "magic". Sets "*size"
+** to the size of the file (0 if it doesn't exist).
+*/
+
+static int blog_check_magic(const char *path, const char *magic, off_t *size) {
+	char buf[BLOG_MAGIC_LEN];
+	struct stat st;
+	FILE *fp;
+	size_t ret;
+
+	*size = 0;
+	if (stat(path, &st) != 0)
+		return (errno == ENOENT ? 0 : -1);
+
+	*size = st.st_size;
+	if (st.st_size == 0)
+		return (0);
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return (-1);
+
+	ret = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	if (ret != sizeof(buf) || memcmp(buf, magic, sizeof(buf))) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+** Returns 1 if "path" is a binary log.
+*/
+
+int blog_is_blog(const char *path) {
+	off_t size;
+
+	return (blog_check_magic(path, BLOG_MAGIC, &size) == 0 && size > 0);
+}
+
+static off_t blog_repair(const char *path, off_t size);
+
+/*
+** With "repair" set, a partial record at the end of the file is cut
+** off before it's opened, so the log's idea of its size is right.
+*/
+
+static struct log *blog_open_file(const char *path, const char *magic,
+	off_t *size, int repair)
+{
+	struct log *log;
+
+	if (blog_check_magic(path, magic, size) != 0)
+		return (NULL);
+
+	if (repair && *size > BLOG_MAGIC_LEN)
+		*size = blog_repair(path, *size);
+
+	log = log_open(path, LOG_RAW);
+	if (log == NULL)
+		return (NULL);
+
+	if (*size == 0) {
+		struct iovec iov;
+
+		iov.iov_base = (void *) magic;
+		iov.iov_len = BLOG_MAGIC_LEN;
+
+		if (log_writev(log, &iov, 1) != 0) {
+			log_close(log);
+			errno = ENOBUFS;
+			return (NULL);
+		}
+
+		*size = BLOG_MAGIC_LEN;
+	}
+
+	return (log);
+}
+
+static off_t blog_seek_index(const char *path, time_t from);
+
+static int blog_read_rec(int fd, off_t offset, off_t size, char **buf,
+	size_t *bufsize, uint32_t *len)
+{
+	unsigned char lenbuf[4];
+	struct blog_rec rec;
+
+	if (size - offset < BLOG_HDR_LEN + BLOG_TRAILER_LEN ||
+		pread(fd, lenbuf, sizeof(lenbuf), offset) != sizeof(lenbuf))
+	{
+		return (-1);
+	}
+
+	*len = get32(lenbuf);
+	if (*len > BLOG_MAX_RECORD || *len > size - offset)
+		return (-1);
+
+	if (*len > *bufsize) {
+		*bufsize = *len;
+		*buf = xrealloc(*buf, *bufsize);
+	}
+
+	if (pread(fd, *buf, *len, offset) != (ssize_t) *len)
+		return (-1);
+
+	return (blog_parse_rec(*buf, *len, &rec));
+}
+
+/*
+** If the client crashed while a record was being written, cut off
+** the partial record, so that what's appended after it can be read.
+** Returns the size of the log afterwards.
+*/
+
+static off_t blog_repair(const char *path, off_t size) {
+	unsigned char lenbuf[4];
+	char *buf = NULL;
+	size_t bufsize = 0;
+	uint32_t len;
+	off_t offset;
+	int fd;
+
+	fd = open(path, O_RDWR);
+	if (fd == -1)
+		return (size);
+
+	/* The usual case: the last record is whole. */
+	if (pread(fd, lenbuf, sizeof(lenbuf), size - BLOG_TRAILER_LEN) ==
+		sizeof(lenbuf))
+	{
+		offset = size - get32(lenbuf);
+
+		if (offset >= BLOG_MAGIC_LEN &&
+			blog_read_rec(fd, offset, size, &buf, &bufsize, &len) == 0)
+		{
+			goto out;
+		}
+	}
+
+	offset = blog_seek_index(path, (time_t) INT64_MAX);
+	if (offset >= size)
+		offset = BLOG_MAGIC_LEN;
+
+	while (blog_read_rec(fd, offset, size, &buf, &bufsize, &len) == 0)
+		offset += len;
+
+	debug("truncating %s from %lld to %lld", path,
+		(long long) size, (long long) offset);
+
+	if (ftruncate(fd, offset) == 0)
+		size = offset;
+
+out:
+	free(buf);
+	close(fd);
+	return (size);
+}
+
+/*
+** Drop the entries at the end of the index that point at or past
+** "size", the end of the log once it's been repaired. The index can
+** get ahead of the log if the client crashes, and once more records
+** are added those entries would point into the middle of one. A
+** partial entry at the end is dropped too.
+*/
+
+static void blog_trim_index(const char *idxpath, off_t size) {
+	unsigned char buf[BLOG_MAGIC_LEN];
+	struct stat st;
+	off_t nent;
+	int fd;
+
+	fd = open(idxpath, O_RDWR);
+	if (fd == -1)
+		return;
+
+	if (fstat(fd, &st) != 0 || st.st_size < BLOG_MAGIC_LEN ||
+		pread(fd, buf, BLOG_MAGIC_LEN, 0) != BLOG_MAGIC_LEN ||
+		memcmp(buf, BLOG_IDX_MAGIC, BLOG_MAGIC_LEN))
+	{
+		close(fd);
+		return;
+	}
+
+	nent = (st.st_size - BLOG_MAGIC_LEN) / 16;
+	while (nent > 0) {
+		if (pread(fd, buf, 8, BLOG_MAGIC_LEN + (nent - 1) * 16 + 8) != 8 ||
+			(off_t) get64(buf) < size)
+		{
+			break;
+		}
+
+		nent--;
+	}
+
+	if (BLOG_MAGIC_LEN + nent * 16 != st.st_size) {
+		debug("truncating %s to %lld entries", idxpath, (long long) nent);
+
+		if (ftruncate(fd, BLOG_MAGIC_LEN + nent * 16) != 0)
+			debug("ftruncate %s: %s", idxpath, strerror(errno));
+	}
+
+	close(fd);
+}
+
+/*
+** Open a binary log and its index for appending. Returns NULL with
+** errno set on failure; EINVAL means that one of the files exists
+** but isn't in this format.
+*/
+
+struct blog *blog_open(const char *path) {
+	struct blog *blog;
+	char idxpath[PATH_MAX];
+	off_t size;
+	off_t idxsize;
+	int ret;
+
+	ret = snprintf(idxpath, sizeof(idxpath), "%s.idx", path);
+	if (ret < 0 || (size_t) ret >= sizeof(idxpath)) {
+		errno = ENAMETOOLONG;
+		return (NULL);
+	}
+
+	blog = xcalloc(1, sizeof(*blog));
+
+	blog->log = blog_open_file(path, BLOG_MAGIC, &size, 1);
+	if (blog->log == NULL)
+		goto err;
+
+	blog_trim_index(idxpath, size);
+
+	blog->idx = blog_open_file(idxpath, BLOG_IDX_MAGIC, &idxsize, 0);
+	if (blog->idx == NULL) {
+		int err = errno;
+
+		log_close(blog->log);
+		errno = err;
+		goto err;
+	}
+
+	blog->offset = size;
+	return (blog);
+
+err:
+	free(blog);
+	return (NULL);
+}
+
+/*
+** Start a new log and index. The old index is rotated to the old
+** log's new name with ".idx" added, so the pair still works with
+** /export.
+*/
+
+static void blog_rotate(struct blog *blog, time_t now) {
+	char path[PATH_MAX];
+	char idxpath[PATH_MAX];
+	int ret;
+
+	if (log_rotate_path(blog->log, now, path, sizeof(path)) != 0)
+		return;
+
+	ret = snprintf(idxpath, sizeof(idxpath), "%s.idx", path);
+	if (ret < 0 || (size_t) ret >= sizeof(idxpath))
+		return;
+
+	if (log_rotate(blog->log, path, BLOG_MAGIC, BLOG_MAGIC_LEN, now) != 0)
+		return;
+
+	log_rotate(blog->idx, idxpath, BLOG_IDX_MAGIC, BLOG_MAGIC_LEN, now);
+
+	blog->offset = BLOG_MAGIC_LEN;
+	blog->indexed = 0;
+	blog->has_indexed = 0;
+}
+
+/*
+** Append a record to the log, and an entry for it to the index if
+** it's been BLOG_INDEX_STRIDE bytes since the last one. Returns -1
+** if the record was dropped because the log queue is full.
+*/
+
+int blog_write(	struct blog *blog,
+				time_t when,
+				uint32_t type,
+				const char *sender,
+				const char *text,
+				size_t len)
+{
+	unsigned char hdr[BLOG_HDR_LEN];
+	unsigned char trailer[BLOG_TRAILER_LEN];
+	struct iovec iov[4];
+	size_t sender_len = 0;
+	uint32_t total;
+
+	if (log_rotate_due(blog->log, when))
+		blog_rotate(blog, when);
+
+	if (sender != NULL)
+		sender_len = min(strlen(sender), 0xffff);
+
+	len = min(len, BLOG_MAX_RECORD -
+		(BLOG_HDR_LEN + BLOG_TRAILER_LEN + sender_len));
+	total = BLOG_HDR_LEN + sender_len + len + BLOG_TRAILER_LEN;
+
+	put32(hdr, total);
+	put64(hdr + 4, (uint64_t) when);
+	put32(hdr + 12, type);
+	put16(hdr + 16, sender_len);
+	put32(trailer, total);
+
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void *) sender;
+	iov[1].iov_len = sender_len;
+	iov[2].iov_base = (void *) text;
+	iov[2].iov_len = len;
+	iov[3].iov_base = trailer;
+	iov[3].iov_len = sizeof(trailer);
+
+	if (log_writev(blog->log, iov, 4) != 0)
+		return (-1);
+
+	if (!blog->has_indexed ||
+		blog->offset - blog->indexed >= BLOG_INDEX_STRIDE)
+	{
+		unsigned char ent[16];
+		struct iovec eiov;
+
+		/* Keep the index sorted even if the clock goes backwards. */
+		if ((uint64_t) when > blog->idx_time || !blog->has_indexed)
+			blog->idx_time = when;
+
+		put64(ent, blog->idx_time);
+		put64(ent + 8, blog->offset);
+		eiov.iov_base = ent;
+		eiov.iov_len = sizeof(ent);
+
+		if (log_writev(blog->idx, &eiov, 1) == 0) {
+			blog->indexed = blog->offset;
+			blog->has_indexed = 1;
+		}
+	}
+
+	blog->offset += total;
+	return (0);
+}
+
+void blog_close(struct blog *blog) {
+	log_close(blog->log);
+	log_close(blog->idx);
+	free(blog);
+}
+
+/*
+** Parse the record of "len" bytes in "buf". Returns -1 if it isn't
+** a valid record.
+*/
+
+int blog_parse_rec(const char *buf, size_t len, struct blog_rec *rec) {
+	const unsigned char *p = (const unsigned char *) buf;
+	uint32_t total;
+
+	if (len < BLOG_HDR_LEN + BLOG_TRAILER_LEN)
+		return (-1);
+
+	total = get32(p);
+	if (total != len || get32(p + len - BLOG_TRAILER_LEN) != total)
+		return (-1);
+
+	rec->time = (time_t) get64(p + 4);
+	rec->type = get32(p + 12);
+	rec->sender_len = get16(p + 16);
+
+	if (BLOG_HDR_LEN + rec->sender_len + BLOG_TRAILER_LEN > len)
+		return (-1);
+
+	rec->sender = buf + BLOG_HDR_LEN;
+	rec->text = rec->sender + rec->sender_len;
+	rec->text_len = len - BLOG_HDR_LEN - BLOG_TRAILER_LEN - rec->sender_len;
+
+	return (0);
+}
+
+/*
+** A crash in the middle of writing a record leaves a partial record at
+** the end of the log, and then it can't be read backwards. Read it
+** forwards instead, keeping the last "n" records.
+*/
+
+static size_t blog_tail_forward(const char *map,
+								size_t size,
+								struct log_line *lines,
+								size_t n)
+{
+	const char *p = map + BLOG_MAGIC_LEN;
+	const char *end = map + size;
+	struct log_line *ring;
+	size_t total = 0;
+	size_t found;
+	size_t i;
+
+	ring = xmalloc(sizeof(*ring) * n);
+
+	while (end - p >= BLOG_HDR_LEN + BLOG_TRAILER_LEN) {
+		uint32_t len = get32((const unsigned char *) p);
+		struct blog_rec rec;
+
+		if (len > (size_t) (end - p) || blog_parse_rec(p, len, &rec) != 0)
+			break;
+
+		if (rec.text_len > 0) {
+			ring[total % n].text = rec.text;
+			ring[total % n].len = rec.text_len;
+			total++;
+		}
+
+		p += len;
+	}
+
+	found = min(total, n);
+	for (i = 0 ; i < found ; i++)
+		lines[n - found + i] = ring[(total - found + i) % n];
+
+	free(ring);
+	return (found);
+}
+
+/*
+** Find the last "n" messages in the binary log mapped at "map", reading
+** backwards from the end. They're stored oldest first at the end of
+** "lines". Returns how many were found.
+*/
+
+size_t blog_tail(const char *map, size_t size, struct log_line *lines, size_t n) {
+	const char *start = map + BLOG_MAGIC_LEN;
+	const char *end = map + size;
+	size_t found = 0;
+
+	if (n == 0 || size < BLOG_MAGIC_LEN ||
+		memcmp(map, BLOG_MAGIC, BLOG_MAGIC_LEN))
+	{
+		return (0);
+	}
+
+	while (found < n && end - start >= BLOG_HDR_LEN + BLOG_TRAILER_LEN) {
+		uint32_t len = get32((const unsigned char *) end - BLOG_TRAILER_LEN);
+		struct blog_rec rec;
+
+		if (len > (size_t) (end - start) ||
+			blog_parse_rec(end - len, len, &rec) != 0)
+		{
+			if (end == map + size)
+				return (blog_tail_forward(map, size, lines, n));
+			break;
+		}
+
+		if (rec.text_len > 0) {
+			found++;
+			lines[n - found].text = rec.text;
+			lines[n - found].len = rec.text_len;
+		}
+
+		end -= len;
+	}
+
+	return (found);
+}
+
+/*
+** Parse "now", "YYYY-MM-DD[THH:MM[:SS]]" or "HH:MM[:SS]" (today) in
+** local time. Parts that are left out are filled in as the start of
+** the day or minute, or with "end" set, as the end of it.
+*/
+
+int blog_parse_time(const char *str, int end, time_t *when) {
+	struct tm tm;
+	time_t now = time(NULL);
+	int year, mon, day;
+	int hour, minute, sec;
+	int n = -1;
+
+	if (!strcasecmp(str, "now")) {
+		*when = now;
+		return (0);
+	}
+
+	localtime_r(&now, &tm);
+
+	if (sscanf(str, "%4d-%2d-%2d%n", &year, &mon, &day, &n) == 3 && n > 0) {
+		if (mon < 1 || mon > 12 || day < 1 || day > 31)
+			return (-1);
+
+		tm.tm_year = year - 1900;
+		tm.tm_mon = mon - 1;
+		tm.tm_mday = day;
+
+		str += n;
+		if (*str == '\0') {
+			tm.tm_hour = end ? 23 : 0;
+			tm.tm_min = end ? 59 : 0;
+			tm.tm_sec = end ? 59 : 0;
+			goto done;
+		}
+
+		if (*str != 'T' && *str != 't')
+			return (-1);
+		str++;
+	}
+
+	n = -1;
+	if (sscanf(str, "%2d:%2d:%2d%n", &hour, &minute, &sec, &n) != 3 ||
+		n < 0 || str[n] != '\0')
+	{
+		n = -1;
+		if (sscanf(str, "%2d:%2d%n", &hour, &minute, &n) != 2 ||
+			n < 0 || str[n] != '\0')
+		{
+			return (-1);
+		}
+
+		sec = end ? 59 : 0;
+	}
+
+	if (hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+		sec < 0 || sec > 60)
+	{
+		return (-1);
+	}
+
+	tm.tm_hour = hour;
+	tm.tm_min = minute;
+	tm.tm_sec = sec;
+
+done:
+	tm.tm_isdst = -1;
+	*when = mktime(&tm);
+	if (*when == (time_t) -1)
+		return (-1);
+
+	return (0);
+}
+
+/*
+** Find where to start reading to find records from "from" on: the
+** last index entry older than "from". Without an index, that's the
+** start of the log.
+*/
+
+static off_t blog_seek_index(const char *path, time_t from) {
+	char idxpath[PATH_MAX];
+	unsigned char *idx;
+	off_t offset = BLOG_MAGIC_LEN;
+	struct stat st;
+	size_t nent;
+	size_t low;
+	size_t high;
+	FILE *fp;
+
+	snprintf(idxpath, sizeof(idxpath), "%s.idx", path);
+
+	fp = fopen(idxpath, "r");
+	if (fp == NULL)
+		return (offset);
+
+	if (fstat(fileno(fp), &st) != 0 || st.st_size < BLOG_MAGIC_LEN + 16) {
+		fclose(fp);
+		return (offset);
+	}
+
+	idx = xmalloc(st.st_size);
+	if (fread(idx, 1, st.st_size, fp) != (size_t) st.st_size ||
+		memcmp(idx, BLOG_IDX_MAGIC, BLOG_MAGIC_LEN))
+	{
+		goto out;
+	}
+
+	/* Binary search for the first entry at or after "from". */
+	nent = (st.st_size - BLOG_MAGIC_LEN) / 16;
+	low = 0;
+	high = nent;
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const unsigned char *ent = idx + BLOG_MAGIC_LEN + mid * 16;
+
+		if ((time_t) get64(ent) < from)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low > 0)
+		offset = get64(idx + BLOG_MAGIC_LEN + (low - 1) * 16 + 8);
+
+out:
+	free(idx);
+	fclose(fp);
+	return (offset);
+}
+
+/*
+** Split the first "size" bytes of the binary log "path" into pieces of
+** about "stride" bytes that start on record boundaries, using the
+** index. Returns the number of pieces; "*offsets" is set to a list of
+** where each one starts, which the caller must free.
+*/
+
+size_t blog_chunks(	const char *path,
+					uint64_t size,
+					uint64_t stride,
+					uint64_t **offsets)
+{
+	char idxpath[PATH_MAX];
+	unsigned char *idx = NULL;
+	uint64_t *ret;
+	struct stat st;
+	size_t num = 1;
+	size_t nent;
+	size_t i;
+	FILE *fp;
+
+	ret = xmalloc(sizeof(*ret));
+	ret[0] = BLOG_MAGIC_LEN;
+
+	snprintf(idxpath, sizeof(idxpath), "%s.idx", path);
+	fp = fopen(idxpath, "r");
+	if (fp == NULL)
+		goto out;
+
+	if (fstat(fileno(fp), &st) != 0 || st.st_size < BLOG_MAGIC_LEN + 16)
+		goto out;
+
+	idx = xmalloc(st.st_size);
+	if (fread(idx, 1, st.st_size, fp) != (size_t) st.st_size ||
+		memcmp(idx, BLOG_IDX_MAGIC, BLOG_MAGIC_LEN))
+	{
+		goto out;
+	}
+
+	nent = (st.st_size - BLOG_MAGIC_LEN) / 16;
+	for (i = 0 ; i < nent ; i++) {
+		uint64_t offset = get64(idx + BLOG_MAGIC_LEN + i * 16 + 8);
+
+		/* The index can run ahead of the log after a crash. */
+		if (offset >= size)
+			break;
+
+		if (offset >= ret[num - 1] + stride) {
+			ret = xrealloc(ret, (num + 1) * sizeof(*ret));
+			ret[num++] = offset;
+		}
+	}
+
+out:
+	if (fp != NULL)
+		fclose(fp);
+
+	free(idx);
+	*offsets = ret;
+	return (num);
+}
+
+/*
+** Write the text of every message in the binary log "path" between
+** "from" and "to" (inclusive), and from "sender" if it isn't NULL, to
+** "out". Returns the number of messages written, or -1 with errno
+** set on failure.
+*/
+
+int blog_export(const char *path,
+				time_t from,
+				time_t to,
+				const char *sender,
+				FILE *out)
+{
+	char magic[BLOG_MAGIC_LEN];
+	size_t sender_len = 0;
+	char *buf = NULL;
+	size_t size = 0;
+	int count = 0;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return (-1);
+
+	if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+		memcmp(magic, BLOG_MAGIC, sizeof(magic)))
+	{
+		fclose(fp);
+		errno = EINVAL;
+		return (-1);
+	}
+
+	if (fseeko(fp, blog_seek_index(path, from), SEEK_SET) != 0) {
+		int err = errno;
+
+		fclose(fp);
+		errno = err;
+		return (-1);
+	}
+
+	if (sender != NULL)
+		sender_len = strlen(sender);
+
+	for (;;) {
+		unsigned char lenbuf[4];
+		struct blog_rec rec;
+		char timebuf[64];
+		struct tm tm;
+		uint32_t len;
+
+		if (fread(lenbuf, 1, sizeof(lenbuf), fp) != sizeof(lenbuf))
+			break;
+
+		len = get32(lenbuf);
+		if (len < BLOG_HDR_LEN + BLOG_TRAILER_LEN || len > BLOG_MAX_RECORD)
+			break;
+
+		if (len > size) {
+			size = max(len, 4096);
+			buf = xrealloc(buf, size);
+		}
+
+		memcpy(buf, lenbuf, sizeof(lenbuf));
+		if (fread(buf + 4, 1, len - 4, fp) != len - 4)
+			break;
+
+		/* A partial record at the end means that we crashed writing it. */
+		if (blog_parse_rec(buf, len, &rec) != 0)
+			break;
+
+		if (rec.time > to)
+			break;
+
+		if (rec.time < from)
+			continue;
+
+		if (sender != NULL && (rec.sender_len != sender_len ||
+			strncasecmp(rec.sender, sender, sender_len)))
+		{
+			continue;
+		}
+
+		localtime_r(&rec.time, &tm);
+		strftime(timebuf, sizeof(timebuf), "[%Y-%m-%d %H:%M:%S] ", &tm);
+		fputs(timebuf, out);
+		fwrite(rec.text, 1, rec.text_len, out);
+		fputc('\n', out);
+		count++;
+	}
+
+	free(buf);
+	fclose(fp);
+	return (count);
+}
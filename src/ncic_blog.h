@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_BLOG_H__
+#define __NCIC_BLOG_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+** Binary chat logs. The file starts with BLOG_MAGIC, followed by one
+** record per message, all fields little-endian:
+**
+**	uint32 len		size of the whole record, including this field
+**	uint64 time
+**	uint32 type		the MSG_TYPE_* of the message
+**	uint16 sender_len
+**	sender, then the text (not NUL-terminated)
+**	uint32 len		again, so the file can be read backwards
+**
+** Every BLOG_INDEX_STRIDE bytes or so, the time and offset of a record
+** are appended to the index, <logfile>.idx, which starts with
+** BLOG_IDX_MAGIC and holds pairs of uint64s.
+*/
+
+#define BLOG_MAGIC			"NCICLOG1"
+#define BLOG_IDX_MAGIC		"NCICIDX1"
+#define BLOG_MAGIC_LEN		8
+
+#define BLOG_HDR_LEN		18
+#define BLOG_TRAILER_LEN	4
+#define BLOG_MAX_RECORD		(1 << 20)
+#define BLOG_INDEX_STRIDE	(64 * 1024)
+
+struct log;
+struct log_line;
+
+struct blog {
+	struct log *log;
+	struct log *idx;
+
+	/* where the next record will go, and the last one indexed */
+	uint64_t offset;
+	uint64_t indexed;
+	uint64_t idx_time;
+	uint32_t has_indexed:1;
+};
+
+struct blog_rec {
+	time_t time;
+	uint32_t type;
+	const char *sender;
+	size_t sender_len;
+	const char *text;
+	size_t text_len;
+};
+
+struct blog *blog_open(const char *path);
+int blog_is_blog(const char *path);
+int blog_write(struct blog *blog, time_t when, uint32_t type,
+	const char *sender, const char *text, size_t len);
+void blog_close(struct blog *blog);
+
+int blog_parse_rec(const char *buf, size_t len, struct blog_rec *rec);
+size_t blog_tail(const char *map, size_t size, struct log_line *lines, size_t n);
+int blog_parse_time(const char *str, int end, time_t *when);
+size_t blog_chunks(const char *path, uint64_t size, uint64_t stride,
+	uint64_t **offsets);
+int blog_export(const char *path, time_t from, time_t to,
+	const char *sender, FILE *out);
+
+void blog_set_sender(const char *sender);
+const char *blog_get_sender(void);
+
+#endif /* __NCIC_BLOG_H__ */
@@ -10,11 +10,13 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ncurses.h>
 
 #include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_acct.h"
 #include "ncic_set.h"
 #include "ncic_proto.h"
@@ -25,19 +27,113 @@
 #include "ncic_imwindow.h"
 #include "ncic_chat.h"
 
-static void chat_destroy_user_list_cb(void *param, void *data) {
-	struct pork_acct *acct = (struct pork_acct *) param;
-	struct chat_user *chat_user = (struct chat_user *) data;
+static int chat_user_compare(void *l, void *r) {
+	const char *name = l;
+	const struct chat_user *chat_user = r;
 
+	if (name == chat_user->nname)
+		return (0);
+
+	return (strcasecmp(name, chat_user->nname));
+}
+
+static void chat_free_user(struct pork_acct *acct, struct chat_user *chat_user) {
 	if (acct->proto->chat_user_free != NULL)
 		acct->proto->chat_user_free(acct, chat_user);
 
-	free(chat_user->host);
-	free(chat_user->nname);
-	free(chat_user->name);
+	istr_put(chat_user->host);
+	istr_put(chat_user->nname);
+	istr_put(chat_user->name);
 	free(chat_user);
 }
 
+/*
+** Advanced every time someone says something in a chat room, so
+** that nick completion can offer the people who spoke last first.
+*/
+
+static u_int32_t chat_activity_clock;
+
+/*
+** Return the position in the room's sorted list of nicks of the first
+** one whose first "len" characters don't sort before "name".
+*/
+
+static u_int32_t chat_nick_pos(	struct chatroom *chat,
+								const char *name,
+								size_t len)
+{
+	u_int32_t lo = 0;
+	u_int32_t hi = chat->num_users;
+
+	while (lo < hi) {
+		u_int32_t mid = lo + (hi - lo) / 2;
+
+		if (strncasecmp(chat->nicks[mid]->nname, name, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo);
+}
+
+/*
+** Add "chat_user" to the room's sorted list of nicks. The caller
+** counts it in chat->num_users afterward.
+*/
+
+static void chat_nick_add(struct chatroom *chat, struct chat_user *chat_user) {
+	u_int32_t pos;
+
+	if (chat->num_users == chat->nicks_size) {
+		chat->nicks_size = max(chat->nicks_size * 2, 16);
+		chat->nicks = xrealloc(chat->nicks,
+						chat->nicks_size * sizeof(*chat->nicks));
+	}
+
+	pos = chat_nick_pos(chat, chat_user->nname, SIZE_MAX);
+	memmove(&chat->nicks[pos + 1], &chat->nicks[pos],
+		(chat->num_users - pos) * sizeof(*chat->nicks));
+	chat->nicks[pos] = chat_user;
+}
+
+/*
+** Take "chat_user" out of the room's sorted list of nicks. The caller
+** stops counting it in chat->num_users afterward.
+*/
+
+static void chat_nick_del(struct chatroom *chat, struct chat_user *chat_user) {
+	u_int32_t pos = chat_nick_pos(chat, chat_user->nname, SIZE_MAX);
+
+	if (pos == chat->num_users || chat->nicks[pos] != chat_user)
+		return;
+
+	memmove(&chat->nicks[pos], &chat->nicks[pos + 1],
+		(chat->num_users - pos - 1) * sizeof(*chat->nicks));
+}
+
+/*
+** Note that "user" just said something in "chat".
+*/
+
+void chat_user_spoke(struct pork_acct *acct, struct chatroom *chat, char *user) {
+	struct chat_user *chat_user = chat_find_user(acct, chat, user);
+
+	if (chat_user != NULL)
+		chat_user->active = ++chat_activity_clock;
+}
+
+static int chat_nick_active_cmp(const void *l, const void *r) {
+	const struct chat_user *u1 = *(struct chat_user *const *) l;
+	const struct chat_user *u2 = *(struct chat_user *const *) r;
+
+	if (u1->active != u2->active)
+		return (u1->active > u2->active ? -1 : 1);
+
+	return (strcasecmp(u1->nname, u2->nname));
+}
+
 struct chatroom *chat_new(	struct pork_acct *acct,
 							char *chat_title,
 							char *chat_title_full,
@@ -46,12 +142,13 @@ struct chatroom *chat_new(	struct pork_acct *acct,
 	struct chatroom *chat;
 
 	chat = xcalloc(1, sizeof(*chat));
-	chat->title = xstrdup(chat_title);
+	chat->title = istr_get(chat_title);
 	chat->title_quoted = acct->proto->filter_text(chat_title);
-	chat->title_full = xstrdup(chat_title_full);
+	chat->title_full = istr_get(chat_title_full);
 	chat->title_full_quoted = acct->proto->filter_text(chat_title_full);
 	chat->win = win;
 	win->data = chat;
+	hash_init(&chat->user_hash, 3, string_hash_nocase, chat_user_compare, NULL);
 
 	acct->chat_list = dlist_add_head(acct->chat_list, chat);
 
@@ -98,7 +195,7 @@ int chat_send_notice(	struct pork_acct *acct,
 			acct, chat, target, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(chat->win, buf, (size_t) ret,
+		screen_print_msg(chat->win, acct->username, buf, (size_t) ret,
 			MSG_TYPE_CHAT_NOTICE_SEND);
 		imwindow_send_msg(chat->win);
 	}
@@ -122,7 +219,7 @@ int chat_send_action(	struct pork_acct *acct,
 				acct, chat, target, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(chat->win, buf, (size_t) ret,
+		screen_print_msg(chat->win, acct->username, buf, (size_t) ret,
 			MSG_TYPE_CHAT_ACTION_SEND);
 		imwindow_send_msg(chat->win);
 	} else
@@ -138,6 +235,8 @@ int chat_recv_action(	struct pork_acct *acct,
 						char *userhost,
 						char *msg)
 {
+	chat_user_spoke(acct, chat, user);
+
 	if (!chat_user_is_ignored(acct, chat, user)) {
 		char buf[4096];
 		int ret;
@@ -146,7 +245,7 @@ int chat_recv_action(	struct pork_acct *acct,
 				sizeof(buf), acct, chat, dest, user, userhost, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(chat->win, buf, (size_t) ret,
+		screen_print_msg(chat->win, user, buf, (size_t) ret,
 			MSG_TYPE_CHAT_ACTION_RECV);
 		imwindow_recv_msg(chat->win);
 	}
@@ -161,6 +260,8 @@ int chat_recv_msg(	struct pork_acct *acct,
 					char *userhost,
 					char *msg)
 {
+	chat_user_spoke(acct, chat, user);
+
 	if (!chat_user_is_ignored(acct, chat, user)) {
 		char buf[4096];
 		int ret;
@@ -169,7 +270,7 @@ int chat_recv_msg(	struct pork_acct *acct,
 				chat, dest, user, userhost, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(chat->win, buf, (size_t) ret,
+		screen_print_msg(chat->win, user, buf, (size_t) ret,
 			MSG_TYPE_CHAT_MSG_RECV);
 		imwindow_recv_msg(chat->win);
 	}
@@ -192,7 +293,7 @@ int chat_recv_notice(	struct pork_acct *acct,
 				sizeof(buf), acct, chat, dest, user, userhost, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(chat->win, buf, (size_t) ret,
+		screen_print_msg(chat->win, user, buf, (size_t) ret,
 			MSG_TYPE_CHAT_NOTICE_RECV);
 		imwindow_recv_msg(chat->win);
 	}
@@ -459,6 +560,8 @@ void chat_list(struct pork_acct *acct) {
 }
 
 int chat_free(struct pork_acct *acct, struct chatroom *chat, int silent) {
+	struct chat_user *chat_user;
+	struct chat_user *next;
 	dlist_t *cur;
 
 	cur = dlist_find(acct->chat_list, chat, NULL);
@@ -489,11 +592,14 @@ int chat_free(struct pork_acct *acct, struct chatroom *chat, int silent) {
 	if (acct->proto->chat_free != NULL)
 		acct->proto->chat_free(acct, chat->data);
 
-	dlist_destroy(chat->user_list, acct, chat_destroy_user_list_cb);
+	hash_destroy(&chat->user_hash);
+	free(chat->nicks);
+	ilist_foreach_safe(chat_user, next, &chat->user_list, link)
+		chat_free_user(acct, chat_user);
 
-	free(chat->title);
+	istr_put(chat->title);
 	free(chat->title_quoted);
-	free(chat->title_full);
+	istr_put(chat->title_full);
 	free(chat->title_full_quoted);
 	free(chat->topic);
 	free(chat);
@@ -548,17 +654,17 @@ struct chat_user *chat_user_joined(	struct pork_acct *acct,
 		return (NULL);
 	}
 
-	chat->num_users++;
 	acct->proto->normalize(buf, user, sizeof(buf));
 
 	chat_user = xcalloc(1, sizeof(*chat_user));
-	chat_user->name = xstrdup(user);
-	chat_user->nname = xstrdup(buf);
+	chat_user->name = istr_get(user);
+	chat_user->nname = istr_get(buf);
+	chat_user->host = istr_get(host);
 
-	if (host != NULL)
-		chat_user->host = xstrdup(host);
-
-	chat->user_list = dlist_add_head(chat->user_list, chat_user);
+	ilist_add_head(&chat->user_list, chat_user, link);
+	hash_add(&chat->user_hash, chat_user->nname, chat_user);
+	chat_nick_add(chat, chat_user);
+	chat->num_users++;
 
 	if (!silent) {
 		int ret;
@@ -574,35 +680,65 @@ struct chat_user *chat_user_joined(	struct pork_acct *acct,
 	return (chat_user);
 }
 
-static dlist_t *chat_find_user_node(struct pork_acct *acct,
-									struct chatroom *chat,
-									char *user)
+struct chat_user *chat_find_user(struct pork_acct *acct,
+										struct chatroom *chat,
+										char *user)
 {
-	dlist_t *cur;
+	return (hash_find(&chat->user_hash, user));
+}
 
-	cur = chat->user_list;
-	while (cur != NULL) {
-		struct chat_user *chat_user = cur->data;
+/*
+** Find the members of "chat" whose names start with the first "len"
+** characters of "prefix", ignoring case, leaving out our own name.
+** The ones who spoke most recently come first, and the rest are in
+** alphabetical order. "matches" is set to an array of copies of their
+** names, which the caller frees. Returns the number of matches.
+*/
 
-		if (!acct->proto->user_compare(user, chat_user->nname))
-			break;
+size_t chat_complete_nick(	struct pork_acct *acct,
+							struct chatroom *chat,
+							const char *prefix,
+							size_t len,
+							char ***matches)
+{
+	struct chat_user **found;
+	u_int32_t first;
+	u_int32_t last;
+	size_t num = 0;
+	size_t i;
 
-		cur = cur->next;
+	*matches = NULL;
+
+	first = chat_nick_pos(chat, prefix, len);
+	for (last = first ; last < chat->num_users ; last++) {
+		if (strncasecmp(chat->nicks[last]->nname, prefix, len))
+			break;
 	}
 
-	return (cur);
-}
+	if (first == last)
+		return (0);
 
-struct chat_user *chat_find_user(struct pork_acct *acct,
-										struct chatroom *chat,
-										char *user)
-{
-	dlist_t *cur = chat_find_user_node(acct, chat, user);
+	found = xmalloc((last - first) * sizeof(*found));
+	for (i = first ; i < last ; i++) {
+		struct chat_user *nick = chat->nicks[i];
 
-	if (cur == NULL)
-		return (NULL);
+		if (nick->nname != acct->username &&
+			acct->proto->user_compare(nick->nname, acct->username))
+		{
+			found[num++] = nick;
+		}
+	}
 
-	return (cur->data);
+	if (num > 0) {
+		qsort(found, num, sizeof(*found), chat_nick_active_cmp);
+
+		*matches = xmalloc(num * sizeof(**matches));
+		for (i = 0 ; i < num ; i++)
+			(*matches)[i] = xstrdup(found[i]->name);
+	}
+
+	free(found);
+	return (num);
 }
 
 int chat_user_left(	struct pork_acct *acct,
@@ -610,11 +746,10 @@ int chat_user_left(	struct pork_acct *acct,
 					char *user,
 					int silent)
 {
-	dlist_t *node;
-	struct chat_user *chat_user = NULL;
+	struct chat_user *chat_user;
 	int ret = 0;
 
-	node = chat_find_user_node(acct, chat, user);
+	chat_user = chat_find_user(acct, chat, user);
 
 	if (!silent) {
 		char buf[4096];
@@ -628,12 +763,13 @@ int chat_user_left(	struct pork_acct *acct,
 			MSG_TYPE_CHAT_STATUS);
 	}
 
-	if (node != NULL) {
+	if (chat_user != NULL) {
+		chat_nick_del(chat, chat_user);
 		chat->num_users--;
 
-		chat_user = node->data;
-		chat->user_list = dlist_remove(chat->user_list, node);
-		chat_destroy_user_list_cb(acct, chat_user);
+		hash_remove(&chat->user_hash, chat_user->nname);
+		ilist_remove(&chat->user_list, chat_user, link);
+		chat_free_user(acct, chat_user);
 	} else {
 		debug("unknown user %s left %s", user, chat->title_quoted);
 	}
@@ -770,13 +906,17 @@ int chat_nick_change(struct pork_acct *acct, char *old, char *new_nick) {
 					MSG_TYPE_CHAT_STATUS);
 			}
 
-			free(user->name);
-			free(user->nname);
+			hash_remove(&chat->user_hash, user->nname);
+			chat_nick_del(chat, user);
+			istr_put(user->name);
+			istr_put(user->nname);
 
-			user->name = xstrdup(new_nick);
+			user->name = istr_get(new_nick);
 
 			acct->proto->normalize(buf, new_nick, sizeof(buf));
-			user->nname = xstrdup(buf);
+			user->nname = istr_get(buf);
+			hash_add(&chat->user_hash, user->nname, user);
+			chat_nick_add(chat, user);
 		}
 
 		cur = cur->next;
@@ -27,15 +27,23 @@ struct chatroom {
 	void *data;
 	char mode[128];
 	u_int32_t num_users;
-	dlist_t *user_list;
+	ILIST_HEAD(, chat_user) user_list;
+	/* the users in user_list, by name, ignoring case */
+	hash_t user_hash;
+	/* the same users sorted by name, ignoring case, for completion */
+	struct chat_user **nicks;
+	u_int32_t nicks_size;
 	struct imwindow *win;
 };
 
 struct chat_user {
+	ILIST_LINK(chat_user) link;
 	char *name;
 	char *nname;
 	char *host;
 	u_int32_t status;
+	/* when the user last said something, or 0 if they haven't */
+	u_int32_t active;
 	u_int32_t ignore:1;
 	void *data;
 };
@@ -110,6 +118,8 @@ int chat_user_left(	struct pork_acct *acct,
 					char *user,
 					int silent);
 
+void chat_user_spoke(struct pork_acct *acct, struct chatroom *chat, char *user);
+
 int chat_got_topic(	struct pork_acct *acct,
 					struct chatroom *chat,
 					char *set_by,
@@ -150,4 +160,10 @@ int chat_got_mode(	struct pork_acct *acct,
 struct chat_user *chat_find_user(struct pork_acct *acct,
 										struct chatroom *chat,
 										char *user);
+
+size_t chat_complete_nick(	struct pork_acct *acct,
+							struct chatroom *chat,
+							const char *prefix,
+							size_t len,
+							char ***matches);
 #endif /* __NCIC_CHAT_H__ */
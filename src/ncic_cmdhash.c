@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_command.h"
+#include "ncic_cmdhash.h"
+
+/* how many displacements to try for a bucket before giving up */
+#define CMD_INDEX_MAX_DISP	(1U << 20)
+
+/*
+** Keys are hashed once. Setting bit 5 of every byte folds upper
+** case letters to lower case; it folds some punctuation together
+** too, but every match is checked with strncasecmp() anyway. The
+** low half of the hash picks the key's bucket, and the high half,
+** mixed with the bucket's displacement, picks its slot.
+*/
+
+static uint64_t cmd_hash(const char *str, size_t len) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0 ; i < len ; i++) {
+		hash ^= (unsigned char) str[i] | 0x20;
+		hash *= 0x100000001b3ULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return (hash);
+}
+
+static inline uint32_t cmd_slot(uint64_t hash, uint32_t disp, uint32_t size) {
+	uint32_t x = (uint32_t) (hash >> 32) ^ (disp * 0x9e3779b9U);
+
+	x ^= x >> 16;
+	x *= 0x85ebca6bU;
+	x ^= x >> 13;
+	return (x % size);
+}
+
+/*
+** Collect the names in "set" and their unambiguous abbreviations.
+** The set is sorted, so any other name that starts with a prefix of
+** this one is next to it.
+*/
+
+static uint32_t cmd_index_keys(	struct command *set,
+								size_t elem,
+								struct cmd_key *keys)
+{
+	uint32_t num = 0;
+	size_t i;
+
+	for (i = 0 ; i < elem ; i++) {
+		const char *name = set[i].name;
+		size_t len = strlen(name);
+		size_t plen;
+
+		for (plen = 1 ; plen < len ; plen++) {
+			if (i > 0 && !strncasecmp(set[i - 1].name, name, plen))
+				continue;
+
+			if (i + 1 < elem && !strncasecmp(set[i + 1].name, name, plen))
+				continue;
+
+			if (keys != NULL) {
+				keys[num].cmd = i;
+				keys[num].len = plen;
+			}
+			num++;
+		}
+
+		if (keys != NULL) {
+			keys[num].cmd = i;
+			keys[num].len = len;
+		}
+		num++;
+	}
+
+	return (num);
+}
+
+static int cmd_bucket_size_cmp(const void *l, const void *r) {
+	const uint32_t *a = l;
+	const uint32_t *b = r;
+
+	/* biggest first */
+	return ((a[1] < b[1]) - (a[1] > b[1]));
+}
+
+/*
+** Hash and displace: place the buckets biggest first, trying
+** displacements for each until all of its keys land in empty
+** slots.
+*/
+
+static int cmd_index_place(	struct cmd_index *index,
+							struct cmd_key *keys,
+							uint64_t *hashes)
+{
+	uint32_t num = index->num_keys;
+	uint32_t nb = index->num_buckets;
+	uint32_t (*order)[2];
+	uint32_t *bucket_keys;
+	uint32_t *start;
+	uint32_t *slots;
+	char *used;
+	uint32_t i;
+	int ret = 0;
+
+	order = xcalloc(nb, sizeof(*order));
+	start = xcalloc(nb + 1, sizeof(*start));
+	bucket_keys = xmalloc(num * sizeof(*bucket_keys));
+	slots = xmalloc(num * sizeof(*slots));
+	used = xcalloc(num, 1);
+
+	/* Lay the keys out bucket by bucket. */
+	for (i = 0 ; i < num ; i++)
+		start[(uint32_t) hashes[i] % nb + 1]++;
+
+	for (i = 0 ; i < nb ; i++) {
+		start[i + 1] += start[i];
+		order[i][0] = i;
+	}
+
+	for (i = 0 ; i < num ; i++) {
+		uint32_t b = (uint32_t) hashes[i] % nb;
+
+		bucket_keys[start[b] + order[b][1]++] = i;
+	}
+
+	qsort(order, nb, sizeof(*order), cmd_bucket_size_cmp);
+
+	for (i = 0 ; i < nb && order[i][1] > 0 ; i++) {
+		uint32_t b = order[i][0];
+		uint32_t size = order[i][1];
+		uint32_t disp;
+		uint32_t j;
+
+		for (disp = 0 ; disp < CMD_INDEX_MAX_DISP ; disp++) {
+			for (j = 0 ; j < size ; j++) {
+				uint32_t k;
+
+				slots[j] = cmd_slot(hashes[bucket_keys[start[b] + j]],
+								disp, num);
+				if (used[slots[j]])
+					break;
+
+				for (k = 0 ; k < j ; k++) {
+					if (slots[k] == slots[j])
+						break;
+				}
+
+				if (k < j)
+					break;
+			}
+
+			if (j == size)
+				break;
+		}
+
+		if (disp == CMD_INDEX_MAX_DISP) {
+			ret = -1;
+			break;
+		}
+
+		index->disp[b] = disp;
+		for (j = 0 ; j < size ; j++) {
+			used[slots[j]] = 1;
+			index->keys[slots[j]] = keys[bucket_keys[start[b] + j]];
+		}
+	}
+
+	free(used);
+	free(slots);
+	free(bucket_keys);
+	free(start);
+	free(order);
+	return (ret);
+}
+
+int cmd_index_init(struct cmd_index *index, struct command *set, size_t elem) {
+	struct cmd_key *keys;
+	uint64_t *hashes;
+	uint32_t num;
+	uint32_t i;
+	int ret;
+
+	memset(index, 0, sizeof(*index));
+	index->set = set;
+	index->elem = elem;
+
+	num = cmd_index_keys(set, elem, NULL);
+	if (num == 0)
+		return (0);
+
+	keys = xmalloc(num * sizeof(*keys));
+	hashes = xmalloc(num * sizeof(*hashes));
+	cmd_index_keys(set, elem, keys);
+
+	for (i = 0 ; i < num ; i++)
+		hashes[i] = cmd_hash(set[keys[i].cmd].name, keys[i].len);
+
+	index->num_keys = num;
+	index->num_buckets = (num + 3) / 4;
+	index->disp = xcalloc(index->num_buckets, sizeof(*index->disp));
+	index->keys = xmalloc(num * sizeof(*index->keys));
+
+	ret = cmd_index_place(index, keys, hashes);
+	if (ret != 0) {
+		debug("couldn't build a perfect hash of %u commands", num);
+		cmd_index_destroy(index);
+		index->set = set;
+		index->elem = elem;
+	}
+
+	free(hashes);
+	free(keys);
+	return (ret);
+}
+
+static int cmd_compare(const void *l, const void *r) {
+	const char *key = l;
+	const struct command *cmd = r;
+
+	return (strcasecmp(key, cmd->name));
+}
+
+/*
+** Find the command called "name", or the one "name" is an
+** unambiguous abbreviation of. An empty name only finds a command
+** whose name is empty, like the main set's entry for cmd_send.
+*/
+
+struct command *cmd_index_find(struct cmd_index *index, const char *name) {
+	struct cmd_key *key;
+	struct command *cmd;
+	uint64_t hash;
+	size_t len;
+
+	if (index->elem == 0)
+		return (NULL);
+
+	if (index->keys == NULL) {
+		return (bsearch(name, index->set, index->elem,
+					sizeof(struct command), cmd_compare));
+	}
+
+	len = strlen(name);
+	hash = cmd_hash(name, len);
+	key = &index->keys[cmd_slot(hash,
+			index->disp[(uint32_t) hash % index->num_buckets],
+			index->num_keys)];
+
+	cmd = &index->set[key->cmd];
+	if (key->len != len || strncasecmp(name, cmd->name, len))
+		return (NULL);
+
+	return (cmd);
+}
+
+/*
+** Returns non-zero if more than one command starts with "name".
+** Only used for error messages, so it doesn't need to be fast. An
+** empty name is a prefix of everything, but isn't an abbreviation.
+*/
+
+int cmd_index_ambiguous(struct cmd_index *index, const char *name) {
+	size_t len = strlen(name);
+	size_t matches = 0;
+	size_t i;
+
+	if (len == 0)
+		return (0);
+
+	for (i = 0 ; i < index->elem ; i++) {
+		if (!strncasecmp(index->set[i].name, name, len))
+			matches++;
+	}
+
+	return (matches > 1);
+}
+
+void cmd_index_destroy(struct cmd_index *index) {
+	free(index->disp);
+	free(index->keys);
+	memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_CMDHASH_H__
+#define __NCIC_CMDHASH_H__
+
+/*
+** A minimal perfect hash of the names in a sorted "struct command"
+** array, ignoring case. Every abbreviation of a name that no other
+** name in the array starts with is hashed too, so "/la" finds
+** "lastlog" with the same single probe as "/lastlog".
+*/
+
+struct command;
+
+struct cmd_key {
+	/* the command, and how much of its name this key is */
+	uint16_t cmd;
+	uint16_t len;
+};
+
+struct cmd_index {
+	struct command *set;
+	size_t elem;
+	uint32_t num_keys;
+	uint32_t num_buckets;
+	uint32_t *disp;
+	struct cmd_key *keys;
+};
+
+int cmd_index_init(struct cmd_index *index, struct command *set, size_t elem);
+struct command *cmd_index_find(struct cmd_index *index, const char *name);
+int cmd_index_ambiguous(struct cmd_index *index, const char *name);
+void cmd_index_destroy(struct cmd_index *index);
+
+#endif /* __NCIC_CMDHASH_H__ */
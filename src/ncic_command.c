@@ -19,6 +19,7 @@
 #include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_set.h"
 #include "ncic_imsg.h"
 #include "ncic_imwindow.h"
@@ -35,7 +36,13 @@
 #include "ncic_msg.h"
 #include "ncic_command.h"
 #include "ncic_command_defs.h"
+#include "ncic_cmdhash.h"
 #include "ncic_help.h"
+#include "ncic_zblock.h"
+#include "ncic_log.h"
+#include "ncic_blog.h"
+#include "ncic_grep.h"
+#include "ncic_match.h"
 
 extern struct sockaddr_storage local_addr;
 extern in_port_t local_port;
@@ -43,22 +50,24 @@ extern in_port_t local_port;
 static void print_binding(void *data, void *nothing);
 static void print_alias(void *data, void *nothing);
 static int cmd_compare(const void *l, const void *r);
-static void print_timer(void *data, void *nothing);
+static void print_timer(struct timer_entry *timer);
 static int run_one_command(char *str, u_int32_t set);
 
+/*
+** These index command_set[], and have to be in the same order.
+*/
+
 enum {
   CMDSET_MAIN,
   CMDSET_WIN,
   CMDSET_HISTORY,
   CMDSET_INPUT,
   CMDSET_SCROLL,
-  CMDSET_BUDDY,
-  CMDSET_BLIST,
   CMDSET_TIMER,
   CMDSET_CHAT,
-  CMDSET_FILE,
   CMDSET_ACCT,
-  CMDSET_PROTO,
+  CMDSET_BUDDY,
+  CMDSET_FILE,
 };
 
 /*
@@ -82,7 +91,9 @@ static struct command command[] = {
 	{ "ctcp",		cmd_ctcp			},
 	{ "disconnect", cmd_disconnect		},
 	{ "echo",		cmd_echo			},
+	{ "export",		cmd_export			},
 	{ "file",		cmd_file			},
+	{ "grep",		cmd_grep			},
 	{ "help",		cmd_help			},
 	{ "history",	cmd_history			},
 	{ "idle",		cmd_idle			},
@@ -92,6 +103,7 @@ static struct command command[] = {
 	{ "load",		cmd_load			},
 	{ "lport",		cmd_lport			},
 	{ "me",			cmd_me				},
+	{ "mem",		cmd_mem				},
 	{ "mode",		cmd_mode			},
 	{ "msg",		cmd_msg				},
 	{ "nick",		cmd_nick			},
@@ -122,6 +134,7 @@ static struct command input_command[] = {
 	{ "clear_prev_word",		cmd_input_clear_prev		},
 	{ "clear_to_end",			cmd_input_clear_to_end		},
 	{ "clear_to_start",			cmd_input_clear_to_start	},
+	{ "complete",				cmd_input_complete			},
 	{ "delete",					cmd_input_delete			},
 	{ "end",					cmd_input_end				},
 	{ "find_next_cmd",			cmd_input_find_next_cmd		},
@@ -249,6 +262,59 @@ USER_COMMAND(cmd_input_start) {
 	input_home(cur_window()->input);
 }
 
+/*
+** Complete the nick before the cursor from the members of the chat
+** room, or the command if it's the first word of a command. Doing it
+** again right away cycles through the other matches.
+*/
+
+USER_COMMAND(cmd_input_complete) {
+	struct imwindow *win = cur_window();
+	struct input *input = win->input;
+	struct chatroom *chat = NULL;
+	u_int32_t cur_pos;
+	u_int32_t word;
+	char *input_buf;
+	char **matches;
+	size_t num = 0;
+
+	if (input_complete_next(input) == 0)
+		return;
+
+	input_complete_end(input);
+
+	input_buf = input_get_buf_str(input);
+	cur_pos = input->cur - input->prompt_len;
+
+	word = cur_pos;
+	while (word > 0 && input_buf[word - 1] != ' ' && input_buf[word - 1] != '\t')
+		word--;
+
+	if (cur_pos == 0 || (input_buf[0] == '/' && word == 0)) {
+		cmd_input_find_next_cmd(args);
+		return;
+	}
+
+	if (win->type == WIN_TYPE_CHAT)
+		chat = win->data;
+	else if (win->type == WIN_TYPE_STATUS) {
+		/* The main chat lives in the status window, as in cmd_send. */
+		chat = win->data;
+		if (chat == NULL)
+			chat = screen.status_win->data;
+	}
+
+	if (chat != NULL) {
+		num = chat_complete_nick(win->owner, chat,
+				&input_buf[word], cur_pos - word, &matches);
+	}
+
+	if (num > 0)
+		input_complete_start(input, word + input->prompt_len, matches, num);
+	else if (input_buf[0] == '/')
+		cmd_input_find_next_cmd(args);
+}
+
 /*
 ** /scroll commands
 */
@@ -259,6 +325,11 @@ static struct command scroll_command[] = {
 	{ "end",			cmd_scroll_end			},
 	{ "page_down",		cmd_scroll_pgdown		},
 	{ "page_up",		cmd_scroll_pgup			},
+	{ "search",			cmd_scroll_search		},
+	{ "search_cancel",	cmd_scroll_search_cancel	},
+	{ "search_done",	cmd_scroll_search_done	},
+	{ "search_next",	cmd_scroll_search_next	},
+	{ "search_prev",	cmd_scroll_search_prev	},
 	{ "start",			cmd_scroll_start		},
 	{ "up",				cmd_scroll_up			},
 };
@@ -293,6 +364,50 @@ USER_COMMAND(cmd_scroll_pgup) {
 	imwindow_scroll_page_up(cur_window());
 }
 
+USER_COMMAND(cmd_scroll_search) {
+	struct imwindow *imwindow = cur_window();
+	uint32_t opts = 0;
+
+	if (args != NULL && *args == '-') {
+		char *flags = strsep(&args, " ");
+
+		while (*++flags != '\0') {
+			switch (*flags) {
+				case 'b':
+					opts |= SWINDOW_FIND_BASIC;
+					break;
+
+				case 'i':
+					opts |= SWINDOW_FIND_ICASE;
+					break;
+			}
+		}
+	}
+
+	imwindow_search_start(imwindow, opts);
+
+	if (args != NULL && !blank_str(args)) {
+		input_insert_str(imwindow->input, args);
+		imwindow_search_update(imwindow);
+	}
+}
+
+USER_COMMAND(cmd_scroll_search_cancel) {
+	imwindow_search_end(cur_window(), 1);
+}
+
+USER_COMMAND(cmd_scroll_search_done) {
+	imwindow_search_end(cur_window(), 0);
+}
+
+USER_COMMAND(cmd_scroll_search_next) {
+	imwindow_search_next(cur_window(), SWINDOW_SEARCH_OLDER);
+}
+
+USER_COMMAND(cmd_scroll_search_prev) {
+	imwindow_search_next(cur_window(), SWINDOW_SEARCH_NEWER);
+}
+
 USER_COMMAND(cmd_scroll_start) {
 	imwindow_scroll_start(cur_window());
 }
@@ -745,7 +860,7 @@ USER_COMMAND(cmd_timer_add) {
 	if (p == NULL)
 		return;
 
-	if (str_to_uint(p, &interval) != 0) {
+	if (str_to_msec(p, &interval) != 0) {
 		screen_err_msg("Invalid timer interval: %s", p);
 		return;
 	}
@@ -798,11 +913,14 @@ USER_COMMAND(cmd_timer_del_refnum) {
 }
 
 USER_COMMAND(cmd_timer_list) {
-	dlist_iterate(screen.timer_list, print_timer, NULL);
+	u_int32_t i;
+
+	for (i = 0 ; i < screen.timer_list.num ; i++)
+		print_timer(screen.timer_list.heap[i]);
 }
 
 USER_COMMAND(cmd_timer_purge) {
-	if (screen.timer_list != NULL) {
+	if (screen.timer_list.num > 0) {
 		timer_destroy(&screen.timer_list);
 		screen_cmd_output("All timers have been removed");
 	}
@@ -1070,6 +1188,7 @@ static struct command_set {
 	struct command *set;
 	size_t elem;
 	char *type;
+	struct cmd_index index;
 } command_set[] = {
 	{	command,			array_elem(command),			"" 			},
 	{	window_command,		array_elem(window_command),		"win "		},
@@ -1079,8 +1198,32 @@ static struct command_set {
 	{	timer_command,		array_elem(timer_command),		"timer "	},
 	{	chat_command,		array_elem(chat_command),		"chat "		},
 	{	acct_command,		array_elem(acct_command),		"acct "		},
+	/* These don't have any commands yet. */
+	{	NULL,				0,								"buddy "	},
+	{	NULL,				0,								"file "		},
 };
 
+/*
+** Index every command set. Must be called before any
+** commands are run.
+*/
+
+void command_init(void) {
+	size_t i;
+
+	for (i = 0 ; i < array_elem(command_set) ; i++) {
+		cmd_index_init(&command_set[i].index,
+			command_set[i].set, command_set[i].elem);
+	}
+}
+
+void command_destroy(void) {
+	size_t i;
+
+	for (i = 0 ; i < array_elem(command_set) ; i++)
+		cmd_index_destroy(&command_set[i].index);
+}
+
 /*
 ** Main command set.
 */
@@ -1163,6 +1306,8 @@ USER_COMMAND(cmd_bind) {
 	if (key_str[0] == '-' && key_str[1] != '\0') {
 		if (!strcasecmp(key_str, "-b") || !strcasecmp(key_str, "-buddy"))
 			target_binds = &screen.binds.blist;
+		else if (!strcasecmp(key_str, "-s") || !strcasecmp(key_str, "-search"))
+			target_binds = &screen.binds.search;
 		else if (!strcasecmp(key_str, "-m") || !strcasecmp(key_str, "-main"))
 			target_binds = &screen.binds.main;
 		else {
@@ -1257,6 +1402,89 @@ USER_COMMAND(cmd_echo) {
 		screen_win_msg(cur_window(), 0, 0, 1, MSG_TYPE_CMD_OUTPUT, args);
 }
 
+USER_COMMAND(cmd_export) {
+	char *logfile = cur_window()->swindow.logfile;
+	char *sender = NULL;
+	char *from_str;
+	char *to_str;
+	char path[PATH_MAX];
+	char outpath[PATH_MAX];
+	time_t from;
+	time_t to;
+	FILE *out;
+	int ret;
+
+	if (args == NULL)
+		return;
+
+	while (*args == '-') {
+		char *flag = strsep(&args, " ");
+
+		if (args == NULL)
+			return;
+
+		if (!strcmp(flag, "-l"))
+			logfile = strsep(&args, " ");
+		else if (!strcmp(flag, "-s"))
+			sender = strsep(&args, " ");
+		else {
+			screen_err_msg("Unknown flag: %s", flag);
+			return;
+		}
+
+		if (args == NULL)
+			return;
+	}
+
+	from_str = strsep(&args, " ");
+	to_str = strsep(&args, " ");
+	if (to_str == NULL || args == NULL || blank_str(args))
+		return;
+
+	if (logfile == NULL) {
+		screen_err_msg("No logfile has been specified for this window");
+		return;
+	}
+
+	if (blog_parse_time(from_str, 0, &from) != 0) {
+		screen_err_msg("Invalid time: %s", from_str);
+		return;
+	}
+
+	if (blog_parse_time(to_str, 1, &to) != 0) {
+		screen_err_msg("Invalid time: %s", to_str);
+		return;
+	}
+
+	expand_path(logfile, path, sizeof(path));
+	expand_path(args, outpath, sizeof(outpath));
+
+	out = fopen(outpath, "w");
+	if (out == NULL) {
+		screen_err_msg("Unable to open %s for writing: %s",
+			outpath, strerror(errno));
+		return;
+	}
+
+	ret = blog_export(path, from, to, sender, out);
+	if (ret == -1) {
+		if (errno == EINVAL)
+			screen_err_msg("%s is not a binary log", path);
+		else
+			screen_err_msg("Error reading %s: %s", path, strerror(errno));
+	}
+
+	if (fclose(out) != 0 && ret != -1) {
+		screen_err_msg("Error writing %s: %s", outpath, strerror(errno));
+		return;
+	}
+
+	if (ret != -1) {
+		screen_cmd_output("Exported %d message%s to %s",
+			ret, (ret == 1 ? "" : "s"), outpath);
+	}
+}
+
 USER_COMMAND(cmd_disconnect) {
 	struct pork_acct *acct = cur_window()->owner;
 	u_int32_t dest;
@@ -1296,6 +1524,74 @@ USER_COMMAND(cmd_disconnect) {
 		imwindow_bind_next_acct(screen.status_win);
 }
 
+USER_COMMAND(cmd_grep) {
+	char dir[PATH_MAX];
+	uint32_t flags = 0;
+	int all = 0;
+
+	expand_path(opt_get_str(OPT_NCIC_DIR), dir, sizeof(dir));
+
+	if (args == NULL || blank_str(args)) {
+		screen_err_msg("Usage: grep [-abi] [-c] [-d dir] <regex>");
+		return;
+	}
+
+	while (*args == '-') {
+		char *flag = strsep(&args, " ");
+		char *p;
+
+		if (!strcmp(flag, "-c")) {
+			if (grep_cancel() != 0)
+				screen_err_msg("No search is running");
+			return;
+		}
+
+		if (!strcmp(flag, "--") || args == NULL)
+			break;
+
+		if (!strcmp(flag, "-d")) {
+			char *path = strsep(&args, " ");
+
+			if (path == NULL || args == NULL)
+				return;
+
+			expand_path(path, dir, sizeof(dir));
+			all = 1;
+			continue;
+		}
+
+		for (p = flag + 1 ; *p != '\0' ; p++) {
+			switch (*p) {
+				case 'a':
+					all = 1;
+					break;
+
+				case 'b':
+					flags |= MATCH_BASIC;
+					break;
+
+				case 'i':
+					flags |= MATCH_ICASE;
+					break;
+
+				default:
+					screen_err_msg("Unknown flag: -%c", *p);
+					return;
+			}
+		}
+	}
+
+	if (args == NULL || *args == '\0')
+		return;
+
+	if (grep_start(dir, all, args, flags) != 0) {
+		if (errno == EINVAL)
+			screen_err_msg("Invalid regular expression: %s", args);
+		else
+			screen_err_msg("Unable to open the %s window", GREP_WINDOW);
+	}
+}
+
 USER_COMMAND(cmd_help) {
 	char *section;
 
@@ -1378,6 +1674,7 @@ USER_COMMAND(cmd_laddr) {
 
 USER_COMMAND(cmd_lastlog) {
 	int opts = 0;
+	int all = 0;
 
 	if (args == NULL)
 		return;
@@ -1394,6 +1691,10 @@ USER_COMMAND(cmd_lastlog) {
 
 		do {
 			switch (*args) {
+				case 'a':
+					all = 1;
+					break;
+
 				case 'b':
 					opts |= SWINDOW_FIND_BASIC;
 					break;
@@ -1411,7 +1712,18 @@ USER_COMMAND(cmd_lastlog) {
 	}
 done:
 
-	if (*args != '\0')
+	if (*args == '\0')
+		return;
+
+	if (all) {
+		struct imwindow *win = grep_window();
+
+		if (win == NULL)
+			return;
+
+		screen_goto_window(win->refnum);
+		imwindow_buffer_find_all(win, args, opts);
+	} else
 		imwindow_buffer_find(cur_window(), args, opts);
 }
 
@@ -1464,6 +1776,79 @@ USER_COMMAND(cmd_me) {
 	}
 }
 
+USER_COMMAND(cmd_mem) {
+	uint32_t budget = opt_get_int(OPT_SCROLLBUF_MEM);
+	dlist_t *cur;
+	struct log_stats lstats;
+	struct istr_stats istats;
+
+	screen_cmd_output("REFNUM\t\tNAME\t\tLINES\t\tBYTES");
+	cur = screen.window_list;
+	do {
+		struct imwindow *imwindow = cur->data;
+
+		screen_cmd_output("%u\t\t\t%s\t\t%u\t\t%llu",
+			imwindow->refnum, imwindow->name,
+			imwindow->swindow.scrollbuf_len,
+			(unsigned long long) imwindow->swindow.scrollbuf_bytes);
+
+		cur = cur->next;
+	} while (cur != screen.window_list);
+
+	if (budget == 0)
+		screen_cmd_output("Scroll buffers: %llu bytes",
+			(unsigned long long) swindow_total_bytes());
+	else {
+		screen_cmd_output("Scroll buffers: %llu bytes of %llu",
+			(unsigned long long) swindow_total_bytes(),
+			(unsigned long long) budget * 1024);
+	}
+
+	if (zstats.blocks == 0)
+		screen_cmd_output("No scroll buffer text is compressed");
+	else {
+		uint64_t ratio = zstats.raw_bytes * 10 / zstats.bytes;
+
+		screen_cmd_output("Compressed scroll buffer: %u blocks, %llu bytes stored in %llu bytes (%llu.%llu:1)",
+			zstats.blocks,
+			(unsigned long long) zstats.raw_bytes,
+			(unsigned long long) zstats.bytes,
+			(unsigned long long) ratio / 10,
+			(unsigned long long) ratio % 10);
+	}
+
+	if (zstats.thawed > 0) {
+		screen_cmd_output("%u blocks decompressed, %llu usec on average, %u usec at most",
+			zstats.thawed,
+			(unsigned long long) (zstats.thaw_usec / zstats.thawed),
+			zstats.thaw_max_usec);
+	}
+
+	log_get_stats(&lstats);
+	if (lstats.msgs > 0) {
+		screen_cmd_output("Logs: %llu messages, %llu bytes in %llu writes, %llu syncs, %llu dropped",
+			(unsigned long long) lstats.msgs,
+			(unsigned long long) lstats.bytes,
+			(unsigned long long) lstats.writes,
+			(unsigned long long) lstats.syncs,
+			(unsigned long long) lstats.dropped);
+	}
+
+	if (lstats.rotations > 0) {
+		screen_cmd_output("Logs: %llu rotated",
+			(unsigned long long) lstats.rotations);
+	}
+
+	istr_get_stats(&istats);
+	if (istats.strings > 0) {
+		screen_cmd_output("Names: %u stored in %llu bytes, %llu references, %llu bytes saved by sharing",
+			istats.strings,
+			(unsigned long long) istats.bytes,
+			(unsigned long long) istats.refs,
+			(unsigned long long) istats.saved);
+	}
+}
+
 USER_COMMAND(cmd_msg) {
 	struct pork_acct *acct = cur_window()->owner;
 	char *target;
@@ -1510,6 +1895,13 @@ USER_COMMAND(cmd_quit) {
 }
 
 USER_COMMAND(cmd_refresh) {
+	if (args != NULL && !strcasecmp(args, "stats")) {
+		screen_cmd_output("%u frames drawn, %u updates merged into later frames (MAX_FPS is %u)",
+			screen.render.frames, screen.render.skipped,
+			opt_get_int(OPT_MAX_FPS));
+		return;
+	}
+
 	screen_refresh();
 }
 
@@ -1538,7 +1930,14 @@ USER_COMMAND(cmd_send) {
 		} else
 			chat_send_msg(acct, chat, chat->title, args);
 	} else if (imwindow->type == WIN_TYPE_STATUS) {
-		chat_send_msg(acct, imwindow->data, "main", args);
+		struct chatroom *chat = imwindow->data;
+
+		/* Windows like the grep window talk to the main chat. */
+		if (chat == NULL)
+			chat = screen.status_win->data;
+
+		if (chat != NULL)
+			chat_send_msg(acct, chat, "main", args);
 	}
 }
 
@@ -1555,6 +1954,8 @@ USER_COMMAND(cmd_unbind) {
 	if (binding[0] == '-' && binding[1] != '\0') {
 		if (!strcasecmp(binding, "-b") || !strcasecmp(binding, "-buddy"))
 			target_binds = &screen.binds.blist;
+		else if (!strcasecmp(binding, "-s") || !strcasecmp(binding, "-search"))
+			target_binds = &screen.binds.search;
 		else if (!strcasecmp(binding, "-m") || !strcasecmp(binding, "-main"))
 			target_binds = &screen.binds.main;
 		else {
@@ -1785,10 +2186,10 @@ static int run_one_command(char *str, u_int32_t set) {
 
 	cmd_str = strsep(&str, " \t");
 
-	cmd = bsearch(cmd_str, command_set[set].set, command_set[set].elem,
-			sizeof(struct command), cmd_compare);
+	cmd = cmd_index_find(&command_set[set].index, cmd_str);
 
-	if (cmd == NULL) {
+	/* A protocol's name wins over an abbreviation of a command. */
+	if (cmd == NULL || cmd->name[strlen(cmd_str)] != '\0') {
 		struct pork_proto *proto;
 
 		if (set == CMDSET_MAIN && (proto = proto_get_name(cmd_str)) != NULL) {
@@ -1799,11 +2200,21 @@ static int run_one_command(char *str, u_int32_t set) {
 
 			if (cmd == NULL)
 				screen_err_msg("Unknown %s command: %s", proto->name, cmd_str);
+			else
+				cmd->cmd(str);
+
+			return (cmd == NULL ? -1 : 0);
+		}
+	}
+
+	if (cmd == NULL) {
+		if (cmd_index_ambiguous(&command_set[set].index, cmd_str)) {
+			screen_err_msg("Ambiguous %scommand: %s",
+				command_set[set].type, cmd_str);
 		} else {
 			screen_err_msg("Unknown %scommand: %s",
 				command_set[set].type, cmd_str);
 		}
-
 		return (-1);
 	}
 
@@ -1833,11 +2244,14 @@ static int cmd_compare(const void *l, const void *r) {
 	return (strcasecmp(key, cmd->name));
 }
 
-static void print_timer(void *data, void *nothing __notused) {
-	struct timer_entry *timer = data;
-
-	screen_cmd_output("[refnum: %u] %d %u %s", timer->refnum,
-		(int) timer->interval, timer->times, timer->command);
+static void print_timer(struct timer_entry *timer) {
+	if (timer->interval % 1000 == 0) {
+		screen_cmd_output("[refnum: %u] %u %u %s", timer->refnum,
+			timer->interval / 1000, timer->times, timer->command);
+	} else {
+		screen_cmd_output("[refnum: %u] %ums %u %s", timer->refnum,
+			timer->interval, timer->times, timer->command);
+	}
 }
 
 USER_COMMAND(cmd_input_find_next_cmd) {
@@ -18,6 +18,8 @@ struct command {
 	void (*cmd)(char *);
 };
 
+void command_init(void);
+void command_destroy(void);
 int run_mcommand(char *str);
 int run_command(char *str);
 
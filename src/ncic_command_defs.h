@@ -25,6 +25,8 @@ USER_COMMAND(cmd_ctcp);
 USER_COMMAND(cmd_disconnect);
 USER_COMMAND(cmd_echo);
 USER_COMMAND(cmd_eval);
+USER_COMMAND(cmd_export);
+USER_COMMAND(cmd_grep);
 USER_COMMAND(cmd_help);
 USER_COMMAND(cmd_idle);
 USER_COMMAND(cmd_laddr);
@@ -32,6 +34,7 @@ USER_COMMAND(cmd_lastlog);
 USER_COMMAND(cmd_load);
 USER_COMMAND(cmd_lport);
 USER_COMMAND(cmd_me);
+USER_COMMAND(cmd_mem);
 USER_COMMAND(cmd_mode);
 USER_COMMAND(cmd_msg);
 USER_COMMAND(cmd_nick);
@@ -86,6 +89,11 @@ USER_COMMAND(cmd_scroll_down);
 USER_COMMAND(cmd_scroll_end);
 USER_COMMAND(cmd_scroll_pgdown);
 USER_COMMAND(cmd_scroll_pgup);
+USER_COMMAND(cmd_scroll_search);
+USER_COMMAND(cmd_scroll_search_cancel);
+USER_COMMAND(cmd_scroll_search_done);
+USER_COMMAND(cmd_scroll_search_next);
+USER_COMMAND(cmd_scroll_search_prev);
 USER_COMMAND(cmd_scroll_start);
 USER_COMMAND(cmd_scroll_up);
 
@@ -96,6 +104,7 @@ USER_COMMAND(cmd_input_clear_prev);
 USER_COMMAND(cmd_input_clear_next);
 USER_COMMAND(cmd_input_clear_to_end);
 USER_COMMAND(cmd_input_clear_to_start);
+USER_COMMAND(cmd_input_complete);
 USER_COMMAND(cmd_input_delete);
 USER_COMMAND(cmd_input_end);
 USER_COMMAND(cmd_input_find_next_cmd);
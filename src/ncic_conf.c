@@ -22,6 +22,7 @@
 #include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_imwindow.h"
 #include "ncic_acct.h"
 #include "ncic_misc.h"
@@ -32,7 +33,7 @@
 #include "ncic_command.h"
 #include "ncic_conf.h"
 
-static int pork_mkdir(const char *path) {
+int pork_mkdir(const char *path) {
 	struct stat st;
 
 	if (stat(path, &st) != 0) {
@@ -139,8 +140,8 @@ static int read_acct_conf(struct pork_acct *acct, const char *filename) {
 			p++;
 
 		if (!strcasecmp(buf, "username")) {
-			free(acct->username);
-			acct->username = xstrdup(p);
+			istr_put(acct->username);
+			acct->username = istr_get(p);
 		} else if (!strcasecmp(buf, "password")) {
 			if (acct->passwd != NULL) {
 				memset(acct->passwd, 0, strlen(acct->passwd));
@@ -310,6 +311,15 @@ static void write_bind_blist_line(void *data, void *filep) {
 	fprintf(fp, "bind -buddy %s %s\n", key_name, binding->binding);
 }
 
+static void write_bind_search_line(void *data, void *filep) {
+	struct binding *binding = data;
+	FILE *fp = filep;
+	char key_name[32];
+
+	bind_get_keyname(binding->key, key_name, sizeof(key_name));
+	fprintf(fp, "bind -search %s %s\n", key_name, binding->binding);
+}
+
 int save_global_config(void) {
 	char porkrc[PATH_MAX];
 	char *fn;
@@ -339,6 +349,8 @@ int save_global_config(void) {
 	hash_iterate(&screen.binds.main.hash, write_bind_line, fp);
 	fprintf(fp, "\n");
 	hash_iterate(&screen.binds.blist.hash, write_bind_blist_line, fp);
+	fprintf(fp, "\n");
+	hash_iterate(&screen.binds.search.hash, write_bind_search_line, fp);
 
 	fclose(fp);
 
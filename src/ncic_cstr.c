@@ -54,13 +54,23 @@ inline size_t cstrlen(chtype *ch) {
 
 char *cstr_to_plaintext(chtype *cstr, size_t len) {
 	char *str = xmalloc(len + 1);
+
+	str[cstr_copy_plaintext(str, cstr, len)] = '\0';
+	return (str);
+}
+
+/*
+** Like cstr_to_plaintext(), but into "str", which has room for "len"
+** characters. No NUL is added. Returns the number of characters copied.
+*/
+
+size_t cstr_copy_plaintext(char *str, const chtype *cstr, size_t len) {
 	size_t i;
 
 	for (i = 0 ; i < len && cstr[i] != 0 ; i++)
 		str[i] = chtype_get(cstr[i]);
 
-	str[i] = '\0';
-	return (str);
+	return (i);
 }
 
 /*
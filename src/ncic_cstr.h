@@ -20,6 +20,7 @@
 size_t cstrlen(chtype *ch);
 chtype *cstrndup(chtype *ch, size_t len);
 char *cstr_to_plaintext(chtype *cstr, size_t n);
+size_t cstr_copy_plaintext(char *str, const chtype *cstr, size_t len);
 
 int plaintext_to_cstr(chtype *ch, size_t len, ...);
 int plaintext_to_cstr_nocolor(chtype *ch, size_t len, ...);
@@ -0,0 +1,645 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "config.h"
+
+#include <unistd.h>
+#include <ncurses.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "ncic_io.h"
+#include "ncic_imsg.h"
+#include "ncic_imwindow.h"
+#include "ncic_proto.h"
+#include "ncic_acct.h"
+#include "ncic_screen.h"
+#include "ncic_screen_io.h"
+#include "ncic_match.h"
+#include "ncic_pool.h"
+#include "ncic_blog.h"
+#include "ncic_grep.h"
+
+struct grep_file {
+	char *name;
+	char *map;
+	size_t size;
+	uint32_t binary:1;
+	/* chunks that haven't been shown yet; it's unmapped at 0 */
+	uint32_t chunks;
+};
+
+/*
+** A worker fills in "out" with the matching lines, each ending in a
+** newline, then sets "done".
+*/
+
+struct grep_chunk {
+	struct grep_file *file;
+	size_t start;
+	size_t end;
+
+	char *out;
+	size_t len;
+	size_t size;
+	uint32_t hits;
+	uint32_t done:1;
+};
+
+struct grep {
+	struct match match;
+	struct grep_file **files;
+	size_t num_files;
+	struct grep_chunk *chunks;
+	size_t num_chunks;
+	uint64_t bytes;
+
+	/* the next chunk for a worker to take; protected by greplock */
+	size_t next;
+	int cancel;
+
+	/* chunks that have been shown, in order; main thread only */
+	size_t shown;
+	uint32_t hits;
+	uint32_t refnum;
+	struct timeval started;
+
+	pthread_t threads[POOL_MAX_THREADS];
+	uint32_t num_threads;
+};
+
+/*
+** Only one search runs at a time. Workers write a byte to the pipe
+** when they finish a chunk, which wakes up the main loop to show it.
+*/
+
+static struct grep *cur_grep;
+static pthread_mutex_t greplock = PTHREAD_MUTEX_INITIALIZER;
+static int gpipe[2] = { -1, -1 };
+
+static void grep_emit(	struct grep_chunk *chunk,
+						const char *prefix,
+						size_t prefix_len,
+						const char *line,
+						size_t len)
+{
+	const char *name = chunk->file->name;
+	size_t name_len = strlen(name);
+	size_t need;
+
+	if (len > 0 && line[len - 1] == '\r')
+		len--;
+
+	need = name_len + 2 + prefix_len + len + 1;
+	if (chunk->len + need > chunk->size) {
+		chunk->size = max(chunk->size * 2, chunk->len + need);
+		chunk->out = xrealloc(chunk->out, chunk->size);
+	}
+
+	memcpy(chunk->out + chunk->len, name, name_len);
+	chunk->len += name_len;
+	memcpy(chunk->out + chunk->len, ": ", 2);
+	chunk->len += 2;
+	memcpy(chunk->out + chunk->len, prefix, prefix_len);
+	chunk->len += prefix_len;
+	memcpy(chunk->out + chunk->len, line, len);
+	chunk->len += len;
+	chunk->out[chunk->len++] = '\n';
+	chunk->hits++;
+}
+
+/*
+** A chunk of a text file is made of the lines that start in it. For
+** plain strings, the whole chunk is searched at once, and a line is
+** only looked at when there's a match in it.
+*/
+
+static void grep_text(struct grep *grep, struct grep_chunk *chunk) {
+	const char *map = chunk->file->map;
+	const char *eof = map + chunk->file->size;
+	const char *p = map + chunk->start;
+	const char *limit;
+
+	if (p > map && p[-1] != '\n') {
+		p = memchr(p, '\n', eof - p);
+		if (p == NULL)
+			return;
+		p++;
+	}
+
+	limit = map + chunk->end;
+	if (limit < eof) {
+		limit = memchr(limit - 1, '\n', eof - (limit - 1));
+		limit = (limit == NULL) ? eof : limit + 1;
+	}
+
+	while (p < limit) {
+		const char *line = p;
+		const char *nl;
+
+		if (grep->match.literal != NULL) {
+			ssize_t off = match_find(&grep->match, p, limit - p);
+
+			if (off == -1)
+				break;
+
+			line = p + off;
+			while (line > p && line[-1] != '\n')
+				line--;
+		}
+
+		nl = memchr(line, '\n', limit - line);
+		if (nl == NULL)
+			nl = limit;
+
+		if (grep->match.literal != NULL ||
+			match_exec_len(&grep->match, line, nl - line))
+		{
+			grep_emit(chunk, "", 0, line, nl - line);
+		}
+
+		p = nl + 1;
+	}
+}
+
+static void grep_binary(struct grep *grep, struct grep_chunk *chunk) {
+	const char *map = chunk->file->map;
+	size_t size = chunk->file->size;
+	size_t off = chunk->start;
+
+	while (off < chunk->end && size - off >= BLOG_HDR_LEN + BLOG_TRAILER_LEN) {
+		const unsigned char *p = (const unsigned char *) map + off;
+		uint32_t len = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+		struct blog_rec rec;
+
+		if (len > size - off || blog_parse_rec(map + off, len, &rec) != 0)
+			break;
+
+		if (match_exec_len(&grep->match, rec.text, rec.text_len)) {
+			char timebuf[32];
+			struct tm tm;
+			size_t n;
+
+			localtime_r(&rec.time, &tm);
+			n = strftime(timebuf, sizeof(timebuf), "[%Y-%m-%d %H:%M:%S] ", &tm);
+			grep_emit(chunk, timebuf, n, rec.text, rec.text_len);
+		}
+
+		off += len;
+	}
+}
+
+static void *grep_thread(void *arg) {
+	struct grep *grep = arg;
+
+	while (1) {
+		struct grep_chunk *chunk;
+
+		pthread_mutex_lock(&greplock);
+		if (grep->cancel || grep->next == grep->num_chunks) {
+			pthread_mutex_unlock(&greplock);
+			break;
+		}
+
+		chunk = &grep->chunks[grep->next++];
+		pthread_mutex_unlock(&greplock);
+
+		if (chunk->file->binary)
+			grep_binary(grep, chunk);
+		else
+			grep_text(grep, chunk);
+
+		pthread_mutex_lock(&greplock);
+		chunk->done = 1;
+		pthread_mutex_unlock(&greplock);
+
+		if (write(gpipe[1], "", 1) == -1 && errno != EAGAIN)
+			debug("write: %s", strerror(errno));
+	}
+
+	return (NULL);
+}
+
+static void grep_file_free(struct grep_file *file) {
+	if (file->map != NULL)
+		munmap(file->map, file->size);
+
+	free(file->name);
+	free(file);
+}
+
+static void grep_free(struct grep *grep) {
+	size_t i;
+
+	for (i = 0 ; i < grep->num_chunks ; i++)
+		free(grep->chunks[i].out);
+
+	for (i = 0 ; i < grep->num_files ; i++)
+		grep_file_free(grep->files[i]);
+
+	match_free(&grep->match);
+	free(grep->chunks);
+	free(grep->files);
+	free(grep);
+}
+
+static void grep_join(struct grep *grep) {
+	uint32_t i;
+
+	for (i = 0 ; i < grep->num_threads ; i++)
+		pthread_join(grep->threads[i], NULL);
+
+	grep->num_threads = 0;
+}
+
+/*
+** Show the chunks that have been searched since the last call, up to
+** the first one that's still being worked on.
+*/
+
+static void grep_show(struct grep *grep) {
+	struct imwindow *win = imwindow_find_refnum(grep->refnum);
+	size_t ready = grep->shown;
+
+	pthread_mutex_lock(&greplock);
+	while (ready < grep->num_chunks && grep->chunks[ready].done)
+		ready++;
+	pthread_mutex_unlock(&greplock);
+
+	for (; grep->shown < ready ; grep->shown++) {
+		struct grep_chunk *chunk = &grep->chunks[grep->shown];
+		char *p = chunk->out;
+		char *end = chunk->out + chunk->len;
+
+		while (win != NULL && p < end) {
+			char *nl = memchr(p, '\n', end - p);
+
+			imwindow_add(win, imsg_new_plain(&win->swindow, p, nl - p),
+				MSG_TYPE_LASTLOG);
+			p = nl + 1;
+		}
+
+		grep->hits += chunk->hits;
+		free(chunk->out);
+		chunk->out = NULL;
+
+		/* Let go of each file as soon as it's been shown. */
+		if (--chunk->file->chunks == 0) {
+			munmap(chunk->file->map, chunk->file->size);
+			chunk->file->map = NULL;
+		}
+	}
+
+	if (grep->shown == grep->num_chunks) {
+		struct timeval now;
+		double msec;
+
+		grep_join(grep);
+		gettimeofday(&now, NULL);
+		msec = (now.tv_sec - grep->started.tv_sec) * 1000.0 +
+			(now.tv_usec - grep->started.tv_usec) / 1000.0;
+
+		if (win != NULL) {
+			screen_win_msg(win, 1, 1, 1, MSG_TYPE_CMD_OUTPUT,
+				"%u match%s in %u file%s (%.1f MB, %.0f ms)",
+				grep->hits, (grep->hits == 1 ? "" : "es"),
+				(uint32_t) grep->num_files, (grep->num_files == 1 ? "" : "s"),
+				grep->bytes / (1024.0 * 1024.0), msec);
+		}
+
+		cur_grep = NULL;
+		grep_free(grep);
+	}
+}
+
+static void grep_finished(int fd, u_int32_t cond __notused, void *data __notused) {
+	char buf[64];
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	if (cur_grep != NULL)
+		grep_show(cur_grep);
+}
+
+/*
+** Log files are the ones in a "logs" directory (where they're put by
+** default) or with names ending in ".log", unless "all" is set.
+** Indexes of binary logs are never searched.
+*/
+
+static int grep_wanted(const char *name, int in_logs, int all) {
+	size_t len = strlen(name);
+
+	if (len > 4 && !strcmp(name + len - 4, ".idx"))
+		return (0);
+
+	/* Nor are compressed logs, or ones that are being compressed. */
+	if ((len > 3 && !strcmp(name + len - 3, ".gz")) ||
+		(len > 7 && !strcmp(name + len - 7, ".gz.tmp")))
+	{
+		return (0);
+	}
+
+	return (all || in_logs || (len > 4 && !strcmp(name + len - 4, ".log")));
+}
+
+static void grep_add_file(struct grep *grep, const char *path, const char *name) {
+	struct grep_file *file;
+	struct stat st;
+	char *map;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return;
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		debug("mmap %s: %s", path, strerror(errno));
+		return;
+	}
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	file = xcalloc(1, sizeof(*file));
+	file->name = xstrdup(name);
+	file->map = map;
+	file->size = st.st_size;
+	file->binary = (file->size >= BLOG_MAGIC_LEN &&
+					!memcmp(map, BLOG_MAGIC, BLOG_MAGIC_LEN));
+
+	grep->files = xrealloc(grep->files,
+					(grep->num_files + 1) * sizeof(*grep->files));
+	grep->files[grep->num_files++] = file;
+	grep->bytes += file->size;
+
+	if (file->binary) {
+		uint64_t *offsets;
+		size_t num;
+		size_t i;
+
+		num = blog_chunks(path, file->size, GREP_CHUNK, &offsets);
+		grep->chunks = xrealloc(grep->chunks,
+						(grep->num_chunks + num) * sizeof(*grep->chunks));
+
+		for (i = 0 ; i < num ; i++) {
+			struct grep_chunk *chunk = &grep->chunks[grep->num_chunks++];
+
+			memset(chunk, 0, sizeof(*chunk));
+			chunk->file = file;
+			chunk->start = offsets[i];
+			chunk->end = (i + 1 < num) ? offsets[i + 1] : file->size;
+		}
+
+		file->chunks = num;
+		free(offsets);
+	} else {
+		size_t off;
+
+		for (off = 0 ; off < file->size ; off += GREP_CHUNK) {
+			struct grep_chunk *chunk;
+
+			grep->chunks = xrealloc(grep->chunks,
+							(grep->num_chunks + 1) * sizeof(*grep->chunks));
+			chunk = &grep->chunks[grep->num_chunks++];
+
+			memset(chunk, 0, sizeof(*chunk));
+			chunk->file = file;
+			chunk->start = off;
+			chunk->end = min(off + GREP_CHUNK, file->size);
+			file->chunks++;
+		}
+	}
+}
+
+static int grep_name_cmp(const void *l, const void *r) {
+	return (strcmp(*(char * const *) l, *(char * const *) r));
+}
+
+/*
+** Add the files under "path" to the search, in order by name. "name"
+** is the path relative to the directory the search started in.
+*/
+
+static void grep_walk(	struct grep *grep,
+						const char *path,
+						const char *name,
+						int in_logs,
+						int all)
+{
+	struct dirent *ent;
+	char **names = NULL;
+	size_t num = 0;
+	size_t i;
+	DIR *dir;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		names = xrealloc(names, (num + 1) * sizeof(*names));
+		names[num++] = xstrdup(ent->d_name);
+	}
+
+	closedir(dir);
+	qsort(names, num, sizeof(*names), grep_name_cmp);
+
+	for (i = 0 ; i < num ; i++) {
+		char subpath[PATH_MAX];
+		char subname[PATH_MAX];
+		struct stat st;
+
+		snprintf(subpath, sizeof(subpath), "%s/%s", path, names[i]);
+		if (name != NULL)
+			snprintf(subname, sizeof(subname), "%s/%s", name, names[i]);
+		else
+			xstrncpy(subname, names[i], sizeof(subname));
+
+		/* Don't follow links to directories, which could loop. */
+		if (lstat(subpath, &st) != 0)
+			goto next;
+
+		if (S_ISDIR(st.st_mode)) {
+			/* Scroll buffer spill segments aren't logs. */
+			if (name != NULL || strcmp(names[i], "spill")) {
+				grep_walk(grep, subpath, subname,
+					in_logs || !strcmp(names[i], "logs"), all);
+			}
+		} else if (grep_wanted(names[i], in_logs, all))
+			grep_add_file(grep, subpath, subname);
+
+next:
+		free(names[i]);
+	}
+
+	free(names);
+}
+
+/*
+** The window search results go to: the one the running search is
+** using, or the "grep" window, which is created if there isn't one.
+*/
+
+struct imwindow *grep_window(void) {
+	struct imwindow *win = NULL;
+
+	if (cur_grep != NULL)
+		win = imwindow_find_refnum(cur_grep->refnum);
+
+	if (win == NULL)
+		win = imwindow_find_name(cur_window()->owner, GREP_WINDOW);
+
+	if (win == NULL)
+		win = screen_new_status_window(cur_window()->owner, GREP_WINDOW);
+
+	return (win);
+}
+
+static int grep_init(void) {
+	if (gpipe[0] != -1)
+		return (0);
+
+	if (pipe(gpipe) != 0) {
+		debug("pipe: %s", strerror(errno));
+		return (-1);
+	}
+
+	fcntl(gpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(gpipe[1], F_SETFL, O_NONBLOCK);
+	pork_io_add(gpipe[0], IO_COND_READ, NULL, &gpipe, grep_finished);
+
+	return (0);
+}
+
+/*
+** Search the log files under "dir" (or every file, with "all" set) for
+** "pattern", replacing any search that's still running. Matches are
+** shown in the grep window as they're found.
+*/
+
+int grep_start(const char *dir, int all, const char *pattern, uint32_t flags) {
+	struct imwindow *win;
+	struct grep *grep;
+	long cpus;
+	size_t i;
+
+	grep_cancel();
+
+	if (grep_init() != 0)
+		return (-1);
+
+	grep = xcalloc(1, sizeof(*grep));
+	if (match_compile(&grep->match, pattern, flags) != 0) {
+		free(grep);
+		errno = EINVAL;
+		return (-1);
+	}
+
+	gettimeofday(&grep->started, NULL);
+	grep_walk(grep, dir, NULL, 0, all);
+
+	win = grep_window();
+	if (win == NULL) {
+		grep_free(grep);
+		errno = ENOMEM;
+		return (-1);
+	}
+
+	grep->refnum = win->refnum;
+	screen_goto_window(win->refnum);
+	screen_win_msg(win, 1, 1, 1, MSG_TYPE_CMD_OUTPUT,
+		"Searching %u file%s in %s for \"%s\"",
+		(uint32_t) grep->num_files, (grep->num_files == 1 ? "" : "s"),
+		dir, pattern);
+
+	cur_grep = grep;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	cpus = max(1, min(cpus, POOL_MAX_THREADS));
+
+	for (i = 0 ; i < (size_t) cpus && i < grep->num_chunks ; i++) {
+		if (pthread_create(&grep->threads[i], NULL, grep_thread, grep) != 0) {
+			debug("pthread_create failed");
+			break;
+		}
+	}
+
+	grep->num_threads = i;
+
+	/* Nothing to search, or no threads: finish up from here. */
+	if (grep->num_threads == 0) {
+		grep_thread(grep);
+		grep_show(grep);
+	}
+
+	return (0);
+}
+
+/*
+** Stop the search that's running, if there is one. Returns -1 if
+** there wasn't.
+*/
+
+int grep_cancel(void) {
+	struct grep *grep = cur_grep;
+
+	if (grep == NULL)
+		return (-1);
+
+	pthread_mutex_lock(&greplock);
+	grep->cancel = 1;
+	pthread_mutex_unlock(&greplock);
+
+	grep_join(grep);
+	cur_grep = NULL;
+	grep_free(grep);
+
+	return (0);
+}
+
+void grep_destroy(void) {
+	grep_cancel();
+
+	if (gpipe[0] != -1) {
+		pork_io_del(&gpipe);
+		close(gpipe[0]);
+		close(gpipe[1]);
+		gpipe[0] = gpipe[1] = -1;
+	}
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_GREP_H__
+#define __NCIC_GREP_H__
+
+/*
+** Searching log files from inside the client. Files are mapped into
+** memory and split into chunks that are searched by worker threads,
+** and matches are shown in the "grep" window as they come in, in the
+** order they appear in the files.
+*/
+
+#define GREP_CHUNK		(1024 * 1024)
+#define GREP_WINDOW		"grep"
+
+struct imwindow;
+
+struct imwindow *grep_window(void);
+int grep_start(const char *dir, int all, const char *pattern, uint32_t flags);
+int grep_cancel(void);
+void grep_destroy(void);
+
+#endif /* __NCIC_GREP_H__ */
@@ -22,6 +22,7 @@
 
 #include "ncic_util.h"
 #include "ncic_screen.h"
+#include "ncic_list.h"
 #include "ncic_imsg.h"
 #include "ncic_screen_io.h"
 #include "ncic_help.h"
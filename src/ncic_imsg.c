@@ -9,6 +9,7 @@
 */
 
 #include <ncurses.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ncic_util.h"
@@ -17,12 +18,13 @@
 #include "ncic_swindow.h"
 #include "ncic_imsg.h"
 #include "ncic_cstr.h"
+#include "ncic_zblock.h"
 
 static uint32_t imsg_wordwrapped_lines(struct swindow *swindow,
 										struct imsg *imsg)
 {
 	uint32_t len = imsg->len;
-	chtype *ch = imsg->text;
+	chtype *ch = imsg_text(imsg);
 	chtype *end = &ch[len - 1];
 	uint32_t lines = 0;
 	int add = 0;
@@ -95,14 +97,50 @@ struct imsg *imsg_new(struct swindow *swindow, chtype *msg, size_t len) {
 
 	imsg = xmalloc(sizeof(*imsg));
 	imsg->text = msg;
-	imsg->serial = swindow->serial++;
+	imsg->serial = swindow_next_serial();
 	imsg->len = len;
+	imsg->zblock = NULL;
+	imsg->touched = time(NULL);
+	imsg->plain = NULL;
 	imsg->lines = imsg_lines(swindow, imsg);
 
 	return (imsg);
 }
 
-struct imsg *imsg_copy(struct swindow *swindow, struct imsg *imsg) {
+/*
+** Make a message out of "len" bytes of plain text, such as a line read
+** from a log. There's no color code parsing; control characters are
+** shown as spaces.
+*/
+
+struct imsg *imsg_new_plain(struct swindow *swindow, const char *text, size_t len) {
+	struct imsg *imsg;
+	chtype *ch;
+	char *plain;
+	size_t i;
+
+	ch = xmalloc(sizeof(chtype) * (len + 1));
+	plain = xmalloc(len + 1);
+
+	for (i = 0 ; i < len ; i++) {
+		unsigned char c = text[i];
+
+		if (c < ' ' || c == 0x7f)
+			c = ' ';
+
+		ch[i] = c;
+		plain[i] = c;
+	}
+
+	ch[len] = 0;
+	plain[len] = '\0';
+
+	imsg = imsg_new(swindow, ch, len);
+	imsg->plain = plain;
+	return (imsg);
+}
+
+struct imsg *imsg_copy(struct imsg *imsg) {
 	struct imsg *new_imsg;
 	size_t msg_size;
 
@@ -116,11 +154,14 @@ struct imsg *imsg_copy(struct swindow *swindow, struct imsg *imsg) {
 	new_imsg = xmalloc(sizeof(*new_imsg));
 	new_imsg->len = imsg->len;
 	new_imsg->lines = imsg->lines;
-	new_imsg->serial = swindow->serial++;
+	new_imsg->serial = swindow_next_serial();
+	new_imsg->zblock = NULL;
+	new_imsg->touched = time(NULL);
+	new_imsg->plain = NULL;
 
-	msg_size = (imsg->len + 1) * sizeof(imsg->text[0]);
+	msg_size = (imsg->len + 1) * sizeof(chtype);
 	new_imsg->text = xmalloc(msg_size);
-	memcpy(new_imsg->text, imsg->text, msg_size);
+	memcpy(new_imsg->text, imsg_text(imsg), msg_size);
 
 	return (new_imsg);
 }
@@ -157,3 +198,51 @@ chtype *imsg_partial(struct swindow *swindow, struct imsg *imsg, uint32_t n) {
 
 	return (&nul_ch);
 }
+
+/*
+** Return the message's text, whether or not it's compressed. If it
+** is, the pointer is only good until the next call.
+*/
+
+chtype *imsg_text(struct imsg *imsg) {
+	if (imsg->zblock != NULL)
+		return (zblock_text(imsg));
+
+	return (imsg->text);
+}
+
+/*
+** The number of bytes of memory the message is using. A compressed
+** message is charged its share of the block it's stored in, and one
+** with a plaintext copy is charged for its entries in the window's
+** trigram index as well.
+*/
+
+size_t imsg_size(struct imsg *imsg) {
+	size_t len = (imsg->len + 1) * sizeof(chtype);
+	size_t size = sizeof(*imsg);
+
+	if (imsg->plain != NULL) {
+		size += imsg->len + 1;
+		if (imsg->len > 2)
+			size += (imsg->len - 2) * sizeof(uint32_t);
+	}
+
+	if (imsg->zblock != NULL) {
+		struct zblock *zblock = imsg->zblock;
+
+		return (size + (uint64_t) zblock->len * len / zblock->raw_len);
+	}
+
+	return (size + len);
+}
+
+void imsg_free(struct imsg *imsg) {
+	if (imsg->zblock != NULL)
+		zblock_release(imsg);
+	else
+		free(imsg->text);
+
+	free(imsg->plain);
+	free(imsg);
+}
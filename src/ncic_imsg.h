@@ -11,9 +11,12 @@
 #ifndef __NCIC_IMSG_H__
 #define __NCIC_IMSG_H__
 
+#include <time.h>
+
 #define IMSG(x) ((struct imsg *) (x))
 
 struct swindow;
+struct zblock;
 
 enum {
 	MSG_TYPE_PRIVMSG_RECV				= (1 << 0),
@@ -58,15 +61,35 @@ enum {
 };
 
 struct imsg {
+	/* the next older and newer messages in the window's scroll buffer */
+	ILIST_LINK(imsg) link;
+
 	chtype *text;
 	uint32_t serial;
 	uint32_t len;
 	uint32_t lines;
+
+	/*
+	** If the text has been compressed, "text" is NULL and it
+	** lives at offset "zoff" in "zblock".
+	*/
+	uint32_t zoff;
+	struct zblock *zblock;
+
+	/* the last time the message was drawn */
+	time_t touched;
+
+	/* the text without attributes, for searching */
+	char *plain;
 };
 
 uint32_t imsg_lines(struct swindow *swindow, struct imsg *imsg);
 struct imsg *imsg_new(struct swindow *swindow, chtype *msg, size_t len);
-struct imsg *imsg_copy(struct swindow *swindow, struct imsg *imsg);
+struct imsg *imsg_new_plain(struct swindow *swindow, const char *text, size_t len);
+struct imsg *imsg_copy(struct imsg *imsg);
 chtype *imsg_partial(struct swindow *swindow, struct imsg *imsg, uint32_t n);
+chtype *imsg_text(struct imsg *imsg);
+size_t imsg_size(struct imsg *imsg);
+void imsg_free(struct imsg *imsg);
 
 #endif /* __NCIC_IMSG_H__ */
@@ -15,6 +15,7 @@
 #include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_imsg.h"
 #include "ncic_set.h"
 #include "ncic_swindow.h"
@@ -26,9 +27,13 @@
 #include "ncic_screen.h"
 #include "ncic_screen_io.h"
 #include "ncic_chat.h"
+#include "ncic_cstr.h"
 
 extern struct screen screen;
 
+static void imwindow_index_name(struct imwindow *imwindow);
+static void imwindow_unindex_name(struct imwindow *imwindow);
+
 struct imwindow *imwindow_new(	uint32_t rows,
 								uint32_t cols,
 								uint32_t refnum,
@@ -52,7 +57,7 @@ struct imwindow *imwindow_new(	uint32_t rows,
 	imwindow = xcalloc(1, sizeof(*imwindow));
 	imwindow->refnum = refnum;
 	imwindow->type = type;
-	imwindow->target = xstrdup(nname);
+	imwindow->target = istr_get(nname);
 	imwindow->name = color_quote_codes(target);
 	imwindow->active_binds = &screen.binds.main;
 	imwindow->owner = owner;
@@ -78,9 +83,15 @@ struct imwindow *imwindow_new(	uint32_t rows,
 	return (imwindow);
 }
 
+/*
+** The window must already have been added to the screen.
+*/
+
 void imwindow_rename(struct imwindow *imwindow, char *new_name) {
+	imwindow_unindex_name(imwindow);
 	free(imwindow->name);
 	imwindow->name = color_quote_codes(new_name);
+	imwindow_index_name(imwindow);
 }
 
 void imwindow_resize(struct imwindow *imwindow,
@@ -135,6 +146,75 @@ void imwindow_buffer_find(struct imwindow *imwindow, char *str, uint32_t opt) {
 	screen_win_msg(cur_window(), 1, 1, 0, MSG_TYPE_LASTLOG, "End of matches");
 }
 
+/*
+** Search every window but "imwindow", and print the matches to it in
+** the order they were written, each marked with the name of the window
+** it came from.
+*/
+
+void imwindow_buffer_find_all(struct imwindow *imwindow, char *str, uint32_t opt) {
+	struct swindow **swindows;
+	struct imwindow **wins;
+	struct swindow_hit *hits;
+	size_t num_hits;
+	size_t num = 0;
+	size_t i;
+	dlist_t *cur;
+
+	cur = screen.window_list;
+	do {
+		if (cur->data != imwindow)
+			num++;
+		cur = cur->next;
+	} while (cur != screen.window_list);
+
+	wins = xmalloc(max(num, 1) * sizeof(*wins));
+	swindows = xmalloc(max(num, 1) * sizeof(*swindows));
+
+	i = 0;
+	do {
+		if (cur->data != imwindow) {
+			wins[i] = cur->data;
+			swindows[i] = &wins[i]->swindow;
+			i++;
+		}
+		cur = cur->next;
+	} while (cur != screen.window_list);
+
+	screen_win_msg(imwindow, 1, 1, 0, MSG_TYPE_LASTLOG, "Matching lines:");
+
+	if (num > 0 &&
+		swindow_find(swindows, num, str, opt, &hits, &num_hits) == 0)
+	{
+		for (i = 0 ; i < num_hits ; i++) {
+			struct imsg *imsg = hits[i].imsg;
+			char *name = wins[hits[i].which]->name;
+			size_t len = strlen(name) + 4;
+			chtype *text;
+
+			text = xmalloc((len + imsg->len + 1) * sizeof(chtype));
+			len = plaintext_to_cstr_nocolor(text, len, "[", name, "] ", NULL);
+			memcpy(&text[len], imsg->text, (imsg->len + 1) * sizeof(chtype));
+
+			free(imsg->text);
+			free(imsg->plain);
+			imsg->text = text;
+			imsg->plain = NULL;
+			imsg->len += len;
+			imsg->lines = imsg_lines(&imwindow->swindow, imsg);
+
+			imwindow_add(imwindow, imsg, MSG_TYPE_LASTLOG);
+		}
+
+		free(hits);
+	}
+
+	screen_win_msg(imwindow, 1, 1, 0, MSG_TYPE_LASTLOG, "End of matches");
+
+	free(swindows);
+	free(wins);
+}
+
 void imwindow_destroy(struct imwindow *imwindow) {
 	swindow_destroy(&imwindow->swindow);
 
@@ -147,8 +227,10 @@ void imwindow_destroy(struct imwindow *imwindow) {
 		imwindow->owner->ref_count--;
 
 	wopt_destroy(imwindow);
+	free(imwindow->search_input);
+	free(imwindow->search_prompt);
 	free(imwindow->name);
-	free(imwindow->target);
+	istr_put(imwindow->target);
 	free(imwindow);
 }
 
@@ -165,82 +247,142 @@ void imwindow_switch_focus(struct imwindow *imwindow) {
 	}
 }
 
-struct imwindow *imwindow_find(struct pork_acct *owner, const char *target) {
-	dlist_t *list_start = screen.window_list;
-	dlist_t *cur = list_start;
-	char nname[NUSER_LEN];
+/*
+** Windows are indexed by name and, for conversation and chat windows,
+** by target, both per account. A lookup key with "win" set matches
+** only that window, so the right one gets removed when two windows
+** share a name.
+*/
 
-	owner->proto->normalize(nname, target, sizeof(nname));
+struct imwindow_key {
+	struct pork_acct *owner;
+	const char *str;
+	uint32_t type;
+	struct imwindow *win;
+};
 
-	do {
-		struct imwindow *imwindow = cur->data;
+static uint32_t imwindow_key_hash(const void *key) {
+	const struct imwindow_key *k = key;
 
-		if (imwindow->owner == owner && imwindow->type == WIN_TYPE_PRIVMSG &&
-			!strcasecmp(imwindow->target, nname))
-		{
-			return (imwindow);
-		}
+	return (string_hash_nocase(k->str) ^ (uint32_t) ((uintptr_t) k->owner >> 4));
+}
 
-		cur = cur->next;
-	} while (cur != list_start);
+static int imwindow_name_compare(void *l, void *r) {
+	const struct imwindow_key *key = l;
+	const struct imwindow *imwindow = r;
 
-	return (NULL);
+	if (key->owner != imwindow->owner ||
+		(key->win != NULL && key->win != imwindow))
+	{
+		return (-1);
+	}
+
+	return (strcasecmp(key->str, imwindow->name));
 }
 
-struct imwindow *imwindow_find_chat_target(	struct pork_acct *owner,
-											const char *target)
-{
-	dlist_t *list_start = screen.window_list;
-	dlist_t *cur = list_start;
-	char nname[NUSER_LEN];
+static int imwindow_target_compare(void *l, void *r) {
+	const struct imwindow_key *key = l;
+	const struct imwindow *imwindow = r;
 
-	owner->proto->normalize(nname, target, sizeof(nname));
+	if (key->owner != imwindow->owner || key->type != imwindow->type ||
+		(key->win != NULL && key->win != imwindow))
+	{
+		return (-1);
+	}
 
-	do {
-		struct imwindow *imwindow = cur->data;
+	return (strcasecmp(key->str, imwindow->target));
+}
 
-		if (imwindow->owner == owner &&
-			imwindow->type == WIN_TYPE_CHAT &&
-			!strcasecmp(imwindow->target, nname))
-		{
-			return (imwindow);
-		}
+static inline int imwindow_has_target(struct imwindow *imwindow) {
+	return (imwindow->type == WIN_TYPE_PRIVMSG ||
+			imwindow->type == WIN_TYPE_CHAT);
+}
 
-		cur = cur->next;
-	} while (cur != list_start);
+void imwindow_index_init(void) {
+	hash_init(&screen.name_hash, 4, imwindow_key_hash,
+		imwindow_name_compare, NULL);
+	hash_init(&screen.target_hash, 4, imwindow_key_hash,
+		imwindow_target_compare, NULL);
+}
 
-	return (NULL);
+void imwindow_index_destroy(void) {
+	hash_destroy(&screen.name_hash);
+	hash_destroy(&screen.target_hash);
 }
 
-struct imwindow *imwindow_find_name(struct pork_acct *owner, const char *name) {
-	dlist_t *list_start = screen.window_list;
-	dlist_t *cur = list_start;
+static void imwindow_index_name(struct imwindow *imwindow) {
+	struct imwindow_key key = { imwindow->owner, imwindow->name, 0, imwindow };
 
-	do {
-		struct imwindow *imwindow = cur->data;
+	hash_add(&screen.name_hash, &key, imwindow);
+}
 
-		if (imwindow->owner == owner && !strcasecmp(imwindow->name, name))
-			return (imwindow);
+static void imwindow_unindex_name(struct imwindow *imwindow) {
+	struct imwindow_key key = { imwindow->owner, imwindow->name, 0, imwindow };
 
-		cur = cur->next;
-	} while (cur != list_start);
+	hash_remove(&screen.name_hash, &key);
+}
 
-	return (NULL);
+/*
+** Add a window to the name and target indexes. Called when it's
+** added to the window list.
+*/
+
+void imwindow_index(struct imwindow *imwindow) {
+	imwindow_index_name(imwindow);
+
+	if (imwindow_has_target(imwindow)) {
+		struct imwindow_key key = { imwindow->owner, imwindow->target,
+									imwindow->type, imwindow };
+
+		hash_add(&screen.target_hash, &key, imwindow);
+	}
 }
 
-struct imwindow *imwindow_find_refnum(uint32_t refnum) {
-	dlist_t *cur = screen.window_list;
+void imwindow_unindex(struct imwindow *imwindow) {
+	imwindow_unindex_name(imwindow);
 
-	do {
-		struct imwindow *imwindow = cur->data;
+	if (imwindow_has_target(imwindow)) {
+		struct imwindow_key key = { imwindow->owner, imwindow->target,
+									imwindow->type, imwindow };
 
-		if (imwindow->refnum == refnum)
-			return (imwindow);
+		hash_remove(&screen.target_hash, &key);
+	}
+}
 
-		cur = cur->next;
-	} while (cur != screen.window_list);
+static struct imwindow *imwindow_find_target(	struct pork_acct *owner,
+												const char *target,
+												uint32_t type)
+{
+	char nname[NUSER_LEN];
+	struct imwindow_key key = { owner, nname, type, NULL };
+
+	owner->proto->normalize(nname, target, sizeof(nname));
+	return (hash_find(&screen.target_hash, &key));
+}
+
+struct imwindow *imwindow_find(struct pork_acct *owner, const char *target) {
+	return (imwindow_find_target(owner, target, WIN_TYPE_PRIVMSG));
+}
 
-	return (NULL);
+struct imwindow *imwindow_find_chat_target(	struct pork_acct *owner,
+											const char *target)
+{
+	return (imwindow_find_target(owner, target, WIN_TYPE_CHAT));
+}
+
+struct imwindow *imwindow_find_name(struct pork_acct *owner, const char *name) {
+	struct imwindow_key key = { owner, name, 0, NULL };
+
+	return (hash_find(&screen.name_hash, &key));
+}
+
+struct imwindow *imwindow_find_refnum(uint32_t refnum) {
+	dlist_t *node = hash_find(&screen.refnum_hash, UINT_TO_POINTER(refnum));
+
+	if (node == NULL)
+		return (NULL);
+
+	return (node->data);
 }
 
 void imwindow_send_msg(struct imwindow *win) {
@@ -272,9 +414,11 @@ int imwindow_bind_acct(struct imwindow *imwindow, uint32_t refnum) {
 		return (-1);
 
 	if (old_acct != owner) {
+		imwindow_unindex(imwindow);
 		imwindow->owner->ref_count--;
 		imwindow->owner = owner;
 		imwindow->owner->ref_count++;
+		imwindow_index(imwindow);
 	}
 
 	return (0);
@@ -325,6 +469,101 @@ void imwindow_scroll_end(struct imwindow *imwindow) {
 	swindow_scroll_to_end(&imwindow->swindow);
 }
 
+/*
+** Incremental search. While it's going on, the input line holds the
+** pattern and keys are looked up in the search bindings.
+*/
+
+void imwindow_search_start(struct imwindow *imwindow, uint32_t opt) {
+	struct input *input = imwindow->input;
+
+	if (imwindow->searching)
+		return;
+
+	imwindow->searching = 1;
+	imwindow->search_failed = 0;
+	imwindow->search_opt = opt;
+	imwindow->search_input = xstrdup(input_get_buf_str(input));
+	imwindow->search_prompt = input_swap_prompt(input, NULL);
+	imwindow->active_binds = &screen.binds.search;
+
+	input_clear_line(input);
+	input_set_prompt(input, "search: ");
+	swindow_search_begin(&imwindow->swindow);
+}
+
+static void imwindow_search_prompt(struct imwindow *imwindow) {
+	uint32_t failed = swindow_search_failed(&imwindow->swindow);
+
+	if (failed == imwindow->search_failed)
+		return;
+
+	imwindow->search_failed = failed;
+	input_set_prompt(imwindow->input,
+		failed ? "failing search: " : "search: ");
+}
+
+/*
+** Called after every key that's pressed during the search, to
+** start looking for whatever's on the input line now.
+*/
+
+void imwindow_search_update(struct imwindow *imwindow) {
+	if (!imwindow->searching)
+		return;
+
+	swindow_search_set(&imwindow->swindow,
+		input_get_buf_str(imwindow->input), imwindow->search_opt);
+	imwindow_search_prompt(imwindow);
+}
+
+void imwindow_search_next(struct imwindow *imwindow, int dir) {
+	if (!imwindow->searching)
+		return;
+
+	swindow_search_next(&imwindow->swindow, dir);
+	imwindow_search_prompt(imwindow);
+}
+
+/*
+** Called from the main loop. Returns non-zero if the search has
+** more to do and the loop shouldn't wait for input.
+*/
+
+int imwindow_search_run(struct imwindow *imwindow) {
+	int ret;
+
+	if (!imwindow->searching)
+		return (0);
+
+	ret = swindow_search_run(&imwindow->swindow);
+	imwindow_search_prompt(imwindow);
+	return (ret);
+}
+
+void imwindow_search_end(struct imwindow *imwindow, int restore) {
+	struct input *input = imwindow->input;
+
+	if (!imwindow->searching)
+		return;
+
+	swindow_search_end(&imwindow->swindow, restore);
+
+	input_clear_line(input);
+	free(input_swap_prompt(input, imwindow->search_prompt));
+	input_insert_str(input, imwindow->search_input);
+	free(imwindow->search_input);
+
+	imwindow->search_prompt = NULL;
+	imwindow->search_input = NULL;
+	imwindow->searching = 0;
+
+	if (imwindow->input_focus == BINDS_BUDDY)
+		imwindow->active_binds = &screen.binds.blist;
+	else
+		imwindow->active_binds = &screen.binds.main;
+}
+
 void imwindow_clear(struct imwindow *imwindow) {
 	swindow_clear(&imwindow->swindow);
 }
@@ -365,5 +604,10 @@ int imwindow_add(struct imwindow *imwindow,
 						struct imsg *imsg,
 						uint32_t type)
 {
-	return (swindow_add(&imwindow->swindow, imsg, type));
+	int ret;
+
+	ret = swindow_add(&imwindow->swindow, imsg, type);
+	screen_trim_scrollbuf();
+
+	return (ret);
 }
@@ -40,6 +40,12 @@ struct imwindow {
 	uint32_t input_focus:1;
 	uint32_t ignore_activity:1;
 	uint32_t skip:1;
+	uint32_t searching:1;
+	uint32_t search_failed:1;
+	uint32_t search_opt;
+	/* what the input line held before the search started */
+	chtype *search_prompt;
+	char *search_input;
 	pref_val_t opts[WOPT_NUM_OPTS];
 };
 
@@ -68,6 +74,12 @@ int imwindow_refresh(struct imwindow *imwindow);
 void imwindow_destroy(struct imwindow *imwindow);
 void imwindow_switch_focus(struct imwindow *imwindow);
 void imwindow_buffer_find(struct imwindow *imwindow, char *str, uint32_t opt);
+void imwindow_buffer_find_all(struct imwindow *imwindow, char *str, uint32_t opt);
+
+void imwindow_index_init(void);
+void imwindow_index_destroy(void);
+void imwindow_index(struct imwindow *imwindow);
+void imwindow_unindex(struct imwindow *imwindow);
 
 struct imwindow *imwindow_find_refnum(uint32_t refnum);
 struct imwindow *imwindow_find(struct pork_acct *owner, const char *target);
@@ -92,6 +104,11 @@ void imwindow_scroll_page_up(struct imwindow *imwindow);
 void imwindow_scroll_page_down(struct imwindow *imwindow);
 void imwindow_scroll_start(struct imwindow *imwindow);
 void imwindow_scroll_end(struct imwindow *imwindow);
+void imwindow_search_start(struct imwindow *imwindow, uint32_t opt);
+void imwindow_search_update(struct imwindow *imwindow);
+void imwindow_search_next(struct imwindow *imwindow, int dir);
+int imwindow_search_run(struct imwindow *imwindow);
+void imwindow_search_end(struct imwindow *imwindow, int restore);
 void imwindow_clear(struct imwindow *imwindow);
 void imwindow_erase(struct imwindow *imwindow);
 
@@ -454,6 +454,83 @@ static inline void input_free(void *param __notused, void *data) {
 inline void input_destroy(struct input *input) {
 	free(input->prompt);
 	dlist_destroy(input->history, NULL, input_free);
+	input_complete_end(input);
+}
+
+/*
+** Replace the text from "begin" to the cursor with the completion
+** that's currently chosen.
+*/
+
+static void input_complete_show(struct input *input, uint16_t begin) {
+	u_int32_t start = begin - input->prompt_len;
+	u_int32_t cur = input->cur - input->prompt_len;
+
+	memmove(&input->input_buf[start], &input->input_buf[cur],
+		input->len - cur + 1);
+
+	input->len -= cur - start;
+	input->cur = begin;
+	input_insert_str(input, input->completions[input->completion]);
+
+	input->begin_completion = begin;
+	input->completion_end = input->cur;
+	input->dirty = 1;
+}
+
+/*
+** Complete the word that runs from "begin" to the cursor with the
+** first of the "num" strings in "matches". The input line takes
+** ownership of "matches", and input_complete_next() replaces the
+** word with each of the others in turn.
+*/
+
+void input_complete_start(	struct input *input,
+							uint16_t begin,
+							char **matches,
+							uint32_t num)
+{
+	input_complete_end(input);
+
+	if (num == 0) {
+		free(matches);
+		return;
+	}
+
+	input->completions = matches;
+	input->num_completions = num;
+	input->completion = 0;
+	input_complete_show(input, begin);
+}
+
+/*
+** Show the next completion, if nothing's been done to the line since
+** the last one. Returns -1 if it has.
+*/
+
+int input_complete_next(struct input *input) {
+	if (input->completions == NULL ||
+		input->begin_completion >= input->cur ||
+		input->completion_end != input->cur)
+	{
+		return (-1);
+	}
+
+	input->completion = (input->completion + 1) % input->num_completions;
+	input_complete_show(input, input->begin_completion);
+	return (0);
+}
+
+void input_complete_end(struct input *input) {
+	uint32_t i;
+
+	for (i = 0 ; i < input->num_completions ; i++)
+		free(input->completions[i]);
+
+	free(input->completions);
+	input->completions = NULL;
+	input->num_completions = 0;
+	input->completion = 0;
 }
 
 inline void input_resize(struct input *input, u_int32_t width) {
@@ -514,6 +591,24 @@ int input_set_prompt(struct input *input, char *prompt) {
 	return (0);
 }
 
+/*
+** Replace the prompt with one that's already been converted, and
+** return the old one. Either may be NULL.
+*/
+
+chtype *input_swap_prompt(struct input *input, chtype *prompt) {
+	chtype *old = input->prompt;
+	u_int32_t cur = input->cur - input->prompt_len;
+
+	input->prompt = prompt;
+	input->prompt_len = (prompt != NULL) ? cstrlen(prompt) : 0;
+	input->cur = cur + input->prompt_len;
+	input->begin_completion = input->cur;
+	input->dirty = 1;
+
+	return (old);
+}
+
 /*
 ** Fetches the contents of the input buffer as a C string.
 */
@@ -27,6 +27,8 @@ struct input {
 	uint16_t cur;
 	uint16_t len;
 	uint16_t begin_completion;
+	/* where the cursor was left by the last completion */
+	uint16_t completion_end;
 	uint16_t max_history_len;
 	uint16_t history_len;
 	uint16_t prompt_len;
@@ -35,6 +37,10 @@ struct input {
 	dlist_t *history;
 	dlist_t *history_cur;
 	dlist_t *history_end;
+	/* the completions being cycled through, and which one is shown */
+	char **completions;
+	uint32_t num_completions;
+	uint32_t completion;
 	char input_buf[INPUT_BUFFER_LEN];
 };
 
@@ -65,7 +71,12 @@ void input_history_prev(struct input *input);
 void input_history_clear(struct input *input);
 int input_set_buf(struct input *input, char *str);
 int input_set_prompt(struct input *input, char *prompt);
+chtype *input_swap_prompt(struct input *input, chtype *prompt);
 char *input_get_buf_str(struct input *input);
 uint32_t input_get_cursor_pos(struct input *input);
 
+void input_complete_start(struct input *input, uint16_t begin, char **matches, uint32_t num);
+int input_complete_next(struct input *input);
+void input_complete_end(struct input *input);
+
 #endif /* __NCIC_INPUT_H__ */
@@ -22,31 +22,37 @@
 #include "ncic_io.h"
 #include "ncic_inet.h"
 
-static dlist_t *io_list;
+static ILIST_HEAD(, io_source) io_list;
 
-static int pork_io_find_cb(void *l, void *r) {
-	struct io_source *io = (struct io_source *) r;
+static struct io_source *pork_io_find(void *key) {
+	struct io_source *io;
 
-	return (!(l == io->key));
-}
+	ilist_foreach(io, &io_list, link) {
+		if (io->key == key)
+			break;
+	}
 
-static void pork_io_destroy_cb(void *param __notused, void *data) {
-	free(data);
+	return (io);
 }
 
-static void pork_io_remove(dlist_t *node) {
-	pork_io_destroy_cb(NULL, node->data);
-	io_list = dlist_remove(io_list, node);
+static void pork_io_remove(struct io_source *io) {
+	ilist_remove(&io_list, io, link);
+	free(io);
 }
 
 int pork_io_init(void) {
-	io_list = NULL;
+	ilist_init(&io_list);
 	return (0);
 }
 
 void pork_io_destroy(void) {
-	dlist_destroy(io_list, NULL, pork_io_destroy_cb);
-	io_list = NULL;
+	struct io_source *io;
+	struct io_source *next;
+
+	ilist_foreach_safe(io, next, &io_list, link)
+		free(io);
+
+	ilist_init(&io_list);
 }
 
 int pork_io_add(int fd,
@@ -55,7 +61,6 @@ int pork_io_add(int fd,
 				void *key,
 				void (*callback)(int fd, u_int32_t cond, void *data))
 {
-	dlist_t *node;
 	struct io_source *io;
 
 	/*
@@ -63,9 +68,9 @@ int pork_io_add(int fd,
 	** and replace it with the new one.
 	*/
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node != NULL)
-		pork_io_remove(node);
+	io = pork_io_find(key);
+	if (io != NULL)
+		pork_io_remove(io);
 
 	io = xcalloc(1, sizeof(*io));
 	io->fd = fd;
@@ -74,109 +79,99 @@ int pork_io_add(int fd,
 	io->key = key;
 	io->callback = callback;
 
-	io_list = dlist_add_head(io_list, io);
+	ilist_add_head(&io_list, io, link);
 	return (0);
 }
 
 int pork_io_del(void *key) {
-	dlist_t *node;
 	struct io_source *io;
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node == NULL)
+	io = pork_io_find(key);
+	if (io == NULL)
 		return (-1);
 
-	io = node->data;
 	io->fd = -2;
 	io->callback = NULL;
 	return (0);
 }
 
 int pork_io_dead(void *key) {
-	dlist_t *node;
+	struct io_source *io;
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node == NULL)
+	io = pork_io_find(key);
+	if (io == NULL)
 		return (-1);
 
-	((struct io_source *) node->data)->fd = -1;
+	io->fd = -1;
 	return (0);
 }
 
 int pork_io_set_cond(void *key, u_int32_t new_cond) {
-	dlist_t *node;
+	struct io_source *io;
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node == NULL)
+	io = pork_io_find(key);
+	if (io == NULL)
 		return (-1);
 
-	((struct io_source *) node->data)->cond = new_cond;
+	io->cond = new_cond;
 	return (0);
 }
 
 int pork_io_add_cond(void *key, u_int32_t new_cond) {
-	dlist_t *node;
+	struct io_source *io;
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node == NULL)
+	io = pork_io_find(key);
+	if (io == NULL)
 		return (-1);
 
-	((struct io_source *) node->data)->cond |= new_cond;
+	io->cond |= new_cond;
 	return (0);
 }
 
 int pork_io_del_cond(void *key, u_int32_t new_cond) {
-	dlist_t *node;
+	struct io_source *io;
 
-	node = dlist_find(io_list, key, pork_io_find_cb);
-	if (node == NULL)
+	io = pork_io_find(key);
+	if (io == NULL)
 		return (-1);
 
-	((struct io_source *) node->data)->cond &= ~new_cond;
+	io->cond &= ~new_cond;
 	return (0);
 }
 
-static int pork_io_find_dead_fds(dlist_t *io_list) {
-	dlist_t *cur = io_list;
+static int pork_io_find_dead_fds(void) {
+	struct io_source *io;
+	struct io_source *next;
 	int bad_fd = 0;
 
-	while (cur != NULL) {
-		struct io_source *io = cur->data;
-		dlist_t *next = cur->next;
-
+	ilist_foreach_safe(io, next, &io_list, link) {
 		if (io->fd < 0 || sock_is_error(io->fd)) {
 			debug("fd %d is dead", io->fd);
 			if (io->callback != NULL)
 				io->callback(io->fd, IO_COND_DEAD, io->data);
 
-			pork_io_remove(cur);
+			pork_io_remove(io);
 			bad_fd++;
 		}
-
-		cur = next;
 	}
 
 	return (bad_fd);
 }
 
-int pork_io_run(void) {
+int pork_io_run(struct timeval *tv) {
 	fd_set rfds;
 	fd_set wfds;
 	fd_set xfds;
 	int max_fd = -1;
 	int ret;
-	struct timeval tv = { 0, 600000 };
-	dlist_t *cur;
+	struct io_source *io;
+	struct io_source *next;
 
 	FD_ZERO(&rfds);
 	FD_ZERO(&wfds);
 	FD_ZERO(&xfds);
 
-	cur = io_list;
-	while (cur != NULL) {
-		struct io_source *io = cur->data;
-		dlist_t *next = cur->next;
-
+	ilist_foreach_safe(io, next, &io_list, link) {
 		if (io->fd >= 0) {
 			if (io->cond & IO_COND_ALWAYS && io->callback != NULL)
 				io->callback(io->fd, IO_COND_ALWAYS, io->data);
@@ -196,10 +191,8 @@ int pork_io_run(void) {
 			if (io->callback != NULL)
 				io->callback(io->fd, IO_COND_DEAD, io->data);
 
-			pork_io_remove(cur);
+			pork_io_remove(io);
 		}
-
-		cur = next;
 	}
 
 	if (max_fd < 0)
@@ -209,19 +202,15 @@ int pork_io_run(void) {
 	** If there's a bad fd in the set better find it, otherwise
 	** we're going to get into an infinite loop.
 	*/
-	ret = select(max_fd + 1, &rfds, &wfds, &xfds, &tv);
+	ret = select(max_fd + 1, &rfds, &wfds, &xfds, tv);
 	if (ret < 1) {
 		if (ret == -1 && errno == EBADF)
-			pork_io_find_dead_fds(io_list);
+			pork_io_find_dead_fds();
 
 		return (ret);
 	}
 
-	cur = io_list;
-	while (cur != NULL) {
-		struct io_source *io = cur->data;
-		dlist_t *next = cur->next;
-
+	ilist_foreach_safe(io, next, &io_list, link) {
 		if (io->fd >= 0) {
 			u_int32_t cond = 0;
 
@@ -237,8 +226,6 @@ int pork_io_run(void) {
 			if (cond != 0 && io->callback != NULL)
 				io->callback(io->fd, cond, io->data);
 		}
-
-		cur = next;
 	}
 
 	return (ret);
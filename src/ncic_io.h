@@ -11,6 +11,8 @@
 #ifndef __NCIC_IO_H__
 #define __NCIC_IO_H__
 
+#include <sys/time.h>
+
 #define IO_COND_READ		0x01
 #define IO_COND_WRITE		0x02
 #define IO_COND_EXCEPTION	0x04
@@ -19,6 +21,7 @@
 #define IO_COND_RW			(IO_COND_READ | IO_COND_WRITE)
 
 struct io_source {
+	ILIST_LINK(io_source) link;
 	int fd;
 	u_int32_t cond;
 	void *data;
@@ -29,7 +32,7 @@ struct io_source {
 int pork_io_init(void);
 void pork_io_destroy(void);
 int pork_io_del(void *key);
-int pork_io_run(void);
+int pork_io_run(struct timeval *tv);
 int pork_io_dead(void *key);
 int pork_io_add_cond(void *key, u_int32_t new_cond);
 int pork_io_del_cond(void *key, u_int32_t new_cond);
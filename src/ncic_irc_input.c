@@ -20,10 +20,13 @@
 #include "ncic_inet.h"
 #include "ncic_acct.h"
 #include "ncic_proto.h"
+#include "ncic_list.h"
+#include "ncic_istr.h"
 #include "ncic_imsg.h"
 #include "ncic_imwindow.h"
 #include "ncic_screen.h"
 #include "ncic_screen_io.h"
+#include "ncic_blog.h"
 #include "ncic_chat.h"
 #include "ncic_msg.h"
 
@@ -57,9 +60,9 @@ static int naken_process_input(irc_session_t *session, char *input, int len)
 		return 0;
 	}
 
-  // Best to use ngnc's solution at some point (for tab completion)
 	if (input[0] == '+' && input[1] == '[') {
-		int name_len;
+		struct chatroom *chat = chat_find(acct, "main");
+		struct chat_user *chat_user;
 
 		/* Add a user to the user list. Do a simple tokenization
 		 * of the input. +[#]User where
@@ -67,20 +70,39 @@ static int naken_process_input(irc_session_t *session, char *input, int len)
 		 * User = the user name */
 
 		tmp = strchr(input, ']');
+		if (tmp == NULL || chat == NULL)
+			return 0;
 		*tmp = '\0';
 
 		number = atoi(input + 2);
 
+		/* The list is kept for nick completion. */
+		chat_user = chat_user_joined(acct, chat, tmp + 1, NULL, 1);
+		if (chat_user != NULL)
+			chat_user->data = UINT_TO_POINTER(number);
+
 		return 0;
 	}
 
 	if (input[0] == '-' && input[1] == '[') {
+		struct chatroom *chat = chat_find(acct, "main");
+		struct chat_user *chat_user;
+
 		/* Remove a user from the user list */
 		tmp = strchr(input, ']');
+		if (tmp == NULL || chat == NULL)
+			return 0;
 		*tmp = '\0';
 
 		number = atoi(input + 2);
 
+		ilist_foreach(chat_user, &chat->user_list, link) {
+			if ((int) POINTER_TO_UINT(chat_user->data) == number) {
+				chat_user_left(acct, chat, chat_user->name, 1);
+				break;
+			}
+		}
+
 		return 0;
 	}
 	if (strstr(input, ">> At the tone")) {
@@ -98,7 +120,22 @@ static int naken_process_input(irc_session_t *session, char *input, int len)
 	  if (in->msg_type == MSG_MINE) {
 	    ncic_recv_highlight_msg(acct, in->message);
 	  } else {
+      char line[16];
+
+      if (in->msg_type == MSG_NORMAL && in->name != NULL) {
+        struct chatroom *chat = chat_find(acct, "main");
+
+        if (chat != NULL)
+          chat_user_spoke(acct, chat, in->name);
+      }
+
+      /* Senders are only known by their line number. */
+      if (in->message != NULL) {
+        snprintf(line, sizeof(line), "%d", in->sender);
+        blog_set_sender(line);
+      }
       screen_win_msg(cur_window(), 0, 0, 0, MSG_TYPE_CMD_OUTPUT, "%s", in->orig);
+      blog_set_sender(NULL);
     }
 	}
 
@@ -179,6 +216,9 @@ static struct naken_input *naken_tokenize(irc_session_t *session, char *input)
 	}
 	*tmp = '\0';
 
+	if (in->msg_type == MSG_NORMAL)
+		in->name = tmp + 1;
+
   in->sender = atoi(input + 1);
   if (in->sender == acct->id && in->msg_type == MSG_NORMAL) {
     in->msg_type = MSG_MINE;
@@ -276,8 +316,8 @@ naken_handler_nick(struct pork_acct *acct, struct naken_input *in, char *old_nam
 	}
 
 	if (!acct->proto->user_compare(acct->username, old_name)) {
-		free(acct->username);
-		acct->username = xstrdup(in->args);
+		istr_put(acct->username);
+		acct->username = istr_get(in->args);
 	}
 
 	return (chat_nick_change(acct, old_name, in->args));
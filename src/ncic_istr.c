@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "ncic_istr.h"
+
+struct istr {
+	uint32_t refs;
+	uint32_t len;
+	char str[];
+};
+
+#define ISTR(x) ((struct istr *) ((x) - offsetof(struct istr, str)))
+
+static hash_t istr_table;
+static int istr_ready;
+static struct istr_stats istr_stats;
+
+static int istr_compare(void *l, void *r) {
+	const char *str = l;
+	const struct istr *istr = r;
+
+	return (strcmp(str, istr->str));
+}
+
+/*
+** Return the interned copy of "str", adding it to the table if it
+** isn't there already. Each call must be matched by a call to
+** istr_put(). Passing NULL returns NULL.
+*/
+
+char *istr_get(const char *str) {
+	struct istr *istr;
+	size_t len;
+
+	if (str == NULL)
+		return (NULL);
+
+	if (!istr_ready) {
+		hash_init(&istr_table, 8, string_hash, istr_compare, NULL);
+		istr_ready = 1;
+	}
+
+	istr = hash_find(&istr_table, (void *) str);
+	if (istr != NULL)
+		return (istr_ref(istr->str));
+
+	len = strlen(str);
+	istr = xmalloc(sizeof(*istr) + len + 1);
+	istr->refs = 1;
+	istr->len = len;
+	memcpy(istr->str, str, len + 1);
+	hash_add(&istr_table, istr->str, istr);
+
+	istr_stats.strings++;
+	istr_stats.refs++;
+	istr_stats.bytes += len + 1;
+	return (istr->str);
+}
+
+/*
+** Take another reference to a string returned by istr_get().
+*/
+
+char *istr_ref(char *str) {
+	struct istr *istr;
+
+	if (str == NULL)
+		return (NULL);
+
+	istr = ISTR(str);
+	istr->refs++;
+
+	istr_stats.refs++;
+	istr_stats.saved += istr->len + 1;
+	return (str);
+}
+
+void istr_put(char *str) {
+	struct istr *istr;
+
+	if (str == NULL)
+		return;
+
+	istr = ISTR(str);
+	istr_stats.refs--;
+
+	if (--istr->refs > 0) {
+		istr_stats.saved -= istr->len + 1;
+		return;
+	}
+
+	hash_remove(&istr_table, istr->str);
+	istr_stats.strings--;
+	istr_stats.bytes -= istr->len + 1;
+	free(istr);
+}
+
+void istr_get_stats(struct istr_stats *stats) {
+	*stats = istr_stats;
+}
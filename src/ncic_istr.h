@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_ISTR_H__
+#define __NCIC_ISTR_H__
+
+/*
+** Interned strings. Each distinct string is stored once, along with a
+** count of its references, so a nick that's in a dozen rooms and has
+** a window open is only in memory once. Interned strings must not be
+** modified, and two of them are equal exactly when they're the same
+** pointer.
+*/
+
+struct istr_stats {
+	uint32_t strings;
+	uint64_t refs;
+	uint64_t bytes;
+	/* what the extra references would have cost as copies */
+	uint64_t saved;
+};
+
+char *istr_get(const char *str);
+char *istr_ref(char *str);
+void istr_put(char *str);
+void istr_get_stats(struct istr_stats *stats);
+
+#endif /* __NCIC_ISTR_H__ */
@@ -10,10 +10,143 @@
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
+#include "ncic.h"
 #include "ncic_util.h"
 #include "ncic_list.h"
 
+/*
+** List nodes are carved out of slabs of DLIST_SLAB_NODES and recycled
+** through a free list kept by each thread, so adding to and removing
+** from lists almost never calls malloc(). A node freed by another
+** thread than the one that allocated it just joins that thread's free
+** list. When a thread exits, its free nodes are left on a shared list
+** for other threads to take. Slabs are never freed.
+**
+** Under AddressSanitizer nodes come straight from malloc(), so that
+** it can still catch nodes that are used after they're freed.
+*/
+
+#define DLIST_SLAB_NODES	256
+
+#if defined(__SANITIZE_ADDRESS__)
+#	define DLIST_NO_POOL
+#elif defined(__has_feature)
+#	if __has_feature(address_sanitizer)
+#		define DLIST_NO_POOL
+#	endif
+#endif
+
+#ifndef DLIST_NO_POOL
+
+static __thread dlist_t *node_cache;
+static __thread int node_cache_owned;
+
+static pthread_once_t node_once = PTHREAD_ONCE_INIT;
+static pthread_key_t node_key;
+static pthread_mutex_t node_lock = PTHREAD_MUTEX_INITIALIZER;
+static dlist_t *node_orphans;
+static dlist_t *node_slabs;
+
+/*
+** Called when a thread that's used lists exits.
+*/
+
+static void dlist_node_orphan(void *arg __notused) {
+	dlist_t *tail = node_cache;
+
+	if (tail == NULL)
+		return;
+
+	while (tail->next != NULL)
+		tail = tail->next;
+
+	pthread_mutex_lock(&node_lock);
+	tail->next = node_orphans;
+	node_orphans = node_cache;
+	pthread_mutex_unlock(&node_lock);
+
+	node_cache = NULL;
+}
+
+static void dlist_node_key_init(void) {
+	pthread_key_create(&node_key, dlist_node_orphan);
+}
+
+/*
+** Arrange for this thread's cache to be handed back when it exits.
+** Done the first time a thread takes or gives back a node, since some
+** threads only free nodes that were made elsewhere.
+*/
+
+static void dlist_node_cache_own(void) {
+	pthread_once(&node_once, dlist_node_key_init);
+	pthread_setspecific(node_key, &node_cache_owned);
+	node_cache_owned = 1;
+}
+
+static void dlist_node_refill(void) {
+	dlist_t *slab;
+	uint32_t i;
+
+	if (!node_cache_owned)
+		dlist_node_cache_own();
+
+	pthread_mutex_lock(&node_lock);
+
+	if (node_orphans != NULL) {
+		node_cache = node_orphans;
+		node_orphans = NULL;
+		pthread_mutex_unlock(&node_lock);
+		return;
+	}
+
+	/* The first node of each slab links the slabs together. */
+	slab = xmalloc(DLIST_SLAB_NODES * sizeof(*slab));
+	slab[0].next = node_slabs;
+	node_slabs = slab;
+	pthread_mutex_unlock(&node_lock);
+
+	for (i = 1 ; i < DLIST_SLAB_NODES - 1 ; i++)
+		slab[i].next = &slab[i + 1];
+
+	slab[DLIST_SLAB_NODES - 1].next = NULL;
+	node_cache = &slab[1];
+}
+
+static inline dlist_t *dlist_node_new(void) {
+	dlist_t *node;
+
+	if (node_cache == NULL)
+		dlist_node_refill();
+
+	node = node_cache;
+	node_cache = node->next;
+	return (node);
+}
+
+static inline void dlist_node_free(dlist_t *node) {
+	if (!node_cache_owned)
+		dlist_node_cache_own();
+
+	node->next = node_cache;
+	node_cache = node;
+}
+
+#else
+
+static inline dlist_t *dlist_node_new(void) {
+	return (xmalloc(sizeof(dlist_t)));
+}
+
+static inline void dlist_node_free(dlist_t *node) {
+	free(node);
+}
+
+#endif
+
 /*
 ** Returns the length of the list whose head
 ** node is passed in.
@@ -36,7 +169,7 @@ size_t dlist_len(dlist_t *head) {
 */
 
 dlist_t *dlist_add_head(dlist_t *head, void *data) {
-	dlist_t *new_node = xmalloc(sizeof(dlist_t));
+	dlist_t *new_node = dlist_node_new();
 
 	new_node->data = data;
 	new_node->prev = NULL;
@@ -54,7 +187,7 @@ dlist_t *dlist_add_head(dlist_t *head, void *data) {
 */
 
 dlist_t *dlist_add_after(dlist_t *head, dlist_t *node, void *data) {
-	dlist_t *new_node = xmalloc(sizeof(dlist_t));
+	dlist_t *new_node = dlist_node_new();
 
 	new_node->data = data;
 	new_node->prev = node;
@@ -109,7 +242,7 @@ void *dlist_remove_head(dlist_t **list_head) {
 	dlist_t *next_node = (*list_head)->next;
 	void *ret = (*list_head)->data;
 
-	free(*list_head);
+	dlist_node_free(*list_head);
 
 	*list_head = next_node;
 	if (next_node != NULL)
@@ -133,7 +266,7 @@ dlist_t *dlist_remove(dlist_t *head, dlist_t *node) {
 	if (node->next != NULL)
 		node->next->prev = node->prev;
 
-	free(node);
+	dlist_node_free(node);
 	return (ret);
 }
 
@@ -154,7 +287,7 @@ void dlist_destroy(	dlist_t *head,
 		if (cleanup != NULL)
 			cleanup(param, cur->data);
 
-		free(cur);
+		dlist_node_free(cur);
 
 		cur = next;
 	}
@@ -199,71 +332,207 @@ void dlist_iterate(dlist_t *head, void (*func)(void *, void *), void *data) {
 		func(cur->data, data);
 }
 
+/*
+** Slot "hash" belongs in when there's nothing in its way. Multiplying
+** by the golden ratio mixes the low bits of weak hashes (like those of
+** small integers) into the high bits that are used.
+*/
+
+static inline uint32_t hash_home(const hash_t *hash, uint32_t val) {
+	return ((val * 0x9e3779b1U) >> (32 - hash->order));
+}
+
+/*
+** Put "data" in the table, moving entries that are closer to their
+** home slots out of the way (Robin Hood hashing). There must be room.
+*/
+
+static void hash_insert(hash_t *hash, void *data, uint32_t val) {
+	uint32_t mask = (1U << hash->order) - 1;
+	uint32_t i = hash_home(hash, val);
+	struct hash_slot cur;
+
+	cur.data = data;
+	cur.hash = val;
+	cur.dist = 1;
+
+	while (hash->map[i].dist != 0) {
+		if (hash->map[i].dist < cur.dist) {
+			struct hash_slot tmp = hash->map[i];
+
+			hash->map[i] = cur;
+			cur = tmp;
+		}
+
+		i = (i + 1) & mask;
+		cur.dist++;
+	}
+
+	hash->map[i] = cur;
+	hash->used++;
+}
+
+static void hash_resize(hash_t *hash, uint32_t order) {
+	struct hash_slot *old = hash->map;
+	uint32_t old_size = (old != NULL) ? 1U << hash->order : 0;
+	uint32_t i;
+
+	hash->order = order;
+	hash->used = 0;
+	hash->map = xcalloc(1U << order, sizeof(*hash->map));
+
+	for (i = 0 ; i < old_size ; i++) {
+		if (old[i].dist != 0)
+			hash_insert(hash, old[i].data, old[i].hash);
+	}
+
+	free(old);
+}
+
+/*
+** Find the slot of the entry that matches "key", or -1.
+*/
+
+static int64_t hash_slot(hash_t *hash, void *key) {
+	uint32_t mask;
+	uint32_t val;
+	uint32_t dist;
+	uint32_t i;
+
+	if (hash->used == 0)
+		return (-1);
+
+	mask = (1U << hash->order) - 1;
+	val = hash->hashfn(key);
+	i = hash_home(hash, val);
+
+	for (dist = 1 ; hash->map[i].dist >= dist ; dist++) {
+		if (hash->map[i].hash == val && !hash->compare(key, hash->map[i].data))
+			return (i);
+
+		i = (i + 1) & mask;
+	}
+
+	return (-1);
+}
+
+/*
+** Set up a hash table with room for about 2^"order" entries to start
+** with. "hashfn" hashes the keys that are passed to hash_add(),
+** hash_find() and hash_remove(), and compare(key, data) returns 0 if
+** "data" is the entry for "key".
+*/
+
 int hash_init(	hash_t *hash,
 				uint32_t order,
+				uint32_t (*hashfn)(const void *),
 				int (*compare)(void *, void *),
 				void (*rem)(void *param, void *data))
 {
-	if (compare == NULL)
+	if (hashfn == NULL || compare == NULL)
 		return (-1);
 
-	if (order > sizeof(long) * 4)
+	if (order > HASH_MAX_ORDER - 1)
 		return (-1);
 
-	hash->order = order;
+	hash->hashfn = hashfn;
 	hash->compare = compare;
 	hash->remove = rem;
-	hash->map = xcalloc((uint32_t) (1 << order), sizeof(dlist_t *));
+	hash->map = NULL;
+	hash_resize(hash, max(order + 1, HASH_MIN_ORDER));
 
 	return (0);
 }
 
-inline dlist_t *hash_find(hash_t *hash, void *data, uint32_t cur_hash) {
-	return (dlist_find(hash->map[cur_hash], data, hash->compare));
+void *hash_find(hash_t *hash, void *key) {
+	int64_t i = hash_slot(hash, key);
+
+	if (i == -1)
+		return (NULL);
+
+	return (hash->map[i].data);
 }
 
-inline void hash_add(hash_t *hash, void *data, uint32_t cur_hash) {
-	hash->map[cur_hash] = dlist_add_head(hash->map[cur_hash], data);
+/*
+** Add "data" under "key". The table is doubled in size when it's
+** more than 7/8 full.
+*/
+
+void hash_add(hash_t *hash, void *key, void *data) {
+	uint32_t size = 1U << hash->order;
+
+	if ((hash->used + 1) * 8 > size * 7 && hash->order < HASH_MAX_ORDER)
+		hash_resize(hash, hash->order + 1);
+
+	hash_insert(hash, data, hash->hashfn(key));
 }
 
-int hash_remove(hash_t *hash, void *data, uint32_t cur_hash) {
-	dlist_t *node = hash_find(hash, data, cur_hash);
+/*
+** Remove the entry for "key", shifting the entries after it back
+** toward their home slots so that no tombstone is needed.
+*/
+
+int hash_remove(hash_t *hash, void *key) {
+	int64_t found = hash_slot(hash, key);
+	uint32_t mask = (1U << hash->order) - 1;
+	uint32_t i;
 
-	if (node == NULL)
+	if (found == -1)
 		return (-1);
 
 	if (hash->remove != NULL)
-		hash->remove(NULL, node->data);
+		hash->remove(NULL, hash->map[found].data);
+
+	i = found;
+	while (1) {
+		uint32_t next = (i + 1) & mask;
+
+		if (hash->map[next].dist <= 1)
+			break;
+
+		hash->map[i] = hash->map[next];
+		hash->map[i].dist--;
+		i = next;
+	}
 
-	hash->map[cur_hash] = dlist_remove(hash->map[cur_hash], node);
+	memset(&hash->map[i], 0, sizeof(hash->map[i]));
+	hash->used--;
 	return (0);
 }
 
 void hash_clear(hash_t *hash) {
-	if (hash->order > 0) {
-		uint32_t i;
+	uint32_t i;
 
-		for (i = 0 ; i < (uint32_t) (1 << hash->order) ; i++) {
-			dlist_destroy(hash->map[i], NULL, hash->remove);
-			hash->map[i] = NULL;
-		}
+	if (hash->map == NULL)
+		return;
+
+	for (i = 0 ; i < (1U << hash->order) ; i++) {
+		if (hash->map[i].dist != 0 && hash->remove != NULL)
+			hash->remove(NULL, hash->map[i].data);
 	}
+
+	memset(hash->map, 0, (1U << hash->order) * sizeof(*hash->map));
+	hash->used = 0;
 }
 
 void hash_destroy(hash_t *hash) {
 	hash_clear(hash);
 	free(hash->map);
+	hash->map = NULL;
 }
 
 void hash_iterate(hash_t *hash, void (*func)(void *, void *), void *data) {
 	uint32_t i;
 
-	for (i = 0 ; i < (uint32_t) (1 << hash->order) ; i++)
-		dlist_iterate(hash->map[i], func, data);
-}
+	if (hash->map == NULL)
+		return;
 
-inline int hash_exists(hash_t *hash, void *data, uint32_t cur_hash) {
-	dlist_t *ret = hash_find(hash, data, cur_hash);
+	for (i = 0 ; i < (1U << hash->order) ; i++) {
+		if (hash->map[i].dist != 0)
+			func(hash->map[i].data, data);
+	}
+}
 
-	return (ret != NULL);
+int hash_exists(hash_t *hash, void *key) {
+	return (hash_slot(hash, key) != -1);
 }
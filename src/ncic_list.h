@@ -31,24 +31,132 @@ dlist_t *dlist_tail(dlist_t *head);
 void dlist_iterate(dlist_t *head, void (*func)(void *, void *), void *data);
 size_t dlist_len(dlist_t *head);
 
+/*
+** Intrusive lists. The links live in the structures being listed, so
+** adding one to a list doesn't allocate anything, and walking the list
+** goes straight from one structure to the next. Like dlist_t, the list
+** is NULL-terminated in both directions. A structure can be on one list
+** per link it has.
+**
+**	struct foo {
+**		ILIST_LINK(foo) link;
+**		...
+**	};
+**
+**	ILIST_HEAD(foo_list, foo) foos;
+*/
+
+#define ILIST_HEAD(name, type)												\
+	struct name {															\
+		struct type *first;													\
+		struct type *last;													\
+	}
+
+#define ILIST_LINK(type)													\
+	struct {																\
+		struct type *next;													\
+		struct type *prev;													\
+	}
+
+#define ilist_init(head)	((head)->first = (head)->last = NULL)
+#define ilist_empty(head)	((head)->first == NULL)
+#define ilist_first(head)	((head)->first)
+#define ilist_last(head)	((head)->last)
+#define ilist_next(elm, field)	((elm)->field.next)
+#define ilist_prev(elm, field)	((elm)->field.prev)
+
+#define ilist_add_head(head, elm, field) do {								\
+	(elm)->field.prev = NULL;												\
+	(elm)->field.next = (head)->first;										\
+	if ((head)->first != NULL)												\
+		(head)->first->field.prev = (elm);									\
+	else																	\
+		(head)->last = (elm);												\
+	(head)->first = (elm);													\
+} while (0)
+
+#define ilist_add_tail(head, elm, field) do {								\
+	(elm)->field.next = NULL;												\
+	(elm)->field.prev = (head)->last;										\
+	if ((head)->last != NULL)												\
+		(head)->last->field.next = (elm);									\
+	else																	\
+		(head)->first = (elm);												\
+	(head)->last = (elm);													\
+} while (0)
+
+#define ilist_add_after(head, listelm, elm, field) do {						\
+	(elm)->field.prev = (listelm);											\
+	(elm)->field.next = (listelm)->field.next;								\
+	if ((listelm)->field.next != NULL)										\
+		(listelm)->field.next->field.prev = (elm);							\
+	else																	\
+		(head)->last = (elm);												\
+	(listelm)->field.next = (elm);											\
+} while (0)
+
+#define ilist_remove(head, elm, field) do {									\
+	if ((elm)->field.next != NULL)											\
+		(elm)->field.next->field.prev = (elm)->field.prev;					\
+	else																	\
+		(head)->last = (elm)->field.prev;									\
+	if ((elm)->field.prev != NULL)											\
+		(elm)->field.prev->field.next = (elm)->field.next;					\
+	else																	\
+		(head)->first = (elm)->field.next;									\
+} while (0)
+
+#define ilist_foreach(var, head, field)										\
+	for ((var) = (head)->first ; (var) != NULL ; (var) = (var)->field.next)
+
+#define ilist_foreach_reverse(var, head, field)								\
+	for ((var) = (head)->last ; (var) != NULL ; (var) = (var)->field.prev)
+
+/* Safe against removal of "var" from the list. */
+#define ilist_foreach_safe(var, tmp, head, field)							\
+	for ((var) = (head)->first ;											\
+		(var) != NULL && ((tmp) = (var)->field.next, 1) ;					\
+		(var) = (tmp))
+
+/*
+** Hash tables use open addressing with Robin Hood probing, and grow as
+** they fill up. Each slot keeps the full hash of its entry, so the
+** table can be grown without hashing the keys again and most
+** mismatches are skipped without calling compare().
+*/
+
+#define HASH_MIN_ORDER	3
+#define HASH_MAX_ORDER	30
+
+struct hash_slot {
+	void *data;
+	uint32_t hash;
+
+	/* how far the entry is from its home slot, plus one; 0 if empty */
+	uint32_t dist;
+};
+
 typedef struct hash {
 	uint32_t order;
-	int (*compare)(void *l, void *r);
+	uint32_t used;
+	uint32_t (*hashfn)(const void *key);
+	int (*compare)(void *key, void *data);
 	void (*remove)(void *param, void *data);
-	dlist_t **map;
+	struct hash_slot *map;
 } hash_t;
 
 int hash_init(	hash_t *hash,
 				uint32_t order,
+				uint32_t (*hashfn)(const void *),
 				int (*compare)(void *, void *),
 				void (*rem)(void *param, void *data));
 
-dlist_t *hash_find(hash_t *hash, void *data, uint32_t cur_hash);
-void hash_add(hash_t *hash, void *data, uint32_t cur_hash);
-int hash_remove(hash_t *hash, void *data, uint32_t cur_hash);
+void *hash_find(hash_t *hash, void *key);
+void hash_add(hash_t *hash, void *key, void *data);
+int hash_remove(hash_t *hash, void *key);
 void hash_clear(hash_t *hash);
 void hash_destroy(hash_t *hash);
-int hash_exists(hash_t *hash, void *data, uint32_t cur_hash);
+int hash_exists(hash_t *hash, void *key);
 void hash_iterate(hash_t *hash, void (*func)(void *, void *), void *data);
 
 #endif /* __NCIC_LIST_H__ */
@@ -0,0 +1,1017 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <ncurses.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "ncic_queue.h"
+#include "ncic_io.h"
+#include "ncic_set.h"
+#include "ncic_screen_io.h"
+#include "ncic_log.h"
+
+enum {
+	LOG_FSYNC_NEVER,
+	LOG_FSYNC_CLOSE,
+	LOG_FSYNC_BATCH,
+	LOG_FSYNC_INTERVAL
+};
+
+/*
+** The main thread appends to "buf". The writer thread swaps it with
+** "wbuf" when it's time to write, so that it can write without
+** holding the lock.
+*/
+
+struct log {
+	char *path;
+	int fd;
+
+	char *buf;
+	size_t len;
+	size_t size;
+	char *wbuf;
+	size_t wsize;
+	size_t wlen;
+
+	/* messages that didn't fit in the queue since the last one that did */
+	uint32_t dropped;
+
+	/*
+	** Bytes in the file, counting what's queued, and when it's next
+	** due to be rotated by LOG_ROTATE_DAILY.
+	*/
+	uint64_t file_size;
+	time_t next_day;
+	time_t last_rotated;
+	uint32_t rotate_seq;
+
+	/*
+	** A rotation that's been asked for, and where in "buf" the new
+	** file starts. The writer thread moves it to "wrotate_path" along
+	** with the buffer.
+	*/
+	char *rotate_path;
+	size_t rotate_mark;
+	char *wrotate_path;
+	size_t wrotate_mark;
+
+	time_t synced;
+	int raw;
+
+	/*
+	** "closing" is set by the main thread under the lock, and "failing"
+	** is only touched by the writer thread without it, so they can't
+	** share a word as bitfields.
+	*/
+	int closing;
+	int failing;
+};
+
+/*
+** Everything below is protected by "loglock". Errors from the writer
+** thread are put on "errors" and reported from the main loop, which
+** is woken up by a byte written to the pipe.
+*/
+
+static pthread_t logthread;
+static pthread_mutex_t loglock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t logcond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t spacecond = PTHREAD_COND_INITIALIZER;
+static dlist_t *logs;
+static pork_queue_t *errors;
+static int logpipe[2] = { -1, -1 };
+static int logthread_running;
+static int logthread_quit;
+
+/* bytes and messages waiting to be written, and when the first was queued */
+static size_t queued;
+static uint32_t queued_msgs;
+static uint64_t queued_since;
+static uint32_t closing;
+static int overflowed;
+
+static uint32_t log_batch;
+static uint32_t log_batch_msec;
+static int log_fsync;
+static uint32_t log_fsync_secs;
+static int log_overflow_block;
+static size_t log_queue_max;
+static int log_compress;
+
+/*
+** Rotated logs are compressed by their own thread, so that a big
+** file never holds up writing. Protected by "ziplock".
+*/
+
+static pthread_t zipthread;
+static pthread_mutex_t ziplock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zipcond = PTHREAD_COND_INITIALIZER;
+static pork_queue_t *zipq;
+static int zipthread_running;
+static int zipthread_quit;
+
+static struct log_stats log_stats;
+
+static uint64_t log_now_msec(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*
+** Read the log options. Called when any of them are changed.
+*/
+
+void log_set_opts(void) {
+	char *fsync_opt = opt_get_str(OPT_LOG_FSYNC);
+	char *overflow = opt_get_str(OPT_LOG_OVERFLOW);
+	int fsync_mode = LOG_FSYNC_CLOSE;
+	uint32_t fsync_secs = 0;
+
+	if (fsync_opt == NULL || !strcasecmp(fsync_opt, "close"))
+		fsync_mode = LOG_FSYNC_CLOSE;
+	else if (!strcasecmp(fsync_opt, "never"))
+		fsync_mode = LOG_FSYNC_NEVER;
+	else if (!strcasecmp(fsync_opt, "batch"))
+		fsync_mode = LOG_FSYNC_BATCH;
+	else if (str_to_uint(fsync_opt, &fsync_secs) == 0 && fsync_secs > 0)
+		fsync_mode = LOG_FSYNC_INTERVAL;
+	else
+		screen_err_msg("Bad value for LOG_FSYNC: %s", fsync_opt);
+
+	if (overflow != NULL && strcasecmp(overflow, "drop") &&
+		strcasecmp(overflow, "block"))
+	{
+		screen_err_msg("Bad value for LOG_OVERFLOW: %s", overflow);
+	}
+
+	pthread_mutex_lock(&loglock);
+	log_batch = opt_get_int(OPT_LOG_BATCH);
+	log_batch_msec = opt_get_int(OPT_LOG_BATCH_MSEC);
+	log_fsync = fsync_mode;
+	log_fsync_secs = fsync_secs;
+	log_overflow_block = (overflow != NULL && !strcasecmp(overflow, "block"));
+	log_queue_max = (size_t) opt_get_int(OPT_LOG_QUEUE) * 1024;
+	log_compress = opt_get_bool(OPT_LOG_COMPRESS);
+	pthread_cond_signal(&logcond);
+	pthread_cond_broadcast(&spacecond);
+	pthread_mutex_unlock(&loglock);
+}
+
+/*
+** Pass an error to the main loop to be shown. Called from the
+** background threads.
+*/
+
+static void log_report(const char *fmt, ...) {
+	char buf[1024];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	pthread_mutex_lock(&loglock);
+	queue_add(errors, xstrdup(buf));
+	pthread_mutex_unlock(&loglock);
+
+	if (write(logpipe[1], "", 1) == -1 && errno != EAGAIN)
+		debug("write: %s", strerror(errno));
+}
+
+static void log_error(struct log *log, int err) {
+	if (log->failing)
+		return;
+
+	log->failing = 1;
+	log_report("Error writing logfile %s: %s", log->path, strerror(err));
+}
+
+static void log_sync(struct log *log) {
+	if (fsync(log->fd) != 0 && errno != EINVAL)
+		log_error(log, errno);
+
+	log->synced = time(NULL);
+}
+
+/*
+** Write out part of what was swapped into "wbuf". Called without
+** the lock.
+*/
+
+static int log_flush(struct log *log, const char *p, size_t len) {
+
+	while (len > 0) {
+		ssize_t ret = write(log->fd, p, len);
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+
+			log_error(log, errno);
+			return (-1);
+		}
+
+		p += ret;
+		len -= ret;
+	}
+
+	log->failing = 0;
+	return (0);
+}
+
+/*
+** Wait until there's a batch worth writing: LOG_BATCH messages, or
+** messages that have been waiting LOG_BATCH_MSEC milliseconds, or a
+** log to be closed. Called with the lock held. With nothing queued it
+** always waits, even if LOG_BATCH is 0.
+*/
+
+static void log_wait(void) {
+	while (!logthread_quit && closing == 0 &&
+		(queued_msgs == 0 || queued_msgs < log_batch))
+	{
+		uint64_t deadline;
+		struct timespec ts;
+
+		if (queued_msgs == 0) {
+			pthread_cond_wait(&logcond, &loglock);
+			continue;
+		}
+
+		deadline = queued_since + log_batch_msec;
+		if (log_now_msec() >= deadline)
+			break;
+
+		ts.tv_sec = deadline / 1000;
+		ts.tv_nsec = (deadline % 1000) * 1000000;
+		pthread_cond_timedwait(&logcond, &loglock, &ts);
+	}
+}
+
+static void log_free(struct log *log) {
+	close(log->fd);
+	free(log->buf);
+	free(log->wbuf);
+	free(log->rotate_path);
+	free(log->wrotate_path);
+	free(log->path);
+	free(log);
+}
+
+static int log_zip_quitting(void) {
+	int quit;
+
+	pthread_mutex_lock(&ziplock);
+	quit = zipthread_quit;
+	pthread_mutex_unlock(&ziplock);
+
+	return (quit);
+}
+
+/*
+** Compress "path" to "path.gz" and remove it. The file is written
+** under a temporary name first, so that a half finished one is
+** never mistaken for the real thing. If the client is exiting, this
+** gives up and leaves "path" as it is.
+*/
+
+static void log_gzip(const char *path) {
+	char gzpath[PATH_MAX];
+	char tmppath[PATH_MAX];
+	char buf[65536];
+	gzFile gz;
+	ssize_t ret;
+	int quit = 0;
+	int err = 0;
+	int fd;
+	int zfd;
+
+	if (snprintf(gzpath, sizeof(gzpath), "%s.gz", path) >= (int) sizeof(gzpath) ||
+		snprintf(tmppath, sizeof(tmppath), "%s.gz.tmp", path) >= (int) sizeof(tmppath))
+	{
+		log_report("Unable to compress %s: %s", path, strerror(ENAMETOOLONG));
+		return;
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		log_report("Unable to compress %s: %s", path, strerror(errno));
+		return;
+	}
+
+	zfd = open(tmppath, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+	if (zfd == -1 || (gz = gzdopen(zfd, "wb")) == NULL) {
+		log_report("Unable to compress %s: %s", path, strerror(errno));
+		if (zfd != -1)
+			close(zfd);
+		close(fd);
+		return;
+	}
+
+	while (1) {
+		ret = read(fd, buf, sizeof(buf));
+		if (ret == 0)
+			break;
+
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+
+			err = errno;
+			break;
+		}
+
+		if (gzwrite(gz, buf, ret) != ret) {
+			err = EIO;
+			break;
+		}
+
+		quit = log_zip_quitting();
+		if (quit)
+			break;
+	}
+
+	close(fd);
+
+	if (gzclose(gz) != Z_OK && err == 0)
+		err = EIO;
+
+	if (err == 0 && !quit && rename(tmppath, gzpath) != 0)
+		err = errno;
+
+	if (err != 0 || quit) {
+		unlink(tmppath);
+		if (err != 0)
+			log_report("Unable to compress %s: %s", path, strerror(err));
+		return;
+	}
+
+	unlink(path);
+}
+
+static void *log_zip_thread(void *arg __notused) {
+	pthread_mutex_lock(&ziplock);
+
+	while (!zipthread_quit) {
+		char *path = queue_get(zipq);
+
+		if (path == NULL) {
+			pthread_cond_wait(&zipcond, &ziplock);
+			continue;
+		}
+
+		pthread_mutex_unlock(&ziplock);
+		log_gzip(path);
+		free(path);
+		pthread_mutex_lock(&ziplock);
+	}
+
+	pthread_mutex_unlock(&ziplock);
+	return (NULL);
+}
+
+/*
+** Hand a rotated log to the compression thread, starting it if it
+** isn't running. Takes ownership of "path". Called from the writer
+** thread.
+*/
+
+static void log_zip_add(char *path) {
+	pthread_mutex_lock(&ziplock);
+
+	if (!zipthread_running) {
+		zipq = queue_new(0);
+		zipthread_quit = 0;
+
+		if (pthread_create(&zipthread, NULL, log_zip_thread, NULL) != 0) {
+			pthread_mutex_unlock(&ziplock);
+			queue_destroy(zipq, free);
+			zipq = NULL;
+			log_report("Unable to start a thread to compress %s", path);
+			free(path);
+			return;
+		}
+
+		zipthread_running = 1;
+	}
+
+	queue_add(zipq, path);
+	pthread_cond_signal(&zipcond);
+	pthread_mutex_unlock(&ziplock);
+}
+
+/*
+** Move the log's file aside to the name it's being rotated to, and
+** start a new one in its place. If the file can't be moved, writing
+** carries on in the old one. Returns 0 if the log was rotated.
+*/
+
+static int log_switch(struct log *log, int sync, int compress) {
+	char *path = log->wrotate_path;
+	int err = 0;
+	int fd;
+
+	log->wrotate_path = NULL;
+
+	/* Never write over an older rotated log. */
+	if (access(path, F_OK) == 0)
+		err = EEXIST;
+	else if (errno != ENOENT || rename(log->path, path) != 0)
+		err = errno;
+
+	if (err != 0) {
+		log_report("Unable to rotate %s to %s: %s", log->path, path,
+			strerror(err));
+		free(path);
+		return (-1);
+	}
+
+	fd = open(log->path, O_CREAT | O_APPEND | O_WRONLY, 0600);
+	if (fd == -1) {
+		log_report("Unable to open %s for writing: %s", log->path,
+			strerror(errno));
+		free(path);
+		return (-1);
+	}
+
+	if (sync)
+		log_sync(log);
+
+	close(log->fd);
+	log->fd = fd;
+	log->synced = time(NULL);
+	log->failing = 0;
+
+	if (compress && !log->raw)
+		log_zip_add(path);
+	else
+		free(path);
+
+	return (0);
+}
+
+static void *log_thread(void *arg __notused) {
+	while (1) {
+		struct log_stats stats;
+		dlist_t *first;
+		dlist_t *last = NULL;
+		dlist_t *cur;
+		dlist_t *done = NULL;
+		size_t written = 0;
+		uint32_t closed = 0;
+		int fsync_mode;
+		int compress;
+		int quit;
+
+		memset(&stats, 0, sizeof(stats));
+
+		pthread_mutex_lock(&loglock);
+		log_wait();
+		quit = logthread_quit;
+		fsync_mode = log_fsync;
+		compress = log_compress;
+
+		/*
+		** Take everything that's queued now. New logs are only ever
+		** added to the head of the list and only this thread removes
+		** them, so the rest of the list can be walked without the lock.
+		*/
+
+		first = logs;
+		for (cur = first ; cur != NULL ; cur = cur->next) {
+			struct log *log = cur->data;
+			char *buf = log->buf;
+			size_t size = log->size;
+
+			log->buf = log->wbuf;
+			log->size = log->wsize;
+			log->wbuf = buf;
+			log->wsize = size;
+			log->wlen = log->len;
+			log->len = 0;
+			log->wrotate_path = log->rotate_path;
+			log->wrotate_mark = log->rotate_mark;
+			log->rotate_path = NULL;
+			written += log->wlen;
+			last = cur;
+		}
+
+		queued_msgs = 0;
+		pthread_mutex_unlock(&loglock);
+
+		/*
+		** Write the logs out in the order they were opened, oldest
+		** first, so a binary log's records are out before the index
+		** entries that point at them.
+		*/
+
+		for (cur = last ; cur != NULL ;
+			cur = (cur == first ? NULL : cur->prev))
+		{
+			struct log *log = cur->data;
+			size_t mark = 0;
+
+			/* What was queued before the rotation goes in the old file. */
+			if (log->wrotate_path != NULL) {
+				mark = log->wrotate_mark;
+
+				if (mark > 0 && log_flush(log, log->wbuf, mark) == 0) {
+					stats.bytes += mark;
+					stats.writes++;
+				}
+
+				if (log_switch(log, fsync_mode != LOG_FSYNC_NEVER, compress) == 0)
+					stats.rotations++;
+			}
+
+			if (log->wlen == mark ||
+				log_flush(log, log->wbuf + mark, log->wlen - mark) != 0)
+			{
+				continue;
+			}
+
+			stats.bytes += log->wlen - mark;
+			stats.writes++;
+
+			if (fsync_mode == LOG_FSYNC_BATCH ||
+				(fsync_mode == LOG_FSYNC_INTERVAL &&
+				time(NULL) - log->synced >= (time_t) log_fsync_secs))
+			{
+				log_sync(log);
+				stats.syncs++;
+			}
+		}
+
+		pthread_mutex_lock(&loglock);
+
+		/*
+		** A log can be closed once everything that was written to it
+		** before it was closed is out.
+		*/
+
+		cur = logs;
+		while (cur != NULL) {
+			dlist_t *next = cur->next;
+			struct log *log = cur->data;
+
+			if (log->closing && log->len == 0) {
+				logs = dlist_remove(logs, cur);
+				done = dlist_add_head(done, log);
+				closed++;
+			}
+
+			cur = next;
+		}
+
+		queued -= written;
+		closing -= closed;
+		log_stats.bytes += stats.bytes;
+		log_stats.writes += stats.writes;
+		log_stats.syncs += stats.syncs;
+		log_stats.rotations += stats.rotations;
+		pthread_cond_broadcast(&spacecond);
+
+		if (fsync_mode != LOG_FSYNC_NEVER)
+			log_stats.syncs += closed;
+
+		quit = quit && queued == 0 && closing == 0;
+		pthread_mutex_unlock(&loglock);
+
+		while (done != NULL) {
+			struct log *log = dlist_remove_head(&done);
+
+			if (fsync_mode != LOG_FSYNC_NEVER)
+				log_sync(log);
+
+			log_free(log);
+		}
+
+		if (quit)
+			break;
+	}
+
+	return (NULL);
+}
+
+static void log_errors(int fd, u_int32_t cond __notused, void *data __notused) {
+	char buf[64];
+	char *msg;
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	while (1) {
+		pthread_mutex_lock(&loglock);
+		msg = queue_get(errors);
+		pthread_mutex_unlock(&loglock);
+
+		if (msg == NULL)
+			break;
+
+		screen_err_msg("%s", msg);
+		free(msg);
+	}
+}
+
+static int log_start(void) {
+	pthread_condattr_t attr;
+
+	if (pipe(logpipe) != 0) {
+		debug("pipe: %s", strerror(errno));
+		return (-1);
+	}
+
+	fcntl(logpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(logpipe[1], F_SETFL, O_NONBLOCK);
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	/*
+	** Nothing can be waiting on it before the writer thread starts, so
+	** it's safe to swap in one that times out on the monotonic clock.
+	*/
+	pthread_cond_destroy(&logcond);
+	pthread_cond_init(&logcond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	errors = queue_new(0);
+	logthread_quit = 0;
+	log_set_opts();
+
+	if (pthread_create(&logthread, NULL, log_thread, NULL) != 0) {
+		debug("pthread_create failed");
+		close(logpipe[0]);
+		close(logpipe[1]);
+		queue_destroy(errors, free);
+		return (-1);
+	}
+
+	pork_io_add(logpipe[0], IO_COND_READ, NULL, &logpipe, log_errors);
+	logthread_running = 1;
+	return (0);
+}
+
+static time_t log_next_day(time_t now) {
+	struct tm tm;
+
+	localtime_r(&now, &tm);
+	tm.tm_sec = 0;
+	tm.tm_min = 0;
+	tm.tm_hour = 0;
+	tm.tm_mday++;
+	tm.tm_isdst = -1;
+
+	return (mktime(&tm));
+}
+
+/*
+** Open a log file for appending, starting the writer thread if it
+** isn't running yet. Returns NULL with errno set on failure.
+*/
+
+struct log *log_open(const char *path, uint32_t flags) {
+	struct log *log;
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_CREAT | O_APPEND | O_WRONLY, 0600);
+	if (fd == -1)
+		return (NULL);
+
+	if (!logthread_running && log_start() != 0) {
+		close(fd);
+		errno = EAGAIN;
+		return (NULL);
+	}
+
+	log = xcalloc(1, sizeof(*log));
+	log->path = xstrdup(path);
+	log->fd = fd;
+	log->synced = time(NULL);
+	log->next_day = log_next_day(log->synced);
+	log->raw = !!(flags & LOG_RAW);
+
+	if (fstat(fd, &st) == 0)
+		log->file_size = st.st_size;
+
+	pthread_mutex_lock(&loglock);
+	logs = dlist_add_head(logs, log);
+	pthread_mutex_unlock(&loglock);
+
+	return (log);
+}
+
+static void log_append(struct log *log, const void *data, size_t len) {
+	if (log->len + len > log->size) {
+		size_t size = max(log->size * 2, 4096);
+
+		while (size < log->len + len)
+			size *= 2;
+
+		log->buf = xrealloc(log->buf, size);
+		log->size = size;
+	}
+
+	memcpy(log->buf + log->len, data, len);
+	log->len += len;
+	log->file_size += len;
+	queued += len;
+}
+
+/*
+** Queue a message to be written to the log. If the queue is full,
+** the message is dropped (and a note saying how many were lost is
+** written before the next one), or with LOG_OVERFLOW set to "block",
+** this waits for the writer thread to make room. Returns 0 if the
+** message was queued and -1 if it was dropped.
+*/
+
+int log_writev(struct log *log, const struct iovec *iov, int cnt) {
+	size_t total = 0;
+	int warn = 0;
+	int i;
+
+	for (i = 0 ; i < cnt ; i++)
+		total += iov[i].iov_len;
+
+	pthread_mutex_lock(&loglock);
+
+	while (log_overflow_block && log_queue_max != 0 && queued != 0 &&
+		queued + total > log_queue_max)
+	{
+		pthread_cond_wait(&spacecond, &loglock);
+	}
+
+	if (log_queue_max != 0 && queued + total > log_queue_max) {
+		log->dropped++;
+		log_stats.dropped++;
+		warn = !overflowed;
+		overflowed = 1;
+		pthread_mutex_unlock(&loglock);
+
+		if (warn)
+			screen_err_msg("The log queue is full; messages aren't being logged");
+		return (-1);
+	}
+
+	overflowed = 0;
+
+	if (log->dropped > 0 && !log->raw) {
+		char note[128];
+		int len;
+
+		len = snprintf(note, sizeof(note),
+			"---------- %u message%s not logged ----------\n",
+			log->dropped, (log->dropped == 1) ? " was" : "s were");
+		log_append(log, note, len);
+	}
+
+	log->dropped = 0;
+
+	for (i = 0 ; i < cnt ; i++)
+		log_append(log, iov[i].iov_base, iov[i].iov_len);
+
+	log_stats.msgs++;
+
+	if (++queued_msgs == 1) {
+		queued_since = log_now_msec();
+		pthread_cond_signal(&logcond);
+	} else if (queued_msgs >= log_batch)
+		pthread_cond_signal(&logcond);
+
+	pthread_mutex_unlock(&loglock);
+	return (0);
+}
+
+/*
+** Close a log. The writer thread closes the file and frees it once
+** everything that was queued for it has been written.
+*/
+
+void log_close(struct log *log) {
+	pthread_mutex_lock(&loglock);
+	log->closing = 1;
+	closing++;
+	pthread_cond_signal(&logcond);
+	pthread_mutex_unlock(&loglock);
+}
+
+/*
+** Whether it's time for this log to be rotated, by LOG_ROTATE_SIZE or
+** LOG_ROTATE_DAILY.
+*/
+
+int log_rotate_due(struct log *log, time_t now) {
+	uint64_t max_size = (uint64_t) opt_get_int(OPT_LOG_ROTATE_SIZE) << 20;
+	int pending;
+
+	if ((max_size == 0 || log->file_size < max_size) &&
+		(!opt_get_bool(OPT_LOG_ROTATE_DAILY) || now < log->next_day))
+	{
+		return (0);
+	}
+
+	pthread_mutex_lock(&loglock);
+	pending = (log->rotate_path != NULL);
+	pthread_mutex_unlock(&loglock);
+
+	return (!pending);
+}
+
+/*
+** Make the name this log will be rotated to: its path with the time
+** added, and a number if it's already been rotated this second.
+*/
+
+int log_rotate_path(struct log *log, time_t now, char *buf, size_t len) {
+	char stamp[32];
+	struct tm tm;
+	int ret;
+
+	localtime_r(&now, &tm);
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+	if (now == log->last_rotated)
+		log->rotate_seq++;
+	else
+		log->rotate_seq = 0;
+
+	log->last_rotated = now;
+
+	if (log->rotate_seq == 0)
+		ret = snprintf(buf, len, "%s.%s", log->path, stamp);
+	else
+		ret = snprintf(buf, len, "%s.%s-%u", log->path, stamp, log->rotate_seq);
+
+	if (ret < 0 || (size_t) ret >= len)
+		return (-1);
+
+	return (0);
+}
+
+/*
+** Rotate a log: everything queued so far goes in the file it has
+** now, which the writer thread then renames to "path" (and compresses,
+** with LOG_COMPRESS), and what's queued from here on goes in a new
+** file, starting with "hdr". The message queue limit doesn't apply
+** to "hdr". Returns -1 if a rotation is already waiting to be done.
+*/
+
+int log_rotate(	struct log *log,
+				const char *path,
+				const void *hdr,
+				size_t len,
+				time_t now)
+{
+	pthread_mutex_lock(&loglock);
+
+	if (log->rotate_path != NULL) {
+		pthread_mutex_unlock(&loglock);
+		return (-1);
+	}
+
+	log->rotate_path = xstrdup(path);
+	log->rotate_mark = log->len;
+	log->file_size = 0;
+	log->next_day = log_next_day(now);
+
+	if (len > 0) {
+		log_append(log, hdr, len);
+
+		if (++queued_msgs == 1) {
+			queued_since = log_now_msec();
+			pthread_cond_signal(&logcond);
+		}
+	}
+
+	pthread_mutex_unlock(&loglock);
+	return (0);
+}
+
+void log_get_stats(struct log_stats *stats) {
+	pthread_mutex_lock(&loglock);
+	*stats = log_stats;
+	pthread_mutex_unlock(&loglock);
+}
+
+/*
+** Write out everything that's queued and stop the writer thread.
+*/
+
+void log_destroy(void) {
+	if (!logthread_running)
+		return;
+
+	pthread_mutex_lock(&loglock);
+	logthread_quit = 1;
+	pthread_cond_signal(&logcond);
+	pthread_mutex_unlock(&loglock);
+
+	pthread_join(logthread, NULL);
+	logthread_running = 0;
+
+	/* Logs that are still waiting to be compressed are left as they are. */
+	if (zipthread_running) {
+		pthread_mutex_lock(&ziplock);
+		zipthread_quit = 1;
+		pthread_cond_signal(&zipcond);
+		pthread_mutex_unlock(&ziplock);
+
+		pthread_join(zipthread, NULL);
+		zipthread_running = 0;
+		queue_destroy(zipq, free);
+		zipq = NULL;
+	}
+
+	pork_io_del(&logpipe);
+	close(logpipe[0]);
+	close(logpipe[1]);
+
+	while (logs != NULL)
+		log_free(dlist_remove_head(&logs));
+
+	queue_destroy(errors, free);
+}
+
+/*
+** Lines the client writes around the messages it logs, like
+** "---------- Log started on ... ----------".
+*/
+
+static int log_is_banner(const char *line, size_t len) {
+	static const char head[] = "---------- ";
+	static const char tail[] = " ----------";
+
+	if (len < sizeof(head) - 1 + sizeof(tail) - 1)
+		return (0);
+
+	return (!memcmp(line, head, sizeof(head) - 1) &&
+		!memcmp(line + len - (sizeof(tail) - 1), tail, sizeof(tail) - 1));
+}
+
+/*
+** Find the last "n" messages in the text log mapped at "map", skipping
+** blank lines and banners. They're stored oldest first at the end of
+** "lines". Returns how many were found.
+*/
+
+size_t log_tail(const char *map, size_t size, struct log_line *lines, size_t n) {
+	const char *end = map + size;
+	size_t found = 0;
+
+	while (end > map && found < n) {
+		const char *p = end;
+		size_t len;
+
+		/* Back up to the start of the line that ends at "end". */
+		while (p > map && p[-1] != '\n')
+			p--;
+
+		len = end - p;
+		if (len > 0 && p[len - 1] == '\r')
+			len--;
+
+		if (len > 0 && !log_is_banner(p, len)) {
+			found++;
+			lines[n - found].text = p;
+			lines[n - found].len = len;
+		}
+
+		/* Step over the newline that ends the line before. */
+		end = (p > map) ? p - 1 : p;
+	}
+
+	return (found);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_LOG_H__
+#define __NCIC_LOG_H__
+
+#include <sys/uio.h>
+
+/*
+** Log files are written by a background thread, so that a slow disk
+** never holds up the main loop. Text is queued in memory and written
+** out in batches.
+*/
+
+struct log;
+
+struct log_stats {
+	uint64_t bytes;
+	uint64_t writes;
+	uint64_t msgs;
+	uint64_t dropped;
+	uint64_t syncs;
+	uint64_t rotations;
+};
+
+/*
+** LOG_RAW keeps anything but what's passed to log_writev() out of
+** the file, for logs that aren't text.
+*/
+
+#define LOG_RAW		0x01
+
+/* A line of a log file that's been mapped into memory */
+struct log_line {
+	const char *text;
+	size_t len;
+};
+
+struct log *log_open(const char *path, uint32_t flags);
+int log_writev(struct log *log, const struct iovec *iov, int cnt);
+void log_close(struct log *log);
+int log_rotate_due(struct log *log, time_t now);
+int log_rotate_path(struct log *log, time_t now, char *buf, size_t len);
+int log_rotate(struct log *log, const char *path, const void *hdr,
+	size_t len, time_t now);
+void log_get_stats(struct log_stats *stats);
+void log_set_opts(void);
+void log_destroy(void);
+
+size_t log_tail(const char *map, size_t size, struct log_line *lines, size_t n);
+
+#endif /* __NCIC_LOG_H__ */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+** A small LZ77 block codec, in the style of LZ4. The compressed data
+** is a series of sequences, each consisting of a token byte (the
+** high nibble is the literal count, the low nibble the match length
+** less LZ_MIN_MATCH), any extra literal length bytes, the literals,
+** a two-byte little-endian match offset and any extra match length
+** bytes. The last sequence has literals only.
+**
+** It's greedy and uses a single hash probe per position, which is
+** plenty for scroll buffer text.
+*/
+
+#include "config.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#include "ncic_lz.h"
+
+#define LZ_MIN_MATCH	4
+#define LZ_MAX_OFFSET	65535
+#define LZ_HASH_BITS	12
+#define LZ_LAST_LITS	5
+
+static inline uint32_t lz_read32(const uint8_t *p) {
+	uint32_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return (val);
+}
+
+static inline uint32_t lz_hash(uint32_t val) {
+	return ((val * 2654435761U) >> (32 - LZ_HASH_BITS));
+}
+
+static uint8_t *lz_put_len(uint8_t *op, size_t len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+
+	*op++ = len;
+	return (op);
+}
+
+/*
+** Compress "len" bytes from "src" into "dst". Returns the compressed
+** size, or 0 if it wouldn't fit in "dst_len" bytes.
+*/
+
+size_t lz_compress(const void *src, size_t len, void *dst, size_t dst_len) {
+	uint32_t table[1 << LZ_HASH_BITS];
+	const uint8_t *base = src;
+	const uint8_t *ip = base;
+	const uint8_t *anchor = base;
+	const uint8_t *end = base + len;
+	const uint8_t *match_limit = end - LZ_LAST_LITS;
+	uint8_t *op = dst;
+	uint8_t *op_end = op + dst_len;
+	size_t lits;
+
+	if (dst_len < lz_bound(len))
+		return (0);
+
+	memset(table, 0, sizeof(table));
+
+	if (len > LZ_MIN_MATCH + LZ_LAST_LITS) {
+		while (ip < match_limit - LZ_MIN_MATCH) {
+			uint32_t seq = lz_read32(ip);
+			uint32_t h = lz_hash(seq);
+			const uint8_t *ref = base + table[h];
+			size_t match_len;
+			uint8_t *token;
+
+			table[h] = ip - base;
+
+			if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq) {
+				ip++;
+				continue;
+			}
+
+			match_len = LZ_MIN_MATCH;
+			while (ip + match_len < match_limit && ref[match_len] == ip[match_len])
+				match_len++;
+
+			lits = ip - anchor;
+			token = op++;
+
+			if (lits >= 15) {
+				*token = 15 << 4;
+				op = lz_put_len(op, lits - 15);
+			} else
+				*token = lits << 4;
+
+			memcpy(op, anchor, lits);
+			op += lits;
+
+			*op++ = (ip - ref) & 0xff;
+			*op++ = (ip - ref) >> 8;
+
+			if (match_len - LZ_MIN_MATCH >= 15) {
+				*token |= 15;
+				op = lz_put_len(op, match_len - LZ_MIN_MATCH - 15);
+			} else
+				*token |= match_len - LZ_MIN_MATCH;
+
+			ip += match_len;
+			anchor = ip;
+		}
+	}
+
+	lits = end - anchor;
+	if (lits >= 15) {
+		*op++ = 15 << 4;
+		op = lz_put_len(op, lits - 15);
+	} else
+		*op++ = lits << 4;
+
+	if (op + lits > op_end)
+		return (0);
+
+	memcpy(op, anchor, lits);
+	op += lits;
+
+	return (op - (uint8_t *) dst);
+}
+
+/*
+** Decompress "len" bytes of compressed data from "src" into
+** "dst", which must be exactly the size of the original data.
+** Returns 0 on success, or -1 if the data is corrupt.
+*/
+
+int lz_decompress(const void *src, size_t len, void *dst, size_t dst_len) {
+	const uint8_t *ip = src;
+	const uint8_t *ip_end = ip + len;
+	uint8_t *op = dst;
+	uint8_t *op_end = op + dst_len;
+
+	while (ip < ip_end) {
+		uint8_t token = *ip++;
+		size_t lits = token >> 4;
+		size_t match_len;
+		size_t offset;
+		const uint8_t *ref;
+
+		if (lits == 15) {
+			uint8_t c;
+
+			do {
+				if (ip >= ip_end)
+					return (-1);
+				c = *ip++;
+				lits += c;
+			} while (c == 255);
+		}
+
+		if (lits > (size_t) (ip_end - ip) || lits > (size_t) (op_end - op))
+			return (-1);
+
+		memcpy(op, ip, lits);
+		ip += lits;
+		op += lits;
+
+		/* The last sequence has no match. */
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			return (-1);
+
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > (size_t) (op - (uint8_t *) dst))
+			return (-1);
+
+		match_len = token & 0x0f;
+		if (match_len == 15) {
+			uint8_t c;
+
+			do {
+				if (ip >= ip_end)
+					return (-1);
+				c = *ip++;
+				match_len += c;
+			} while (c == 255);
+		}
+
+		match_len += LZ_MIN_MATCH;
+		if (match_len > (size_t) (op_end - op))
+			return (-1);
+
+		/* The match can overlap the output, so copy a byte at a time. */
+		ref = op - offset;
+		while (match_len-- > 0)
+			*op++ = *ref++;
+	}
+
+	if (op != op_end)
+		return (-1);
+
+	return (0);
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* for memmem() */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_match.h"
+
+/*
+** Lines longer than this are folded into a temporary buffer
+** on the heap for case-insensitive matching.
+*/
+
+#define MATCH_FOLD_BUF		1024
+
+static inline char match_fold(char c) {
+	if (c >= 'A' && c <= 'Z')
+		c += 'a' - 'A';
+
+	return (c);
+}
+
+/*
+** Fold "len" bytes of "src" to lower case, eight at a time.
+*/
+
+static void match_fold_str(char *dst, const char *src, size_t len) {
+	size_t i;
+
+	for (i = 0 ; i + 8 <= len ; i += 8) {
+		uint64_t w;
+
+		memcpy(&w, src + i, sizeof(w));
+		w = word_tolower(w);
+		memcpy(dst + i, &w, sizeof(w));
+	}
+
+	for (; i < len ; i++)
+		dst[i] = match_fold(src[i]);
+}
+
+/*
+** If "pattern" has no special meaning as a regex, return the string
+** it matches. Escaped punctuation is unescaped. Non-ASCII characters
+** are left to the regex engine, which knows how to fold their case.
+*/
+
+static char *match_literal(const char *pattern, uint32_t flags, size_t *len) {
+	const char *special = (flags & MATCH_BASIC) ? ".[*^$" : ".[()*+?{|^$";
+	char *literal = xmalloc(strlen(pattern) + 1);
+	const char *p;
+	size_t i = 0;
+
+	for (p = pattern ; *p != '\0' ; p++) {
+		char c = *p;
+
+		if (c & 0x80)
+			goto fail;
+
+		if (c == '\\') {
+			c = *++p;
+			if (c == '\0' || isalnum((unsigned char) c) ||
+				strchr("<>`'(){}|+?", c) != NULL)
+			{
+				goto fail;
+			}
+		} else if (strchr(special, c) != NULL)
+			goto fail;
+
+		literal[i++] = (flags & MATCH_ICASE) ? match_fold(c) : c;
+	}
+
+	if (i == 0)
+		goto fail;
+
+	literal[i] = '\0';
+	*len = i;
+	return (literal);
+
+fail:
+	free(literal);
+	return (NULL);
+}
+
+int match_compile(struct match *match, const char *pattern, uint32_t flags) {
+	int cflags = REG_EXTENDED;
+
+	if (flags & MATCH_ICASE)
+		cflags |= REG_ICASE;
+
+	if (flags & MATCH_BASIC)
+		cflags &= ~REG_EXTENDED;
+
+	memset(match, 0, sizeof(*match));
+	match->flags = flags;
+
+	match->literal = match_literal(pattern, flags, &match->literal_len);
+	if (match->literal != NULL)
+		return (0);
+
+	if (regcomp(&match->preg, pattern, cflags) != 0)
+		return (-1);
+
+	return (0);
+}
+
+/*
+** Returns non-zero if "text" matches. If "start" and "end" aren't NULL,
+** they're set to the offsets of the start and end of the first match.
+** It's safe to call from more than one thread at a time.
+*/
+
+int match_exec(struct match *match, const char *text, size_t *start, size_t *end) {
+	const char *found;
+
+	if (match->literal == NULL) {
+		regmatch_t pmatch;
+
+		if (start == NULL)
+			return (regexec(&match->preg, text, 0, NULL, 0) == 0);
+
+		if (regexec(&match->preg, text, 1, &pmatch, 0) != 0)
+			return (0);
+
+		*start = pmatch.rm_so;
+		*end = pmatch.rm_eo;
+		return (1);
+	}
+
+	if (match->flags & MATCH_ICASE) {
+		char buf[MATCH_FOLD_BUF];
+		char *folded = buf;
+		size_t len = strlen(text);
+
+		if (len < match->literal_len)
+			return (0);
+
+		if (len >= sizeof(buf))
+			folded = xmalloc(len + 1);
+
+		match_fold_str(folded, text, len);
+		folded[len] = '\0';
+
+		found = strstr(folded, match->literal);
+		if (found != NULL)
+			found = text + (found - folded);
+
+		if (folded != buf)
+			free(folded);
+	} else
+		found = strstr(text, match->literal);
+
+	if (found == NULL)
+		return (0);
+
+	if (start != NULL) {
+		*start = found - text;
+		*end = *start + match->literal_len;
+	}
+
+	return (1);
+}
+
+/*
+** Like match_exec(), but starts looking at offset "from" in "text",
+** which isn't taken to be the start of a line. The offsets that are
+** returned are from the start of "text".
+*/
+
+int match_next(	struct match *match,
+				const char *text,
+				size_t from,
+				size_t *start,
+				size_t *end)
+{
+	if (match->literal == NULL && from > 0) {
+		regmatch_t pmatch;
+
+		if (regexec(&match->preg, text + from, 1, &pmatch, REG_NOTBOL) != 0)
+			return (0);
+
+		*start = from + pmatch.rm_so;
+		*end = from + pmatch.rm_eo;
+		return (1);
+	}
+
+	if (!match_exec(match, text + from, start, end))
+		return (0);
+
+	*start += from;
+	*end += from;
+	return (1);
+}
+
+/*
+** Find the first place the literal string of "match" occurs in the
+** "len" bytes at "buf", which needn't be NUL-terminated and can hold
+** any number of lines. Returns its offset, or -1. With MATCH_ICASE,
+** the text is folded MATCH_FOLD_BUF bytes at a time, with enough
+** overlap between pieces to catch a match that straddles them.
+*/
+
+ssize_t match_find(struct match *match, const char *buf, size_t len) {
+	char fold[MATCH_FOLD_BUF];
+	size_t overlap = match->literal_len - 1;
+	size_t off = 0;
+
+	if (!(match->flags & MATCH_ICASE)) {
+		const char *found = memmem(buf, len, match->literal, match->literal_len);
+
+		return (found == NULL ? -1 : found - buf);
+	}
+
+	if (match->literal_len > sizeof(fold) / 2) {
+		char *folded = xmalloc(len);
+		const char *found;
+		ssize_t ret;
+
+		match_fold_str(folded, buf, len);
+		found = memmem(folded, len, match->literal, match->literal_len);
+		ret = (found == NULL ? -1 : found - folded);
+		free(folded);
+
+		return (ret);
+	}
+
+	while (off < len) {
+		size_t n = min(len - off, sizeof(fold));
+		const char *found;
+
+		match_fold_str(fold, buf + off, n);
+		found = memmem(fold, n, match->literal, match->literal_len);
+		if (found != NULL)
+			return (off + (found - fold));
+
+		if (off + n == len)
+			break;
+
+		off += n - overlap;
+	}
+
+	return (-1);
+}
+
+/*
+** Like match_exec(), for the "len" bytes at "text", which needn't
+** be NUL-terminated.
+*/
+
+int match_exec_len(struct match *match, const char *text, size_t len) {
+	regmatch_t pmatch;
+
+	if (match->literal != NULL)
+		return (match_find(match, text, len) != -1);
+
+	pmatch.rm_so = 0;
+	pmatch.rm_eo = len;
+	return (regexec(&match->preg, text, 1, &pmatch, REG_STARTEND) == 0);
+}
+
+void match_free(struct match *match) {
+	if (match->literal != NULL)
+		free(match->literal);
+	else
+		regfree(&match->preg);
+}
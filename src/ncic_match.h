@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_MATCH_H__
+#define __NCIC_MATCH_H__
+
+#include <sys/types.h>
+#include <regex.h>
+
+#define MATCH_ICASE		0x01
+#define MATCH_BASIC		0x02
+
+/*
+** A compiled search pattern. Patterns without any regex special
+** characters in them are matched as plain substrings, which is a
+** good deal faster than running them through regexec().
+*/
+
+struct match {
+	uint32_t flags;
+	/* the string to look for, folded to lower case with MATCH_ICASE */
+	char *literal;
+	size_t literal_len;
+	regex_t preg;
+};
+
+int match_compile(struct match *match, const char *pattern, uint32_t flags);
+int match_exec(struct match *match, const char *text, size_t *start, size_t *end);
+int match_next(	struct match *match,
+				const char *text,
+				size_t from,
+				size_t *start,
+				size_t *end);
+
+ssize_t match_find(struct match *match, const char *buf, size_t len);
+int match_exec_len(struct match *match, const char *text, size_t len);
+
+void match_free(struct match *match);
+
+#endif /* __NCIC_MATCH_H__ */
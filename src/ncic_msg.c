@@ -44,33 +44,29 @@ int pork_msg_autoreply(struct pork_acct *acct, char *dest, char *msg) {
 	ret = fill_format_str(OPT_FORMAT_IM_SEND_AUTO, buf, sizeof(buf), acct, dest, msg);
 	if (ret < 1)
 		return (-1);
-	screen_print_str(win, buf, (size_t) ret, MSG_TYPE_PRIVMSG_SEND);
+	screen_print_msg(win, acct->username, buf, (size_t) ret,
+		MSG_TYPE_PRIVMSG_SEND);
 	imwindow_send_msg(win);
 	return (0);
 }
 
 int pork_msg_send_auto(struct pork_acct *acct, char *sender) {
-	dlist_t *node;
-	u_int32_t hash_val;
+	struct autoresp *autoresp;
 	int ret = 0;
 
 	if (acct->away_msg != NULL && acct->proto->send_msg_auto == NULL)
 		return (-1);
 
-	hash_val = string_hash(sender, acct->autoreply.order);
-	node = hash_find(&acct->autoreply, sender, hash_val);
-	if (node == NULL) {
-		struct autoresp *autoresp;
-
+	autoresp = hash_find(&acct->autoreply, sender);
+	if (autoresp == NULL) {
 		autoresp = xcalloc(1, sizeof(*autoresp));
 		autoresp->name = xstrdup(sender);
 		autoresp->last = time(NULL);
 
-		hash_add(&acct->autoreply, autoresp, hash_val);
+		hash_add(&acct->autoreply, autoresp->name, autoresp);
 		ret = pork_msg_autoreply(acct, sender, acct->away_msg);
 	} else {
 		time_t time_now = time(NULL);
-		struct autoresp *autoresp = node->data;
 
 		/*
 		** Only send someone an auto-reply every 10 minutes.
@@ -113,7 +109,7 @@ int pork_recv_msg(	struct pork_acct *acct,
 			sender, userhost, msg);
 	if (ret < 1)
 		return (-1);
-	screen_print_str(win, buf, (size_t) ret, MSG_TYPE_PRIVMSG_RECV);
+	screen_print_msg(win, sender, buf, (size_t) ret, MSG_TYPE_PRIVMSG_RECV);
 	imwindow_recv_msg(win);
 
 	if (acct->away_msg != NULL && !autoresp &&
@@ -180,7 +176,8 @@ int pork_set_away(struct pork_acct *acct, char *msg) {
 	}
 
 	acct->away_msg = xstrdup(msg);
-	hash_init(&acct->autoreply, 3, autoresp_compare_cb, autoresp_destroy_cb);
+	hash_init(&acct->autoreply, 3, string_hash_nocase, autoresp_compare_cb,
+		autoresp_destroy_cb);
 
 	if (acct->proto->set_away != NULL) {
 		if (acct->proto->set_away(acct, msg) == -1) {
@@ -252,7 +249,8 @@ int pork_msg_send(struct pork_acct *acct, char *dest, char *msg) {
 			ret = fill_format_str(type, buf, sizeof(buf), acct, dest, msg);
 			if (ret < 1)
 				return (-1);
-			screen_print_str(win, buf, (size_t) ret, MSG_TYPE_PRIVMSG_SEND);
+			screen_print_msg(win, acct->username, buf, (size_t) ret,
+				MSG_TYPE_PRIVMSG_SEND);
 			imwindow_send_msg(win);
 		}
 	}
@@ -368,7 +366,7 @@ int pork_recv_action(	struct pork_acct *acct,
 			dest, sender, userhost, msg);
 	if (ret < 1)
 		return (-1);
-	screen_print_str(win, buf, (size_t) ret, MSG_TYPE_PRIVMSG_RECV);
+	screen_print_msg(win, sender, buf, (size_t) ret, MSG_TYPE_PRIVMSG_RECV);
 	imwindow_recv_msg(win);
 
 	return (0);
@@ -394,7 +392,8 @@ int pork_action_send(struct pork_acct *acct, char *dest, char *msg) {
 		ret = fill_format_str(type, buf, sizeof(buf), acct, dest, msg);
 		if (ret < 1)
 			return (-1);
-		screen_print_str(win, buf, (size_t) ret, MSG_TYPE_PRIVMSG_SEND);
+		screen_print_msg(win, acct->username, buf, (size_t) ret,
+			MSG_TYPE_PRIVMSG_SEND);
 		imwindow_send_msg(win);
 	}
 
@@ -423,7 +422,8 @@ int pork_notice_send(struct pork_acct *acct, char *dest, char *msg) {
 	ret = fill_format_str(type, buf, sizeof(buf), acct, dest, msg);
 	if (ret < 1)
 		return (-1);
-	screen_print_str(win, buf, (size_t) ret, MSG_TYPE_NOTICE_SEND);
+	screen_print_msg(win, acct->username, buf, (size_t) ret,
+		MSG_TYPE_NOTICE_SEND);
 	imwindow_send_msg(win);
 
 	return (0);
@@ -452,7 +452,7 @@ int pork_recv_notice(	struct pork_acct *acct,
 			dest, sender, userhost, msg);
 	if (ret < 1)
 		return (-1);
-	screen_print_str(win, buf, (size_t) ret, MSG_TYPE_NOTICE_RECV);
+	screen_print_msg(win, sender, buf, (size_t) ret, MSG_TYPE_NOTICE_RECV);
 	imwindow_recv_msg(win);
 
 	return (0);
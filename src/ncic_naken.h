@@ -34,6 +34,8 @@ struct naken_input {
   char *message;
   char *orig;
   char *args;
+  /* the sender's name, for normal messages */
+  char *name;
 };
 
 int naken_send(irc_session_t *session, char *msg);
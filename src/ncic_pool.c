@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_pool.h"
+
+static pthread_t pool_threads[POOL_MAX_THREADS - 1];
+static uint32_t pool_size;
+static int pool_started;
+static int pool_quit;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+/* the batch being worked on; all protected by pool_lock */
+static void (*pool_func)(void *);
+static void **pool_args;
+static size_t pool_num;
+static size_t pool_next;
+static size_t pool_finished;
+
+/*
+** Run jobs from the current batch until there are none left.
+** Called with pool_lock held.
+*/
+
+static void pool_work_batch(void) {
+	while (pool_next < pool_num) {
+		void *arg = pool_args[pool_next++];
+
+		pthread_mutex_unlock(&pool_lock);
+		pool_func(arg);
+		pthread_mutex_lock(&pool_lock);
+
+		if (++pool_finished == pool_num)
+			pthread_cond_broadcast(&pool_done);
+	}
+}
+
+static void *pool_thread(void *arg __notused) {
+	pthread_mutex_lock(&pool_lock);
+
+	while (!pool_quit) {
+		if (pool_next < pool_num)
+			pool_work_batch();
+		else
+			pthread_cond_wait(&pool_work, &pool_lock);
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+	return (NULL);
+}
+
+/*
+** One worker per CPU, counting the main thread.
+*/
+
+static void pool_start(void) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t i;
+
+	pool_started = 1;
+
+	if (cpus > POOL_MAX_THREADS)
+		cpus = POOL_MAX_THREADS;
+
+	for (i = 0 ; (long) i < cpus - 1 ; i++) {
+		if (pthread_create(&pool_threads[i], NULL, pool_thread, NULL) != 0) {
+			debug("pthread_create failed");
+			break;
+		}
+	}
+
+	pool_size = i;
+}
+
+/*
+** Call "func" on each of the "num" arguments in "args", spread across
+** the pool, and wait for all of them to finish. The calling thread
+** does its share of the work, so this works even without any workers.
+*/
+
+void pool_run(void (*func)(void *), void **args, size_t num) {
+	if (num == 0)
+		return;
+
+	pthread_mutex_lock(&pool_lock);
+
+	if (!pool_started)
+		pool_start();
+
+	pool_func = func;
+	pool_args = args;
+	pool_num = num;
+	pool_next = 0;
+	pool_finished = 0;
+
+	if (num > 1)
+		pthread_cond_broadcast(&pool_work);
+
+	pool_work_batch();
+
+	while (pool_finished < pool_num)
+		pthread_cond_wait(&pool_done, &pool_lock);
+
+	pool_num = 0;
+	pool_next = 0;
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void pool_destroy(void) {
+	uint32_t i;
+
+	pthread_mutex_lock(&pool_lock);
+	pool_quit = 1;
+	pthread_cond_broadcast(&pool_work);
+	pthread_mutex_unlock(&pool_lock);
+
+	for (i = 0 ; i < pool_size ; i++)
+		pthread_join(pool_threads[i], NULL);
+
+	pool_size = 0;
+}
@@ -15,6 +15,8 @@
 #include "ncic_list.h"
 #include "ncic_queue.h"
 
+#define QUEUE_MIN_SIZE	16
+
 pork_queue_t *queue_new(u_int32_t max_entries) {
 	pork_queue_t *q = xcalloc(1, sizeof(*q));
 
@@ -22,54 +24,48 @@ pork_queue_t *queue_new(u_int32_t max_entries) {
 	return (q);
 }
 
-int queue_putback_head(pork_queue_t *q, void *data) {
-	dlist_t *new_node;
+/*
+** Make room for one more entry. The entries are moved to the start
+** of the new ring, in order.
+*/
 
-	if (q->max > 0 && q->entries >= q->max)
-		return (-1);
+static void queue_grow(pork_queue_t *q) {
+	u_int32_t size = q->size ? q->size * 2 : QUEUE_MIN_SIZE;
+	void **ring = xmalloc(size * sizeof(*ring));
+	u_int32_t first = min(q->entries, q->size - q->head);
 
-	new_node = xcalloc(1, sizeof(*new_node));
-	new_node->data = data;
+	if (q->entries > 0) {
+		memcpy(ring, q->ring + q->head, first * sizeof(*ring));
+		memcpy(ring + first, q->ring, (q->entries - first) * sizeof(*ring));
+	}
 
-	if (q->entries == 0) {
-		new_node->prev = NULL;
-		new_node->next = NULL;
+	free(q->ring);
+	q->ring = ring;
+	q->size = size;
+	q->head = 0;
+}
 
-		q->head = new_node;
-		q->tail = new_node;
-	} else {
-		new_node->prev = NULL;
-		new_node->next = q->head;
-		q->head->prev = new_node;
-		q->head = new_node;
-	}
+int queue_putback_head(pork_queue_t *q, void *data) {
+	if (q->max > 0 && q->entries >= q->max)
+		return (-1);
+
+	if (q->entries == q->size)
+		queue_grow(q);
 
+	q->head = (q->head - 1) & (q->size - 1);
+	q->ring[q->head] = data;
 	q->entries++;
 	return (0);
 }
 
 int queue_add(pork_queue_t *q, void *data) {
-	dlist_t *new_node;
-
 	if (q->max > 0 && q->entries >= q->max)
 		return (-1);
 
-	new_node = xcalloc(1, sizeof(*new_node));
-	new_node->data = data;
-	new_node->next = NULL;
-
-	if (q->entries == 0) {
-		new_node->prev = NULL;
-
-		q->head = new_node;
-		q->tail = new_node;
-	} else {
-		new_node->prev = q->tail;
-
-		q->tail->next = new_node;
-		q->tail = new_node;
-	}
+	if (q->entries == q->size)
+		queue_grow(q);
 
+	q->ring[(q->head + q->entries) & (q->size - 1)] = data;
 	q->entries++;
 	return (0);
 }
@@ -80,34 +76,25 @@ void *queue_get(pork_queue_t *q) {
 	if (q->entries == 0)
 		return (NULL);
 
+	ret = q->ring[q->head];
+	q->head = (q->head + 1) & (q->size - 1);
 	q->entries--;
-	ret = q->head->data;
-
-	if (q->head == q->tail) {
-		free(q->head);
-		q->head = NULL;
-		q->tail = NULL;
-	} else {
-		dlist_t *old_head = q->head;
-
-		old_head->next->prev = NULL;
-		q->head = old_head->next;
-		free(old_head);
-	}
 
 	return (ret);
 }
 
-void queue_destroy(pork_queue_t *q, void (*cleanup)(void *)) {
-	dlist_t *cur = q->head;
-
-	while (cur != NULL) {
-		dlist_t *next = cur->next;
+/*
+** Free the queue, running "cleanup" on each entry that's still in it.
+*/
 
-		if (cleanup != NULL)
-			cleanup(cur->data);
+void queue_destroy(pork_queue_t *q, void (*cleanup)(void *)) {
+	u_int32_t i;
 
-		free(cur);
-		cur = next;
+	if (cleanup != NULL) {
+		for (i = 0 ; i < q->entries ; i++)
+			cleanup(q->ring[(q->head + i) & (q->size - 1)]);
 	}
+
+	free(q->ring);
+	free(q);
 }
@@ -11,9 +11,16 @@
 #ifndef __NCIC_QUEUE_H__
 #define __NCIC_QUEUE_H__
 
+/*
+** A queue is a ring buffer of pointers that doubles in size when it
+** fills up, so once it's big enough adding and removing entries
+** doesn't allocate anything.
+*/
+
 typedef struct {
-	dlist_t *head;
-	dlist_t *tail;
+	void **ring;
+	u_int32_t size;
+	u_int32_t head;
 	u_int32_t entries;
 	u_int32_t max;
 } pork_queue_t;
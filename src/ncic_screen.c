@@ -14,6 +14,7 @@
 #include <ncurses.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/types.h>
 
 #include "ncic.h"
@@ -30,36 +31,25 @@
 #include "ncic_io.h"
 #include "ncic_status.h"
 
+static int screen_refnum_compare(void *l, void *r) {
+	u_int32_t refnum = POINTER_TO_UINT(l);
+	dlist_t *node = r;
+
+	return (refnum != ((struct imwindow *) node->data)->refnum);
+}
+
 /*
 ** Find the window having the specified refnum, and return
 ** a pointer to the node that holds it.
-**
-** This depends on the list being sorted.
 */
 
 static dlist_t *screen_find_refnum(u_int32_t refnum) {
-	dlist_t *cur = screen.window_list;
-
-	do {
-		struct imwindow *imwindow = cur->data;
-
-		if (imwindow->refnum == refnum)
-			return (cur);
-
-		if (imwindow->refnum > refnum)
-			break;
-
-		cur = cur->next;
-	} while (cur != screen.window_list);
-
-	return (NULL);
+	return (hash_find(&screen.refnum_hash, UINT_TO_POINTER(refnum)));
 }
 
 /*
-** Yes, this is pretty slow and stupid, but it'd be pretty
-** unusual (i think) to have even 10 windows open at any one time.
-**
-** It's also only called when creating a new window.
+** Only called when creating a new window, and refnums are
+** reused from the bottom, so this is quick.
 */
 
 static inline u_int32_t screen_get_new_refnum(void) {
@@ -76,6 +66,8 @@ static inline u_int32_t screen_get_new_refnum(void) {
 static void screen_window_list_add(dlist_t *new_node) {
 	struct imwindow *imwindow = new_node->data;
 
+	hash_add(&screen.refnum_hash, UINT_TO_POINTER(imwindow->refnum), new_node);
+
 	/*
 	** The window list is a sorted circular doubly linked list.
 	** The window_list pointer points to the window having the lowest
@@ -111,6 +103,9 @@ static void screen_window_list_add(dlist_t *new_node) {
 
 static void screen_window_list_remove(dlist_t *node) {
 	dlist_t *save = node;
+	struct imwindow *imwindow = node->data;
+
+	hash_remove(&screen.refnum_hash, UINT_TO_POINTER(imwindow->refnum));
 
 	if (node == screen.window_list)
 		screen.window_list = node->next;
@@ -136,6 +131,10 @@ int screen_init(u_int32_t rows, u_int32_t cols) {
 	screen.rows = rows;
 	screen.cols = cols;
 
+	hash_init(&screen.refnum_hash, 4, int_hash, screen_refnum_compare, NULL);
+	imwindow_index_init();
+	timer_init(&screen.timer_list);
+
 	bind_init(&screen.binds);
 	input_init(&screen.input, cols);
 
@@ -176,6 +175,8 @@ void screen_destroy(void) {
 		cur = next;
 	} while (cur != screen.window_list);
 
+	hash_destroy(&screen.refnum_hash);
+	imwindow_index_destroy();
 	opt_destroy();
 	input_destroy(&screen.input);
 	bind_destroy(&screen.binds);
@@ -189,6 +190,10 @@ void screen_add_window(struct imwindow *imwindow) {
 
 	new_node->data = imwindow;
 	screen_window_list_add(new_node);
+	imwindow_index(imwindow);
+
+	/* History restored from its log counts against SCROLLBUF_MEM. */
+	screen_trim_scrollbuf();
 
 	/*
 	** If this is the first window, make it current.
@@ -276,6 +281,9 @@ void screen_window_swap(dlist_t *new_cur) {
 	if (screen.cur_window != NULL) {
 		imwindow = cur_window();
 
+		/* The search bindings are no good in another window. */
+		imwindow_search_end(imwindow, 0);
+
 		last_own_input = wopt_get_bool(imwindow->opts, WOPT_PRIVATE_INPUT);
 		imwindow->swindow.activity = 0;
 		imwindow->swindow.visible = 0;
@@ -284,7 +292,7 @@ void screen_window_swap(dlist_t *new_cur) {
 	screen.cur_window = new_cur;
 
 	imwindow = cur_window();
-	imwindow->swindow.visible = 1;
+	swindow_show(&imwindow->swindow);
 	imwindow->swindow.activity = 0;
 	cur_own_input = wopt_get_bool(imwindow->opts, WOPT_PRIVATE_INPUT);
 
@@ -350,10 +358,11 @@ struct imwindow *screen_new_window(	struct pork_acct *acct,
 	if (imwindow == NULL)
 		return (NULL);
 
+	screen_add_window(imwindow);
+
 	if (name != NULL)
 		imwindow_rename(imwindow, name);
 
-	screen_add_window(imwindow);
 	status_draw(imwindow->owner);
 
 	return (imwindow);
@@ -378,6 +387,28 @@ struct imwindow *screen_new_chat_window(struct pork_acct *acct, char *name) {
 	return (imwindow);
 }
 
+/*
+** A window that isn't a conversation, for showing the output of
+** commands like /grep.
+*/
+
+struct imwindow *screen_new_status_window(struct pork_acct *acct, char *name) {
+	u_int32_t refnum = screen_get_new_refnum();
+	struct imwindow *imwindow;
+	u_int32_t rows;
+
+	rows = max(1, (int) screen.rows - STATUS_ROWS);
+	imwindow = imwindow_new(rows, screen.cols,
+		refnum, WIN_TYPE_STATUS, acct, name);
+	if (imwindow == NULL)
+		return (NULL);
+
+	screen_add_window(imwindow);
+	status_draw(imwindow->owner);
+
+	return (imwindow);
+}
+
 int screen_get_query_window(struct pork_acct *acct,
 							char *name,
 							struct imwindow **winr)
@@ -488,8 +519,72 @@ int screen_close_window(struct imwindow *imwindow) {
 		screen_cycle_fwd();
 
 	screen_window_list_remove(node);
+	imwindow_unindex(imwindow);
 	imwindow_destroy(imwindow);
 	free(node);
 
 	return (0);
 }
+
+/*
+** Hand scroll buffer text that hasn't been looked at in a while
+** to the compression thread.
+*/
+
+void screen_compress_scrollbuf(void) {
+	uint32_t after = opt_get_int(OPT_SCROLLBUF_COMPRESS);
+	dlist_t *cur = screen.window_list;
+	time_t cutoff;
+
+	if (after == 0)
+		return;
+
+	cutoff = time(NULL) - after;
+
+	do {
+		struct imwindow *imwindow = cur->data;
+
+		swindow_compress(&imwindow->swindow, cutoff);
+		cur = cur->next;
+	} while (cur != screen.window_list);
+}
+
+/*
+** Keep the memory used by all the scroll buffers under SCROLLBUF_MEM
+** kilobytes. History is evicted from the windows that were shown least
+** recently first, oldest messages first. Nothing that's on a window's
+** screen is evicted, so the budget can be overrun if there's nothing
+** else left.
+*/
+
+void screen_trim_scrollbuf(void) {
+	size_t budget = (size_t) opt_get_int(OPT_SCROLLBUF_MEM) * 1024;
+	uint32_t last = 0;
+
+	if (budget == 0 || screen.window_list == NULL)
+		return;
+
+	while (swindow_total_bytes() > budget) {
+		struct swindow *victim = NULL;
+		dlist_t *cur = screen.window_list;
+
+		/* Find the window that was viewed longest ago after "last". */
+		do {
+			struct swindow *swindow = &((struct imwindow *) cur->data)->swindow;
+
+			if (swindow->viewed > last &&
+				(victim == NULL || swindow->viewed < victim->viewed))
+			{
+				victim = swindow;
+			}
+
+			cur = cur->next;
+		} while (cur != screen.window_list);
+
+		if (victim == NULL)
+			break;
+
+		swindow_evict(victim, swindow_total_bytes() - budget);
+		last = victim->viewed;
+	}
+}
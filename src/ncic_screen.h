@@ -11,6 +11,8 @@
 #ifndef __NCIC_SCREEN_H__
 #define __NCIC_SCREEN_H__
 
+#include <sys/time.h>
+
 extern struct screen screen;
 
 enum {
@@ -24,13 +26,32 @@ struct pork_acct;
 
 #include "ncic_input.h"
 #include "ncic_bind.h"
+#include "ncic_timer.h"
+
+/*
+** Damage from any number of wakeups is collected here and flushed
+** to the terminal at most OPT_MAX_FPS times per second.
+*/
+
+struct render {
+	struct timeval last_frame;
+	u_int32_t frames;
+	u_int32_t skipped;
+	u_int32_t damaged:1;
+	u_int32_t urgent:1;
+};
 
 struct screen {
 	u_int32_t rows;
 	u_int32_t cols;
 	dlist_t *cur_window;
 	dlist_t *window_list;
-	dlist_t *timer_list;
+	/* window_list nodes by refnum */
+	hash_t refnum_hash;
+	/* windows by owner and name, and by owner and target */
+	hash_t name_hash;
+	hash_t target_hash;
+	struct timer_list timer_list;
 	struct imwindow *status_win;
   struct pork_acct *acct;
 	WINDOW *status_bar;
@@ -39,6 +60,7 @@ struct screen {
 	struct input input;
 	struct binds binds;
 	hash_t alias_hash;
+	struct render render;
 };
 
 #define cur_window() ((struct imwindow *) (screen.cur_window->data))
@@ -55,9 +77,14 @@ void screen_refresh(void);
 void screen_bind_all_unbound(struct pork_acct *acct);
 struct imwindow *screen_new_window(struct pork_acct *o, char *dest, char *name);
 struct imwindow *screen_new_chat_window(struct pork_acct *acct, char *name);
+struct imwindow *screen_new_status_window(struct pork_acct *acct, char *name);
 int screen_close_window(struct imwindow *imwindow);
 void screen_cycle_fwd(void);
 void screen_cycle_bak(void);
 void screen_doupdate(void);
+void screen_render(int dirty);
+void screen_render_wait(struct timeval *tv);
+void screen_compress_scrollbuf(void);
+void screen_trim_scrollbuf(void);
 
 #endif /* __NCIC_SCREEN_H__ */
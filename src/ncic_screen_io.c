@@ -19,6 +19,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <sys/time.h>
 
 #include "ncic.h"
 #include "ncic_util.h"
@@ -34,6 +35,7 @@
 #include "ncic_status.h"
 #include "ncic_screen.h"
 #include "ncic_screen_io.h"
+#include "ncic_blog.h"
 
 inline void screen_doupdate(void) {
 	int cur_old = curs_set(0);
@@ -44,6 +46,85 @@ inline void screen_doupdate(void) {
 
 	doupdate();
 	curs_set(cur_old);
+
+	gettimeofday(&screen.render.last_frame, NULL);
+	screen.render.frames++;
+	screen.render.damaged = 0;
+	screen.render.urgent = 0;
+}
+
+/*
+** Returns the number of microseconds until the next frame
+** may be drawn, or 0 if one may be drawn now.
+*/
+
+static long screen_frame_delay(void) {
+	struct render *render = &screen.render;
+	struct timeval now;
+	uint32_t max_fps = opt_get_int(OPT_MAX_FPS);
+	long elapsed;
+	long interval;
+
+	if (max_fps == 0 || render->urgent)
+		return (0);
+
+	interval = 1000000 / max_fps;
+
+	gettimeofday(&now, NULL);
+	elapsed = (now.tv_sec - render->last_frame.tv_sec) * 1000000 +
+				(now.tv_usec - render->last_frame.tv_usec);
+
+	/* The clock went backwards. */
+	if (elapsed < 0)
+		return (0);
+
+	if (elapsed >= interval)
+		return (0);
+
+	return (interval - elapsed);
+}
+
+/*
+** Called once per pass through the main loop. Damage is
+** accumulated until the frame interval has passed, so a flood
+** of output costs one terminal update per frame rather than one
+** per read. Anything the user typed is flushed right away.
+*/
+
+void screen_render(int dirty) {
+	struct render *render = &screen.render;
+
+	if (dirty)
+		render->damaged = 1;
+
+	if (!render->damaged)
+		return;
+
+	if (screen_frame_delay() > 0) {
+		if (dirty)
+			render->skipped++;
+		return;
+	}
+
+	screen_doupdate();
+}
+
+/*
+** Shorten the I/O timeout so that pending damage gets
+** drawn as soon as the next frame is due.
+*/
+
+void screen_render_wait(struct timeval *tv) {
+	long delay;
+
+	if (!screen.render.damaged)
+		return;
+
+	delay = screen_frame_delay();
+	if (delay < tv->tv_sec * 1000000 + tv->tv_usec) {
+		tv->tv_sec = delay / 1000000;
+		tv->tv_usec = delay % 1000000;
+	}
 }
 
 int screen_draw_input(void) {
@@ -233,6 +314,22 @@ void screen_print_str(struct imwindow *win, char *buf, size_t chlen, int type) {
 	}
 }
 
+/*
+** Like screen_print_str(), for a message from "sender", which is
+** recorded in binary logs.
+*/
+
+void screen_print_msg(	struct imwindow *win,
+						const char *sender,
+						char *buf,
+						size_t len,
+						int type)
+{
+	blog_set_sender(sender);
+	screen_print_str(win, buf, len, type);
+	blog_set_sender(NULL);
+}
+
 inline void screen_win_msg(	struct imwindow *win,
 							int ts,
 							int banner,
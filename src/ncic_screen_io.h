@@ -17,6 +17,8 @@ struct imwindow;
 struct pork_acct;
 
 void screen_print_str(struct imwindow *, char *buf, size_t len, int type);
+void screen_print_msg(struct imwindow *win, const char *sender, char *buf,
+	size_t len, int type);
 void screen_win_msg(struct imwindow *win,
 					int ts,
 					int banner,
@@ -26,6 +26,7 @@
 #include "ncic_misc.h"
 #include "ncic_screen.h"
 #include "ncic_screen_io.h"
+#include "ncic_log.h"
 
 
 extern struct screen screen;
@@ -45,6 +46,7 @@ static void wopt_changed_log(struct imwindow *imwindow);
 static void wopt_changed_logfile(struct imwindow *imwindow);
 static void wopt_changed_priv_input(struct imwindow *imwindow);
 static void wopt_changed_scrollbuf_len(struct imwindow *imwindow);
+static void wopt_changed_scrollbuf_spill(struct imwindow *imwindow);
 static void wopt_changed_scroll_on_output(struct imwindow *imwindow);
 static void wopt_changed_scroll_on_input(struct imwindow *imwindow);
 static void wopt_changed_timestamp(struct imwindow *imwindow);
@@ -446,6 +448,60 @@ struct global_pref global_pref[] = {
 		opt_set_bool,
 		NULL,
 		SET_BOOL(DEFAULT_LOG),
+	},{	"LOG_BATCH",
+		OPT_INT,
+		0,
+		opt_set_int,
+		log_set_opts,
+		SET_INT(DEFAULT_LOG_BATCH),
+	},{	"LOG_BATCH_MSEC",
+		OPT_INT,
+		0,
+		opt_set_int,
+		log_set_opts,
+		SET_INT(DEFAULT_LOG_BATCH_MSEC),
+	},{	"LOG_COMPRESS",
+		OPT_BOOL,
+		0,
+		opt_set_bool,
+		log_set_opts,
+		SET_BOOL(DEFAULT_LOG_COMPRESS),
+	},{	"LOG_FORMAT",
+		OPT_STR,
+		0,
+		opt_set_str,
+		NULL,
+		SET_STR(DEFAULT_LOG_FORMAT),
+	},{	"LOG_FSYNC",
+		OPT_STR,
+		0,
+		opt_set_str,
+		log_set_opts,
+		SET_STR(DEFAULT_LOG_FSYNC),
+	},{	"LOG_OVERFLOW",
+		OPT_STR,
+		0,
+		opt_set_str,
+		log_set_opts,
+		SET_STR(DEFAULT_LOG_OVERFLOW),
+	},{	"LOG_QUEUE",
+		OPT_INT,
+		0,
+		opt_set_int,
+		log_set_opts,
+		SET_INT(DEFAULT_LOG_QUEUE),
+	},{	"LOG_ROTATE_DAILY",
+		OPT_BOOL,
+		0,
+		opt_set_bool,
+		NULL,
+		SET_BOOL(DEFAULT_LOG_ROTATE_DAILY),
+	},{	"LOG_ROTATE_SIZE",
+		OPT_INT,
+		0,
+		opt_set_int,
+		NULL,
+		SET_INT(DEFAULT_LOG_ROTATE_SIZE),
 	},{	"LOG_TYPES",
 		OPT_INT,
 		0,
@@ -458,6 +514,12 @@ struct global_pref global_pref[] = {
 		opt_set_bool,
 		NULL,
 		SET_BOOL(DEFAULT_LOGIN_ON_STARTUP),
+	},{	"MAX_FPS",
+		OPT_INT,
+		0,
+		opt_set_int,
+		NULL,
+		SET_INT(DEFAULT_MAX_FPS),
 	},{ "OUTGOING_MSG_FONT",
 		OPT_STR,
 		0,
@@ -548,12 +610,36 @@ struct global_pref global_pref[] = {
 		opt_set_bool,
 		NULL,
 		SET_BOOL(DEFAULT_SCROLL_ON_OUTPUT),
+	},{	"SCROLLBUF_COMPRESS",
+		OPT_INT,
+		0,
+		opt_set_int,
+		NULL,
+		SET_INT(DEFAULT_SCROLLBUF_COMPRESS),
 	},{	"SCROLLBUF_LEN",
 		OPT_INT,
 		0,
 		opt_set_int,
 		scrollbuf_len_update,
 		SET_INT(DEFAULT_SCROLLBUF_LEN),
+	},{	"SCROLLBUF_MEM",
+		OPT_INT,
+		0,
+		opt_set_int,
+		screen_trim_scrollbuf,
+		SET_INT(DEFAULT_SCROLLBUF_MEM),
+	},{	"SCROLLBUF_RESTORE",
+		OPT_INT,
+		0,
+		opt_set_int,
+		NULL,
+		SET_INT(DEFAULT_SCROLLBUF_RESTORE),
+	},{	"SCROLLBUF_SPILL",
+		OPT_BOOL,
+		0,
+		opt_set_bool,
+		NULL,
+		SET_BOOL(DEFAULT_SCROLLBUF_SPILL),
 	},{	"SEND_REMOVES_AWAY",
 		OPT_BOOL,
 		0,
@@ -689,6 +775,10 @@ static struct window_var window_var[] = {
 		OPT_INT,
 		wopt_set_int,
 		wopt_changed_scrollbuf_len
+	},{	"SCROLLBUF_SPILL",
+		OPT_BOOL,
+		wopt_set_bool,
+		wopt_changed_scrollbuf_spill
 	},{	"TIMESTAMP",
 		OPT_BOOL,
 		wopt_set_bool,
@@ -1005,6 +1095,8 @@ static void wopt_changed_log(struct imwindow *imwindow) {
 		else {
 			if (swindow_set_log(&imwindow->swindow) == -1)
 				imwindow->opts[WOPT_LOG].b = 0;
+			else
+				screen_trim_scrollbuf();
 		}
 	}
 }
@@ -1034,6 +1126,14 @@ static void wopt_changed_scrollbuf_len(struct imwindow *imwindow) {
 	swindow_prune(&imwindow->swindow);
 }
 
+static void wopt_changed_scrollbuf_spill(struct imwindow *imwindow) {
+	swindow_set_spill(&imwindow->swindow,
+		wopt_get_bool(imwindow->opts, WOPT_SCROLLBUF_SPILL));
+
+	if (imwindow->swindow.spill == NULL)
+		imwindow->opts[WOPT_SCROLLBUF_SPILL].b = 0;
+}
+
 static void wopt_changed_scroll_on_output(struct imwindow *imwindow) {
 	uint32_t new_val;
 
@@ -1076,6 +1176,7 @@ void wopt_init(struct imwindow *imwindow, const char *target) {
 	wopt[WOPT_SCROLL_ON_INPUT].b = opt_get_bool(OPT_SCROLL_ON_INPUT);
 	wopt[WOPT_SCROLL_ON_OUTPUT].b = opt_get_bool(OPT_SCROLL_ON_OUTPUT);
 	wopt[WOPT_SCROLLBUF_LEN].i = opt_get_int(OPT_SCROLLBUF_LEN);
+	wopt[WOPT_SCROLLBUF_SPILL].b = opt_get_bool(OPT_SCROLLBUF_SPILL);
 	wopt[WOPT_TIMESTAMP].b = opt_get_bool(OPT_TIMESTAMP);
 	wopt[WOPT_WORDWRAP].b = opt_get_bool(OPT_WORDWRAP);
 	wopt[WOPT_WORDWRAP_CHAR].c = opt_get_char(OPT_WORDWRAP_CHAR);
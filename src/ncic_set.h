@@ -91,8 +91,18 @@ enum {
 	OPT_HISTORY_LEN,
 	OPT_IDLE_AFTER,
 	OPT_LOG,
+	OPT_LOG_BATCH,
+	OPT_LOG_BATCH_MSEC,
+	OPT_LOG_COMPRESS,
+	OPT_LOG_FORMAT,
+	OPT_LOG_FSYNC,
+	OPT_LOG_OVERFLOW,
+	OPT_LOG_QUEUE,
+	OPT_LOG_ROTATE_DAILY,
+	OPT_LOG_ROTATE_SIZE,
 	OPT_LOG_TYPES,
 	OPT_LOGIN_ON_STARTUP,
+	OPT_MAX_FPS,
 	OPT_OUTGOING_MSG_FONT,
 	OPT_OUTGOING_MSG_FONT_BGCOLOR,
 	OPT_OUTGOING_MSG_FONT_FGCOLOR,
@@ -108,11 +118,15 @@ enum {
 	OPT_SAVE_PASSWD,
 	OPT_SCROLL_ON_INPUT,
 	OPT_SCROLL_ON_OUTPUT,
+	OPT_SCROLLBUF_COMPRESS,
 	OPT_SCROLLBUF_LEN,
+	OPT_SCROLLBUF_MEM,
+	OPT_SCROLLBUF_RESTORE,
+	OPT_SCROLLBUF_SPILL,
+	OPT_SEND_REMOVES_AWAY,
 	OPT_SHOW_BUDDY_AWAY,
 	OPT_SHOW_BUDDY_IDLE,
 	OPT_SHOW_BUDDY_SIGNOFF,
-	OPT_SEND_REMOVES_AWAY,
 	OPT_TEXT_NO_NAME,
 	OPT_TEXT_NO_ROOM,
 	OPT_TEXT_TYPING,
@@ -143,6 +157,7 @@ enum {
 	WOPT_SCROLL_ON_INPUT,
 	WOPT_SCROLL_ON_OUTPUT,
 	WOPT_SCROLLBUF_LEN,
+	WOPT_SCROLLBUF_SPILL,
 	WOPT_SHOW_BLIST,
 	WOPT_TIMESTAMP,
 	WOPT_WORDWRAP,
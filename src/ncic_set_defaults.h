@@ -85,8 +85,18 @@
 #define DEFAULT_HISTORY_LEN					400
 #define DEFAULT_IDLE_AFTER					10
 #define DEFAULT_LOG							0
+#define DEFAULT_LOG_BATCH					64
+#define DEFAULT_LOG_BATCH_MSEC				250
+#define DEFAULT_LOG_COMPRESS				0
+#define DEFAULT_LOG_FORMAT					"text"
+#define DEFAULT_LOG_FSYNC					"close"
+#define DEFAULT_LOG_OVERFLOW				"drop"
+#define DEFAULT_LOG_QUEUE					4096
+#define DEFAULT_LOG_ROTATE_DAILY			0
+#define DEFAULT_LOG_ROTATE_SIZE				0
 #define DEFAULT_LOG_TYPES					0xffffffff
 #define DEFAULT_LOGIN_ON_STARTUP			1
+#define DEFAULT_MAX_FPS						30
 #define DEFAULT_OUTGOING_MSG_FONT			""
 #define DEFAULT_OUTGOING_MSG_FONT_BGCOLOR	"#ffffff"
 #define DEFAULT_OUTGOING_MSG_FONT_FGCOLOR	"#000000"
@@ -102,7 +112,11 @@
 #define DEFAULT_SAVE_PASSWD					0
 #define DEFAULT_SCROLL_ON_INPUT				1
 #define DEFAULT_SCROLL_ON_OUTPUT			0
+#define DEFAULT_SCROLLBUF_COMPRESS			300
 #define DEFAULT_SCROLLBUF_LEN				5000
+#define DEFAULT_SCROLLBUF_MEM				32768
+#define DEFAULT_SCROLLBUF_RESTORE			0
+#define DEFAULT_SCROLLBUF_SPILL				0
 #define DEFAULT_SEND_REMOVES_AWAY			1
 #define DEFAULT_SHOW_BLIST					0
 #define DEFAULT_SHOW_BUDDY_AWAY				1
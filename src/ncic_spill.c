@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <ncurses.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "ncic_imsg.h"
+#include "ncic_conf.h"
+#include "ncic_screen_io.h"
+#include "ncic_spill.h"
+
+#define spill_rec_size(len) \
+	(sizeof(struct spill_rec) + ((len) + 1) * sizeof(chtype) + sizeof(uint32_t))
+
+/*
+** Create a new spill segment in "dir". The file is unlinked
+** as soon as it's opened, so nothing is left behind if we crash.
+*/
+
+struct spill *spill_open(const char *dir) {
+	struct spill *spill;
+	char path[PATH_MAX];
+	int fd;
+
+	if (pork_mkdir(dir) != 0)
+		return (NULL);
+
+	snprintf(path, sizeof(path), "%s/scrollbuf.XXXXXX", dir);
+
+	fd = mkstemp(path);
+	if (fd == -1) {
+		screen_err_msg("Unable to create %s: %s", path, strerror(errno));
+		return (NULL);
+	}
+
+	unlink(path);
+
+	spill = xcalloc(1, sizeof(*spill));
+	spill->fd = fd;
+
+	return (spill);
+}
+
+static void spill_unmap(struct spill *spill) {
+	if (spill->map != NULL) {
+		munmap(spill->map, spill->map_len);
+		spill->map = NULL;
+		spill->map_len = 0;
+	}
+}
+
+/*
+** Make sure at least the first "len" bytes of the segment are mapped.
+*/
+
+static int spill_map(struct spill *spill, size_t len) {
+	void *map;
+
+	if (len <= spill->map_len)
+		return (0);
+
+	spill_unmap(spill);
+
+	map = mmap(NULL, spill->size, PROT_READ, MAP_SHARED, spill->fd, 0);
+	if (map == MAP_FAILED) {
+		debug("mmap: %s", strerror(errno));
+		return (-1);
+	}
+
+	spill->map = map;
+	spill->map_len = spill->size;
+	return (0);
+}
+
+void spill_close(struct spill *spill) {
+	spill_unmap(spill);
+	close(spill->fd);
+	free(spill);
+}
+
+/*
+** Throw away everything in the segment.
+*/
+
+void spill_reset(struct spill *spill) {
+	spill_unmap(spill);
+
+	if (ftruncate(spill->fd, 0) != 0)
+		debug("ftruncate: %s", strerror(errno));
+
+	spill->size = 0;
+	spill->cursor = 0;
+	spill->records = 0;
+}
+
+/*
+** Called when "imsg", the oldest message held in memory, is about
+** to be freed. If it was paged in from the segment, it's already
+** there and the cursor just moves past it. Otherwise it's appended.
+*/
+
+int spill_push(struct spill *spill, struct imsg *imsg) {
+	size_t rec_size = spill_rec_size(imsg->len);
+	struct spill_rec rec;
+	uint32_t trailer;
+	struct iovec wvec[3];
+	ssize_t ret;
+
+	if (spill->cursor < spill->size) {
+		spill->cursor += rec_size;
+		spill->records++;
+		return (0);
+	}
+
+	rec.serial = imsg->serial;
+	rec.len = imsg->len;
+	trailer = rec_size;
+
+	wvec[0].iov_base = &rec;
+	wvec[0].iov_len = sizeof(rec);
+	wvec[1].iov_base = imsg_text(imsg);
+	wvec[1].iov_len = (imsg->len + 1) * sizeof(chtype);
+	wvec[2].iov_base = &trailer;
+	wvec[2].iov_len = sizeof(trailer);
+
+	ret = writev(spill->fd, wvec, 3);
+	if (ret != (ssize_t) rec_size) {
+		/* Don't leave a partial record at the end of the segment. */
+		if (ret > 0 && ftruncate(spill->fd, spill->size) != 0)
+			debug("ftruncate: %s", strerror(errno));
+
+		return (-1);
+	}
+
+	spill->size += rec_size;
+	spill->cursor = spill->size;
+	spill->records++;
+	return (0);
+}
+
+/*
+** Make a new message out of a record in the segment. The caller
+** is responsible for setting the number of lines it needs.
+*/
+
+struct imsg *spill_rec_imsg(struct spill_rec *rec) {
+	struct imsg *imsg;
+	size_t len = (rec->len + 1) * sizeof(chtype);
+
+	imsg = xmalloc(sizeof(*imsg));
+	imsg->serial = rec->serial;
+	imsg->len = rec->len;
+	imsg->lines = 1;
+	imsg->zblock = NULL;
+	imsg->touched = time(NULL);
+	imsg->plain = NULL;
+	imsg->text = xmalloc(len);
+	memcpy(imsg->text, spill_rec_text(rec), len);
+
+	return (imsg);
+}
+
+/*
+** Page in the newest record that isn't currently held in memory.
+*/
+
+struct imsg *spill_pop(struct spill *spill) {
+	uint32_t trailer;
+
+	if (spill->cursor == 0 || spill_map(spill, spill->cursor) != 0)
+		return (NULL);
+
+	memcpy(&trailer, spill->map + spill->cursor - sizeof(trailer),
+		sizeof(trailer));
+
+	spill->cursor -= trailer;
+	spill->records--;
+
+	return (spill_rec_imsg((struct spill_rec *) (spill->map + spill->cursor)));
+}
+
+/*
+** Walk the records that aren't held in memory, oldest first.
+*/
+
+struct spill_rec *spill_first(struct spill *spill) {
+	if (spill->cursor == 0 || spill_map(spill, spill->cursor) != 0)
+		return (NULL);
+
+	return ((struct spill_rec *) spill->map);
+}
+
+struct spill_rec *spill_next(struct spill *spill, struct spill_rec *rec) {
+	char *next = (char *) rec + spill_rec_size(rec->len);
+
+	if (next >= spill->map + spill->cursor)
+		return (NULL);
+
+	return ((struct spill_rec *) next);
+}
+
+/*
+** Let the kernel drop the pages touched by a scan of the whole
+** segment, so that searching deep history doesn't grow our RSS.
+*/
+
+void spill_done(struct spill *spill) {
+	if (spill->map != NULL)
+		madvise(spill->map, spill->map_len, MADV_DONTNEED);
+}
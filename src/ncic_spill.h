@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_SPILL_H__
+#define __NCIC_SPILL_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+
+struct imsg;
+
+/*
+** Scroll buffer messages that are pruned from memory are appended
+** to a spill segment, which is mapped read-only so that they can be
+** paged back in when the window is scrolled up or searched.
+**
+** Each record is a header, the message text (including the trailing
+** NUL) and the size of the whole record, so that the segment can be
+** walked backwards from the cursor.
+*/
+
+struct spill_rec {
+	uint32_t serial;
+	uint32_t len;
+};
+
+struct spill {
+	int fd;
+	char *map;
+	size_t map_len;
+	/* bytes written to the segment */
+	off_t size;
+	/* records at or after this offset are currently held in memory */
+	off_t cursor;
+	/* number of records before the cursor */
+	uint32_t records;
+};
+
+#define spill_rec_text(rec) ((chtype *) ((struct spill_rec *) (rec) + 1))
+
+struct spill *spill_open(const char *dir);
+void spill_close(struct spill *spill);
+void spill_reset(struct spill *spill);
+int spill_push(struct spill *spill, struct imsg *imsg);
+struct imsg *spill_pop(struct spill *spill);
+struct imsg *spill_rec_imsg(struct spill_rec *rec);
+struct spill_rec *spill_first(struct spill *spill);
+struct spill_rec *spill_next(struct spill *spill, struct spill_rec *rec);
+void spill_done(struct spill *spill);
+
+#endif /* __NCIC_SPILL_H__ */
@@ -20,8 +20,10 @@
 #include <time.h>
 #include <fcntl.h>
 #include <errno.h>
-#include <regex.h>
+#include <limits.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ncic.h"
 #include "ncic_util.h"
@@ -31,9 +33,101 @@
 #include "ncic_cstr.h"
 #include "ncic_misc.h"
 #include "ncic_imsg.h"
+#include "ncic_spill.h"
+#include "ncic_zblock.h"
+#include "ncic_trgm.h"
+#include "ncic_match.h"
+#include "ncic_pool.h"
+#include "ncic_log.h"
+#include "ncic_blog.h"
 #include "ncic_screen_io.h"
 
+/*
+** How many messages to page in from the spill segment at a time.
+*/
+
+#define SWINDOW_PAGE_IN		128
+
+/*
+** Cold messages are compressed in runs of at most ZBLOCK_MAX_MSGS.
+** Runs shorter than ZBLOCK_MIN_MSGS aren't worth the trouble.
+*/
+
+#define ZBLOCK_MAX_MSGS		64
+#define ZBLOCK_MIN_MSGS		16
+
+/*
+** How many messages each search job checks.
+*/
+
+#define SWINDOW_SCAN_MSGS	4096
+
+/*
+** How many messages an incremental search checks before going back
+** to the event loop to see if another key has been pressed.
+*/
+
+#define SWINDOW_SEARCH_SLICE	4096
+
+/*
+** Window dumps are put together in a buffer of this size and written
+** out a buffer at a time.
+*/
+
+#define SWINDOW_DUMP_BUF	(1024 * 1024)
+
+struct swindow_dump {
+	int fd;
+	int err;
+	char *buf;
+	size_t len;
+};
+
+/*
+** An incremental search. The pass that looks for the next match is
+** run a slice at a time from the event loop, and is started over
+** whenever the pattern changes.
+*/
+
+struct swindow_search {
+	struct match match;
+	char *pattern;
+	uint32_t options;
+	uint32_t compiled:1;
+	uint32_t failed:1;
+	/* the window was scrolled all the way down when the search started */
+	uint32_t at_end:1;
+	int dir;
+
+	/* where the screen was when the search started */
+	struct imsg *saved_top;
+	uint32_t saved_top_hidden;
+	struct imsg *origin;
+
+	/* the current match, and the next message the pass will look at */
+	struct imsg *cur;
+	struct imsg *scan;
+};
+
+/*
+** The memory used by the scroll buffers of all windows, and a clock
+** that's advanced every time a window is shown.
+*/
+
+static size_t swindow_bytes;
+static uint32_t swindow_view_clock;
+
+/*
+** Message serial numbers come from a single counter, so that
+** messages from different windows can be put in order.
+*/
+
+static uint32_t swindow_serial;
+
 static void swindow_scroll(struct swindow *swindow, int n);
+static void swindow_charge(struct swindow *swindow, struct imsg *imsg);
+static void swindow_uncharge(struct swindow *swindow, struct imsg *imsg);
+static void swindow_rotate_log(struct swindow *swindow, time_t now);
 
 static int swindow_print_msg_wr(struct swindow *swindow,
 								struct imsg *imsg,
@@ -96,6 +190,32 @@ out:
 	return (lines_printed);
 }
 
+/*
+** Toggle reverse video on the parts of the message that match the
+** search pattern. Doing it a second time puts the text back the way
+** it was.
+*/
+
+static void swindow_search_mark(struct swindow_search *search,
+								struct imsg *imsg)
+{
+	size_t len = strlen(imsg->plain);
+	size_t from = 0;
+	size_t start;
+	size_t end;
+
+	while (from <= len &&
+		match_next(&search->match, imsg->plain, from, &start, &end))
+	{
+		size_t i;
+
+		for (i = start ; i < end ; i++)
+			imsg->text[i] ^= A_REVERSE;
+
+		from = (end > start) ? end : start + 1;
+	}
+}
+
 static int swindow_print_msg(	struct swindow *swindow,
 								struct imsg *imsg,
 								uint32_t y,
@@ -103,21 +223,51 @@ static int swindow_print_msg(	struct swindow *swindow,
 								uint32_t firstline,
 								uint32_t lastline)
 {
+	struct swindow_search *search = swindow->search;
 	chtype *msg;
+	int ret = 0;
 
-	if (swindow->wordwrap)
-		return (swindow_print_msg_wr(swindow, imsg, y, x, firstline, lastline));
+	/*
+	** Nobody can see a hidden window, so don't bother drawing it.
+	** It'll be painted in one pass when it's shown.
+	*/
 
-	if (lastline < firstline)
-		return (-1);
+	if (!swindow->visible) {
+		swindow->stale = 1;
+		return (0);
+	}
+
+	if (imsg->zblock != NULL) {
+		swindow_uncharge(swindow, imsg);
+		zblock_thaw(imsg);
+		swindow_charge(swindow, imsg);
+		swindow->zscan = NULL;
+	}
 
-	msg = imsg_partial(swindow, imsg, firstline);
+	imsg->touched = time(NULL);
 
-	mvwputnstr(swindow->win, y, x, msg,
-		min(swindow->rows * swindow->cols,
-			(lastline - firstline + 1) * swindow->cols));
+	if (search != NULL && !search->compiled)
+		search = NULL;
 
-	return (0);
+	if (search != NULL)
+		swindow_search_mark(search, imsg);
+
+	if (swindow->wordwrap)
+		ret = swindow_print_msg_wr(swindow, imsg, y, x, firstline, lastline);
+	else if (lastline < firstline)
+		ret = -1;
+	else {
+		msg = imsg_partial(swindow, imsg, firstline);
+
+		mvwputnstr(swindow->win, y, x, msg,
+			min(swindow->rows * swindow->cols,
+				(lastline - firstline + 1) * swindow->cols));
+	}
+
+	if (search != NULL)
+		swindow_search_mark(search, imsg);
+
+	return (ret);
 }
 
 /*
@@ -139,6 +289,8 @@ int swindow_init(	struct swindow *swindow,
 	swindow->bottom_blank = rows;
 	swindow->visible = 0;
 	swindow->dirty = 1;
+	swindow->viewed = ++swindow_view_clock;
+	swindow->trgm = trgm_new();
 
 	swindow->scrollbuf_max = wopt_get_int(wopt, WOPT_SCROLLBUF_LEN);
 	swindow->scroll_on_input = wopt_get_bool(wopt, WOPT_SCROLL_ON_INPUT);
@@ -157,6 +309,9 @@ int swindow_init(	struct swindow *swindow,
 	if (swindow->logged)
 		swindow_set_log(swindow);
 
+	if (wopt_get_bool(wopt, WOPT_SCROLLBUF_SPILL))
+		swindow_set_spill(swindow, 1);
+
 	return (0);
 }
 
@@ -167,6 +322,33 @@ int swindow_init(	struct swindow *swindow,
 ** disable it.
 */
 
+/*
+** Keep track of the memory used by a message that's being added to
+** or removed from the scroll buffer.
+*/
+
+static void swindow_charge(struct swindow *swindow, struct imsg *imsg) {
+	size_t size = imsg_size(imsg);
+
+	swindow->scrollbuf_bytes += size;
+	swindow_bytes += size;
+}
+
+static void swindow_uncharge(struct swindow *swindow, struct imsg *imsg) {
+	size_t size = imsg_size(imsg);
+
+	swindow->scrollbuf_bytes -= size;
+	swindow_bytes -= size;
+}
+
+size_t swindow_total_bytes(void) {
+	return (swindow_bytes);
+}
+
+uint32_t swindow_next_serial(void) {
+	return (swindow_serial++);
+}
+
 static inline void swindow_scroll(struct swindow *swindow, int n) {
 	scrollok(swindow->win, TRUE);
 	wscrl(swindow->win, n);
@@ -175,22 +357,58 @@ static inline void swindow_scroll(struct swindow *swindow, int n) {
 }
 
 /*
-** Prune the scroll buffer so that the number of total
-** messages is not greater than swindow->scrollbuf_max.
+** Called before "imsg" is freed, so that nothing is left
+** pointing at it.
 */
 
-void swindow_prune(struct swindow *swindow) {
-	int num = swindow->scrollbuf_len - swindow->scrollbuf_max;
-	dlist_t *cur = swindow->scrollbuf_end;
+static void swindow_forget(struct swindow *swindow, struct imsg *imsg) {
+	struct zjob *zjob = swindow->zjob;
+
+	if (swindow->zscan == imsg)
+		swindow->zscan = NULL;
+
+	if (swindow->search != NULL) {
+		struct swindow_search *search = swindow->search;
+
+		if (search->cur == imsg)
+			search->cur = NULL;
+		if (search->scan == imsg)
+			search->scan = NULL;
+		if (search->origin == imsg)
+			search->origin = NULL;
+		if (search->saved_top == imsg)
+			search->saved_top = NULL;
+	}
+
+	if (zjob != NULL &&
+		imsg->serial >= zjob->first_serial &&
+		imsg->serial <= zjob->last_serial)
+	{
+		zjob->data = NULL;
+		swindow->zjob = NULL;
+	}
+}
+
+/*
+** Drop the oldest messages from the scroll buffer, stopping when "num"
+** messages or "bytes" bytes of memory have been freed, whichever comes
+** first. Returns the number of bytes freed.
+*/
+
+static size_t swindow_drop(struct swindow *swindow, int num, size_t bytes) {
+	struct imsg *imsg = ilist_last(&swindow->scrollbuf);
 	uint32_t serial_top;
 	uint32_t serial_bot;
+	size_t freed = 0;
 
-	serial_top = ((struct imsg *) swindow->scrollbuf_top->data)->serial;
-	serial_bot = ((struct imsg *) swindow->scrollbuf_bot->data)->serial;
+	if (imsg == NULL)
+		return (0);
+
+	serial_top = swindow->scrollbuf_top->serial;
+	serial_bot = swindow->scrollbuf_bot->serial;
 
-	while (cur != NULL && num > 0) {
-		struct imsg *imsg = cur->data;
-		dlist_t *next = cur->prev;
+	while (imsg != NULL && num > 0 && freed < bytes) {
+		struct imsg *next = ilist_prev(imsg, link);
 
 		/* Don't prune anything that's still on the screen */
 		if (imsg->serial >= serial_top && imsg->serial <= serial_bot)
@@ -200,13 +418,219 @@ void swindow_prune(struct swindow *swindow) {
 		swindow->scrollbuf_len--;
 		num--;
 
+		freed += imsg_size(imsg);
+		swindow_uncharge(swindow, imsg);
+		trgm_del(swindow->trgm, imsg->serial, imsg->plain);
+
+		if (swindow->spill != NULL && spill_push(swindow->spill, imsg) != 0) {
+			screen_err_msg("Error writing scroll buffer to disk: %s",
+				strerror(errno));
+			swindow_set_spill(swindow, 0);
+		}
+
+		swindow_forget(swindow, imsg);
+		ilist_remove(&swindow->scrollbuf, imsg, link);
+		imsg_free(imsg);
+		imsg = next;
+	}
+
+	return (freed);
+}
+
+/*
+** Prune the scroll buffer so that the number of total
+** messages is not greater than swindow->scrollbuf_max.
+*/
+
+void swindow_prune(struct swindow *swindow) {
+	swindow_drop(swindow,
+		swindow->scrollbuf_len - swindow->scrollbuf_max, SIZE_MAX);
+}
+
+/*
+** Free at least "bytes" bytes of the window's oldest history, if
+** there's that much that isn't on the screen. Returns the number
+** of bytes freed.
+*/
+
+size_t swindow_evict(struct swindow *swindow, size_t bytes) {
+	return (swindow_drop(swindow, INT_MAX, bytes));
+}
+
+/*
+** Turn spilling of pruned messages to disk on or off. Anything that
+** was spilled is lost when it's turned off.
+*/
+
+void swindow_set_spill(struct swindow *swindow, uint32_t value) {
+	if (value && swindow->spill == NULL) {
+		char buf[PATH_MAX];
+
+		snprintf(buf, sizeof(buf), "%s/spill", opt_get_str(OPT_NCIC_DIR));
+		swindow->spill = spill_open(buf);
+	} else if (!value && swindow->spill != NULL) {
+		spill_close(swindow->spill);
+		swindow->spill = NULL;
+	}
+}
+
+/*
+** Called from the main loop when the compression thread is done with
+** a run of messages. If none of them were drawn in the meantime,
+** their text is replaced with the compressed block.
+*/
+
+static void swindow_compress_done(struct zjob *zjob) {
+	struct swindow *swindow = zjob->data;
+	struct zblock *zblock;
+	struct imsg *imsg;
+	uint32_t i;
+
+	if (swindow == NULL)
+		goto out;
+
+	swindow->zjob = NULL;
+
+	if (zjob->zlen == 0 || zjob->zlen >= zjob->raw_len)
+		goto retry;
+
+	imsg = zjob->first;
+	for (i = 0 ; i < zjob->count ; i++) {
+		if (imsg->touched > zjob->started)
+			goto retry;
+		imsg = ilist_prev(imsg, link);
+	}
+
+	zblock = zblock_new(zjob);
+
+	imsg = zjob->first;
+	for (i = 0 ; i < zjob->count ; i++) {
+		swindow_uncharge(swindow, imsg);
 		free(imsg->text);
-		free(imsg);
-		dlist_remove(swindow->scrollbuf, cur);
-		cur = next;
+		imsg->text = NULL;
+		imsg->zblock = zblock;
+		zblock->refs++;
+		swindow_charge(swindow, imsg);
+
+		imsg = ilist_prev(imsg, link);
+	}
+
+	zjob_free(zjob);
+	return;
+
+retry:
+	swindow->zscan = NULL;
+out:
+	zjob_free(zjob);
+}
+
+/*
+** Find the oldest run of messages that haven't been drawn since
+** "cutoff" and hand it to the compression thread. Nothing that's
+** on the screen is ever compressed.
+*/
+
+void swindow_compress(struct swindow *swindow, time_t cutoff) {
+	struct zjob *zjob;
+	uint32_t serial_top;
+	struct imsg *cur;
+	struct imsg *first;
+	uint32_t count = 0;
+	size_t raw_len = 0;
+	size_t off = 0;
+
+	if (swindow->zjob != NULL || swindow->scrollbuf_top == NULL)
+		return;
+
+	serial_top = swindow->scrollbuf_top->serial;
+
+	cur = swindow->zscan;
+	if (cur == NULL)
+		cur = ilist_last(&swindow->scrollbuf);
+
+	while (cur != NULL && cur->zblock != NULL)
+		cur = ilist_prev(cur, link);
+
+	swindow->zscan = cur;
+	first = cur;
+
+	while (cur != NULL && count < ZBLOCK_MAX_MSGS) {
+		if (cur->zblock != NULL) {
+			/* Skip over a run that's too short to bother with. */
+			if (count < ZBLOCK_MIN_MSGS)
+				swindow->zscan = cur;
+			break;
+		}
+
+		if (cur->touched > cutoff || cur->serial >= serial_top)
+			break;
+
+		raw_len += (cur->len + 1) * sizeof(chtype);
+		count++;
+		cur = ilist_prev(cur, link);
+	}
+
+	if (count < ZBLOCK_MIN_MSGS)
+		return;
+
+	zjob = xcalloc(1, sizeof(*zjob));
+	zjob->data = swindow;
+	zjob->done = swindow_compress_done;
+	zjob->first = first;
+	zjob->count = count;
+	zjob->first_serial = first->serial;
+	zjob->started = time(NULL);
+	zjob->raw = xmalloc(raw_len);
+	zjob->raw_len = raw_len;
+
+	for (cur = first ; count > 0 ; count--, cur = ilist_prev(cur, link)) {
+		size_t len = (cur->len + 1) * sizeof(chtype);
+
+		memcpy(zjob->raw + off, cur->text, len);
+		cur->zoff = off / sizeof(chtype);
+		zjob->last_serial = cur->serial;
+		off += len;
+	}
+
+	/* The next scan picks up where this one ended. */
+	swindow->zscan = cur;
+
+	if (zblock_submit(zjob) != 0) {
+		zjob_free(zjob);
+		return;
+	}
+
+	swindow->zjob = zjob;
+}
+
+/*
+** Page in the next batch of spilled messages, adding them to
+** the tail of the scroll buffer. Returns the number paged in.
+*/
+
+static uint32_t swindow_page_in(struct swindow *swindow) {
+	uint32_t i;
+
+	if (swindow->spill == NULL || ilist_empty(&swindow->scrollbuf))
+		return (0);
+
+	for (i = 0 ; i < SWINDOW_PAGE_IN ; i++) {
+		struct imsg *imsg = spill_pop(swindow->spill);
+
+		if (imsg == NULL)
+			break;
+
+		imsg->lines = imsg_lines(swindow, imsg);
+		imsg->plain = cstr_to_plaintext(imsg->text, imsg->len);
+
+		ilist_add_tail(&swindow->scrollbuf, imsg, link);
+		swindow->scrollbuf_len++;
+		swindow->scrollbuf_lines += imsg->lines;
+		swindow_charge(swindow, imsg);
+		trgm_add(swindow->trgm, imsg->serial, imsg->plain);
 	}
 
-	swindow->scrollbuf_end = cur;
+	return (i);
 }
 
 /*
@@ -215,10 +639,9 @@ void swindow_prune(struct swindow *swindow) {
 */
 
 static void swindow_adjust_top(struct swindow *swindow, uint32_t n) {
-	dlist_t *cur = swindow->scrollbuf_top;
+	struct imsg *imsg = swindow->scrollbuf_top;
 
 	while (1) {
-		struct imsg *imsg = cur->data;
 		uint32_t visible_lines = imsg->lines;
 
 		if (swindow->top_hidden != 0) {
@@ -228,7 +651,7 @@ static void swindow_adjust_top(struct swindow *swindow, uint32_t n) {
 
 		if (visible_lines == n) {
 			swindow->top_hidden = 0;
-			cur = cur->prev;
+			imsg = ilist_prev(imsg, link);
 			break;
 		}
 
@@ -238,10 +661,10 @@ static void swindow_adjust_top(struct swindow *swindow, uint32_t n) {
 		}
 
 		n -= visible_lines;
-		cur = cur->prev;
+		imsg = ilist_prev(imsg, link);
 	}
 
-	swindow->scrollbuf_top = cur;
+	swindow->scrollbuf_top = imsg;
 }
 
 /*
@@ -255,7 +678,7 @@ static void swindow_recalculate(struct swindow *swindow,
 								uint32_t old_rows,
 								uint32_t old_cols)
 {
-	dlist_t *cur = swindow->scrollbuf;
+	struct imsg *imsg;
 	uint32_t total_lines = 0;
 	struct imsg *imsg_top;
 	uint32_t old_top;
@@ -265,15 +688,12 @@ static void swindow_recalculate(struct swindow *swindow,
 		return;
 	}
 
-	imsg_top = swindow->scrollbuf_top->data;
+	imsg_top = swindow->scrollbuf_top;
 	old_top = imsg_top->lines;
 
-	while (cur != NULL) {
-		struct imsg *imsg = cur->data;
-
+	ilist_foreach(imsg, &swindow->scrollbuf, link) {
 		imsg->lines = imsg_lines(swindow, imsg);
 		total_lines += imsg->lines;
-		cur = cur->next;
 	}
 
 	swindow->scrollbuf_lines = total_lines;
@@ -342,10 +762,10 @@ int swindow_refresh(struct swindow *swindow) {
 */
 
 void swindow_redraw(struct swindow *swindow) {
-	dlist_t *cur = swindow->scrollbuf_top;
+	struct imsg *imsg = swindow->scrollbuf_top;
 	uint32_t curs_pos = 0;
 
-	if (cur == NULL)
+	if (imsg == NULL)
 		return;
 	/*
 	** If part of the top message is scrolled off
@@ -353,26 +773,22 @@ void swindow_redraw(struct swindow *swindow) {
 	** the pointer to the next message.
 	*/
 	if (swindow->top_hidden != 0) {
-		struct imsg *imsg = cur->data;
-
 		curs_pos += imsg->lines - swindow->top_hidden;
 		if (curs_pos > swindow->rows) {
 			swindow->bottom_blank = 0;
 			swindow->bottom_hidden = curs_pos - swindow->rows;
-			swindow->scrollbuf_bot = cur;
+			swindow->scrollbuf_bot = imsg;
 			swindow_print_msg(swindow, imsg, 0, 0, swindow->top_hidden + 1,
 				curs_pos + swindow->rows);
 		} else
 			swindow_print_msg(swindow, imsg, 0, 0, swindow->top_hidden + 1, -1);
 
-		cur = cur->prev;
+		imsg = ilist_prev(imsg, link);
 	}
 
-	while (cur != NULL && curs_pos < swindow->rows) {
-		struct imsg *imsg = cur->data;
-
+	while (imsg != NULL && curs_pos < swindow->rows) {
 		if (curs_pos + imsg->lines > swindow->rows) {
-			swindow->scrollbuf_bot = cur;
+			swindow->scrollbuf_bot = imsg;
 			swindow->bottom_blank = 0;
 			swindow->bottom_hidden = imsg->lines - (swindow->rows - curs_pos);
 
@@ -384,23 +800,39 @@ void swindow_redraw(struct swindow *swindow) {
 		swindow_print_msg(swindow, imsg, curs_pos, 0, 1, -1);
 		curs_pos += imsg->lines;
 
-		if (cur->prev == NULL) {
-			swindow->scrollbuf_bot = cur;
+		if (ilist_prev(imsg, link) == NULL) {
+			swindow->scrollbuf_bot = imsg;
 			swindow->bottom_blank = swindow->rows - curs_pos;
 			swindow->bottom_hidden = 0;
 			swindow->held = 0;
 		} else if (curs_pos == swindow->rows) {
-			swindow->scrollbuf_bot = cur;
+			swindow->scrollbuf_bot = imsg;
 			swindow->bottom_hidden = 0;
 			swindow->bottom_blank = 0;
 		}
 
-		cur = cur->prev;
+		imsg = ilist_prev(imsg, link);
 	}
 
 	swindow->dirty = 1;
 }
 
+/*
+** Called when the window becomes visible. If anything was
+** added to it while it was hidden, paint it now.
+*/
+
+void swindow_show(struct swindow *swindow) {
+	swindow->visible = 1;
+	swindow->viewed = ++swindow_view_clock;
+
+	if (swindow->stale) {
+		swindow->stale = 0;
+		wclear(swindow->win);
+		swindow_redraw(swindow);
+	}
+}
+
 /*
 ** It's the caller's responsibility to make sure there's nothing
 ** funny in the message that's being added -- things like tabs
@@ -410,7 +842,8 @@ void swindow_redraw(struct swindow *swindow) {
 
 int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t msgtype) {
 	uint32_t msg_line_start = 1;
-	dlist_t *old_head = swindow->scrollbuf;
+	uint32_t evict = 0;
+	struct imsg *old_head = ilist_first(&swindow->scrollbuf);
 	int y_pos;
 
 	/*
@@ -419,44 +852,49 @@ int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t msgtype) {
 	** window before doing anything else.
 	*/
 
-	if ((swindow->scrollbuf_bot != swindow->scrollbuf ||
+	if ((swindow->scrollbuf_bot != ilist_first(&swindow->scrollbuf) ||
 		swindow->bottom_hidden != 0) &&
 		swindow->scroll_on_output)
 	{
 		swindow_scroll_to_end(swindow);
 	}
 
-	if (swindow->logged && (swindow->log_type & msgtype)) {
-    struct iovec wvec[2];
-		char *plaintext;
+	if (imsg->plain == NULL)
+		imsg->plain = cstr_to_plaintext(imsg->text, imsg->len);
+
+	if (swindow->logged && swindow->blog != NULL &&
+		(swindow->log_type & msgtype))
+	{
+		blog_write(swindow->blog, time(NULL), msgtype, blog_get_sender(),
+			imsg->plain, imsg->len);
+	} else if (swindow->logged && (swindow->log_type & msgtype)) {
+		struct iovec wvec[2];
+		time_t now = time(NULL);
+
+		if (log_rotate_due(swindow->log, now))
+			swindow_rotate_log(swindow, now);
 
-		plaintext = cstr_to_plaintext(imsg->text, imsg->len);
-		wvec[0].iov_base = plaintext;
+		wvec[0].iov_base = imsg->plain;
 		wvec[0].iov_len = imsg->len;
 		wvec[1].iov_base = "\n";
 		wvec[1].iov_len = 1;
 
-		if (writev(swindow->log_fd, wvec, 2) != (int) imsg->len + 1) {
-			screen_err_msg("Error writing logfile: %s",
-				strerror(errno));
-		}
-
-		free(plaintext);
+		log_writev(swindow->log, wvec, 2);
 	}
 
-	swindow->scrollbuf = dlist_add_head(swindow->scrollbuf, imsg);
+	ilist_add_head(&swindow->scrollbuf, imsg, link);
 	swindow->scrollbuf_len++;
 	swindow->scrollbuf_lines += imsg->lines;
+	swindow_charge(swindow, imsg);
+	trgm_add(swindow->trgm, imsg->serial, imsg->plain);
 
 	/*
 	** If this is the first message in the window, save a pointer
 	** to it for use with the scrolling routines.
 	*/
 
-	if (old_head == NULL) {
-		swindow->scrollbuf_end = swindow->scrollbuf;
-		swindow->scrollbuf_top = swindow->scrollbuf;
-	}
+	if (old_head == NULL)
+		swindow->scrollbuf_top = imsg;
 
 	/*
 	** If the window is scrolled back, but the scroll
@@ -477,13 +915,13 @@ int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t msgtype) {
 	** (the element containing the message we just added).
 	*/
 
-	swindow->scrollbuf_bot = swindow->scrollbuf;
+	swindow->scrollbuf_bot = imsg;
 
 	if (imsg->lines <= swindow->bottom_blank) {
 		y_pos = swindow->rows - swindow->bottom_blank;
 		swindow->bottom_blank -= imsg->lines;
 	} else {
-		uint32_t evict = imsg->lines - swindow->bottom_blank;
+		evict = imsg->lines - swindow->bottom_blank;
 
 		swindow->bottom_blank = 0;
 		swindow_adjust_top(swindow, evict);
@@ -500,15 +938,25 @@ int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t msgtype) {
 			y_pos = 0;
 			msg_line_start = imsg->lines - swindow->rows + 1;
 		}
-
-		swindow_scroll(swindow, evict);
 	}
 
-	swindow_print_msg(swindow, imsg, y_pos, 0, msg_line_start, -1);
-	swindow->dirty = 1;
+	/*
+	** Hidden windows only keep track of their scroll position.
+	** The screen is painted once, when the window is shown.
+	*/
+
+	if (swindow->visible) {
+		if (evict > 0)
+			swindow_scroll(swindow, evict);
+
+		swindow_print_msg(swindow, imsg, y_pos, 0, msg_line_start, -1);
+		swindow->dirty = 1;
+	} else {
+		swindow->stale = 1;
 
-	if (!swindow->visible && (swindow->activity_type & msgtype))
-		swindow->activity = 1;
+		if (swindow->activity_type & msgtype)
+			swindow->activity = 1;
+	}
 
 	/*
 	** If there's a maximum scroll buffer length, enforce it.
@@ -520,6 +968,50 @@ int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t msgtype) {
 	return (0);
 }
 
+/*
+** Add "n" messages, oldest first, to the window without logging them,
+** and repaint once at the end instead of once per message.
+*/
+
+void swindow_add_bulk(struct swindow *swindow, struct imsg **imsgs, size_t n) {
+	struct imsg *old_head = ilist_first(&swindow->scrollbuf);
+	uint32_t lines = 0;
+	size_t i;
+
+	if (n == 0)
+		return;
+
+	for (i = 0 ; i < n ; i++) {
+		struct imsg *imsg = imsgs[i];
+
+		if (imsg->plain == NULL)
+			imsg->plain = cstr_to_plaintext(imsg->text, imsg->len);
+
+		ilist_add_head(&swindow->scrollbuf, imsg, link);
+		swindow->scrollbuf_len++;
+		swindow->scrollbuf_lines += imsg->lines;
+		swindow_charge(swindow, imsg);
+		trgm_add(swindow->trgm, imsg->serial, imsg->plain);
+		lines += imsg->lines;
+
+		if (old_head == NULL && i == 0) {
+			swindow->scrollbuf_top = imsg;
+			swindow->top_hidden = 0;
+		}
+	}
+
+	if (old_head != swindow->scrollbuf_bot && !swindow->scroll_on_output) {
+		swindow->held += lines;
+	} else {
+		swindow_scroll_to_end(swindow);
+		if (!swindow->visible)
+			swindow->stale = 1;
+	}
+
+	if (swindow->scrollbuf_len > swindow->scrollbuf_max)
+		swindow_prune(swindow);
+}
+
 /* Called when a message sent by a user is written to a window. */
 inline int swindow_input(struct swindow *swindow) {
 	/*
@@ -528,7 +1020,7 @@ inline int swindow_input(struct swindow *swindow) {
 	** window before doing anything else.
 	*/
 
-	if ((swindow->scrollbuf_bot != swindow->scrollbuf ||
+	if ((swindow->scrollbuf_bot != ilist_first(&swindow->scrollbuf) ||
 		swindow->bottom_hidden != 0) &&
 		swindow->scroll_on_input)
 	{
@@ -543,41 +1035,43 @@ inline int swindow_input(struct swindow *swindow) {
 */
 
 void swindow_scroll_to_end(struct swindow *swindow) {
-	dlist_t *cur;
+	struct imsg *imsg;
 	uint32_t lines = 0;
 
-	if (swindow->scrollbuf == NULL)
+	if (ilist_empty(&swindow->scrollbuf))
 		return;
 
 	/* Avoid a redraw if it's already at the bottom */
-	if (swindow->scrollbuf_bot == swindow->scrollbuf &&
+	if (swindow->scrollbuf_bot == ilist_first(&swindow->scrollbuf) &&
 		swindow->bottom_hidden == 0)
 	{
 		return;
 	}
 
-	cur = swindow->scrollbuf;
+	imsg = ilist_first(&swindow->scrollbuf);
 	do {
-		struct imsg *imsg = cur->data;
-
 		lines += imsg->lines;
 		if (lines >= swindow->rows) {
-			swindow->scrollbuf_top = cur;
+			swindow->scrollbuf_top = imsg;
 			swindow->top_hidden = lines - swindow->rows;
 			break;
 		}
 
-		if (cur->next == NULL) {
-			swindow->scrollbuf_top = cur;
+		if (ilist_next(imsg, link) == NULL) {
+			swindow->scrollbuf_top = imsg;
 			swindow->top_hidden = 0;
 			break;
 		}
-		cur = cur->next;
+		imsg = ilist_next(imsg, link);
 	} while (1);
 
 	swindow->held = 0;
 	wclear(swindow->win);
 	swindow_redraw(swindow);
+
+	/* Let go of anything that was paged in while scrolled up. */
+	if (swindow->scrollbuf_len > swindow->scrollbuf_max)
+		swindow_prune(swindow);
 }
 
 /*
@@ -585,18 +1079,18 @@ void swindow_scroll_to_end(struct swindow *swindow) {
 */
 
 void swindow_scroll_to_start(struct swindow *swindow) {
-	if (swindow->scrollbuf == NULL)
+	if (ilist_empty(&swindow->scrollbuf))
 		return;
 
 	/* Avoid a redraw if it's already at the top */
-	if (swindow->scrollbuf_top == swindow->scrollbuf_end &&
+	if (swindow->scrollbuf_top == ilist_last(&swindow->scrollbuf) &&
 		swindow->top_hidden == 0)
 	{
 		return;
 	}
 
 	swindow->top_hidden = 0;
-	swindow->scrollbuf_top = swindow->scrollbuf_end;
+	swindow->scrollbuf_top = ilist_last(&swindow->scrollbuf);
 
 	wclear(swindow->win);
 	swindow_redraw(swindow);
@@ -612,27 +1106,27 @@ static uint32_t swindow_scroll_down_by(struct swindow *swindow, uint32_t lines)
 	for (i = 0 ; i < lines ; i++) {
 		struct imsg *imsg;
 
-		if (swindow->scrollbuf_bot->prev == NULL &&
+		if (ilist_prev(swindow->scrollbuf_bot, link) == NULL &&
 			swindow->bottom_hidden == 0)
 		{
 			swindow->held = 0;
 			break;
 		}
 
-		imsg = swindow->scrollbuf_top->data;
+		imsg = swindow->scrollbuf_top;
 
 		if (++swindow->top_hidden == imsg->lines) {
 			swindow->top_hidden = 0;
-			if (swindow->scrollbuf_top->prev == NULL)
+			if (ilist_prev(imsg, link) == NULL)
 				return (1);
-			swindow->scrollbuf_top = swindow->scrollbuf_top->prev;
+			swindow->scrollbuf_top = ilist_prev(imsg, link);
 		}
 
 		if (swindow->bottom_hidden > 0)
 			swindow->bottom_hidden--;
 		else {
-			swindow->scrollbuf_bot = swindow->scrollbuf_bot->prev;
-			imsg = swindow->scrollbuf_bot->data;
+			imsg = ilist_prev(swindow->scrollbuf_bot, link);
+			swindow->scrollbuf_bot = imsg;
 			swindow->bottom_hidden = imsg->lines - 1;
 		}
 	}
@@ -641,10 +1135,14 @@ static uint32_t swindow_scroll_down_by(struct swindow *swindow, uint32_t lines)
 }
 
 static uint32_t swindow_scroll_up_by(struct swindow *swindow, uint32_t lines) {
-	dlist_t *cur;
+	struct imsg *cur;
 
-	if (swindow->top_hidden == 0 && swindow->scrollbuf_top->next == NULL)
+	if (swindow->top_hidden == 0 &&
+		ilist_next(swindow->scrollbuf_top, link) == NULL &&
+		swindow_page_in(swindow) == 0)
+	{
 		return (0);
+	}
 
 	if (swindow->top_hidden >= lines) {
 		swindow->top_hidden -= lines;
@@ -654,29 +1152,36 @@ static uint32_t swindow_scroll_up_by(struct swindow *swindow, uint32_t lines) {
 	lines -= swindow->top_hidden;
 	swindow->top_hidden = 0;
 
-	cur = swindow->scrollbuf_top->next;
-	while (lines > 0 && cur != NULL) {
-		struct imsg *msg = cur->data;
+	cur = swindow->scrollbuf_top;
+	while (lines > 0) {
+		if (ilist_next(cur, link) == NULL && swindow_page_in(swindow) == 0)
+			break;
+
+		cur = ilist_next(cur, link);
 
-		if (msg->lines >= lines) {
+		if (cur->lines >= lines) {
 			swindow->scrollbuf_top = cur;
-			swindow->top_hidden = msg->lines - lines;
+			swindow->top_hidden = cur->lines - lines;
 			return (1);
 		}
 
-		lines -= msg->lines;
-		cur = cur->next;
+		lines -= cur->lines;
 	}
 
 	if (lines > 0)
-		swindow->scrollbuf_top = swindow->scrollbuf_end;
+		swindow->scrollbuf_top = ilist_last(&swindow->scrollbuf);
 
 	return (1);
 }
 
 int swindow_scroll_by(struct swindow *swindow, int lines) {
-	/* Can't scroll if there are less (or equal to) lines than rows */
-	if (swindow->scrollbuf_lines > swindow->rows) {
+	/*
+	** Can't scroll if there are less (or equal to) lines than rows,
+	** unless there's more history waiting to be paged in.
+	*/
+	if (swindow->scrollbuf_lines > swindow->rows ||
+		(swindow->spill != NULL && swindow->spill->records > 0))
+	{
 		int ret;
 
 		if (lines < 0)
@@ -701,63 +1206,538 @@ int swindow_scroll_by(struct swindow *swindow, int lines) {
 }
 
 /*
-** Print all messages in the buffer for this window that match
-** the specified regular expression.
+** A run of messages from one window to be checked against a pattern,
+** possibly by another thread. The scroll buffers aren't touched while
+** a search is running, since the main loop waits for it to finish.
 */
 
-int swindow_print_matching(	struct swindow *swindow,
-							const char *regex,
-							uint32_t options)
+struct swindow_scan {
+	struct match *match;
+	size_t which;
+	/* the messages to check, oldest first, or NULL for the spill segment */
+	struct imsg **msgs;
+	size_t num;
+	struct spill *spill;
+
+	struct swindow_hit *hits;
+	size_t num_hits;
+	size_t size_hits;
+};
+
+static void swindow_scan_hit(	struct swindow_scan *scan,
+								uint32_t serial,
+								struct imsg *imsg,
+								struct spill_rec *rec)
 {
-	int cflags = REG_EXTENDED;
-	regex_t preg;
-	dlist_t *cur;
-	dlist_t *match_list = NULL;
+	struct swindow_hit *hit;
 
-	if (regex == NULL)
-		return (-1);
+	if (scan->num_hits == scan->size_hits) {
+		scan->size_hits = scan->size_hits == 0 ? 16 : scan->size_hits * 2;
+		scan->hits = xrealloc(scan->hits, scan->size_hits * sizeof(*hit));
+	}
 
-	if (options & SWINDOW_FIND_ICASE)
-		cflags |= REG_ICASE;
+	hit = &scan->hits[scan->num_hits++];
+	hit->which = scan->which;
+	hit->serial = serial;
+	hit->imsg = imsg;
+	hit->rec = rec;
+}
+
+static void swindow_scan_run(void *data) {
+	struct swindow_scan *scan = data;
+	size_t i;
+
+	if (scan->msgs == NULL) {
+		struct spill_rec *rec;
+
+		for (rec = spill_first(scan->spill) ; rec != NULL ; rec = spill_next(scan->spill, rec)) {
+			char *buf;
+
+			buf = cstr_to_plaintext(spill_rec_text(rec), rec->len);
+			if (match_exec(scan->match, buf, NULL, NULL))
+				swindow_scan_hit(scan, rec->serial, NULL, rec);
+			free(buf);
+		}
+
+		return;
+	}
+
+	for (i = 0 ; i < scan->num ; i++) {
+		struct imsg *imsg = scan->msgs[i];
+
+		if (match_exec(scan->match, imsg->plain, NULL, NULL))
+			swindow_scan_hit(scan, imsg->serial, imsg, NULL);
+	}
+}
+
+static struct swindow_scan *swindow_scan_new(	struct match *match,
+												size_t which,
+												struct imsg **msgs,
+												size_t num)
+{
+	struct swindow_scan *scan;
+
+	scan = xcalloc(1, sizeof(*scan));
+	scan->match = match;
+	scan->which = which;
+	scan->msgs = msgs;
+	scan->num = num;
+
+	return (scan);
+}
+
+/*
+** Make a list of the messages in the window that could match,
+** oldest first. Only the messages that contain every literal run
+** of three or more characters in the pattern need to be checked.
+*/
+
+static struct imsg **swindow_scan_list(	struct swindow *swindow,
+										const char *regex,
+										uint32_t options,
+										size_t *num)
+{
+	struct imsg **msgs;
+	uint32_t *cands;
+	size_t num_cands;
+	size_t i = 0;
+	size_t n = 0;
+	struct imsg *imsg;
+
+	cands = trgm_candidates(swindow->trgm, regex,
+				!(options & SWINDOW_FIND_BASIC), &num_cands);
+
+	if (cands == NULL)
+		num_cands = swindow->scrollbuf_len;
+
+	msgs = xmalloc((num_cands + 1) * sizeof(*msgs));
+
+	ilist_foreach_reverse(imsg, &swindow->scrollbuf, link) {
+		if (cands != NULL) {
+			while (i < num_cands && cands[i] < imsg->serial)
+				i++;
+
+			if (i == num_cands)
+				break;
+
+			if (cands[i] != imsg->serial)
+				continue;
+		}
+
+		if (n == num_cands)
+			break;
+
+		msgs[n++] = imsg;
+	}
+
+	free(cands);
+	*num = n;
+	return (msgs);
+}
+
+static int swindow_hit_cmp(const void *l, const void *r) {
+	const struct swindow_hit *hl = l;
+	const struct swindow_hit *hr = r;
+
+	return ((hl->serial > hr->serial) - (hl->serial < hr->serial));
+}
+
+/*
+** Search the scroll buffers (and spill segments) of "num" windows
+** for messages matching the regular expression "regex". The search
+** is split up across the thread pool. On success, "hits" is set to
+** a list of copies of the matching messages, oldest first, each
+** tagged with the index of the window it came from. The caller is
+** responsible for the copies and the list.
+*/
+
+int swindow_find(	struct swindow **swindows,
+					size_t num,
+					const char *regex,
+					uint32_t options,
+					struct swindow_hit **hits,
+					size_t *num_hits)
+{
+	struct match match;
+	uint32_t flags = 0;
+	struct swindow_scan **scans = NULL;
+	struct imsg ***lists;
+	struct swindow_hit *ret;
+	size_t num_scans = 0;
+	size_t total = 0;
+	size_t i;
+
+	if (regex == NULL)
+		return (-1);
+
+	if (options & SWINDOW_FIND_ICASE)
+		flags |= MATCH_ICASE;
 
 	if (options & SWINDOW_FIND_BASIC)
-		cflags &= ~REG_EXTENDED;
+		flags |= MATCH_BASIC;
 
-	if (regcomp(&preg, regex, cflags) != 0)
+	if (match_compile(&match, regex, flags) != 0)
 		return (-1);
 
-	for (cur = swindow->scrollbuf ; cur != NULL ; cur = cur->next) {
-		struct imsg *imsg = cur->data;
-		char *buf;
+	lists = xmalloc(num * sizeof(*lists));
 
-		buf = cstr_to_plaintext(imsg->text, imsg->len);
-		if (buf != NULL) {
-			if (regexec(&preg, buf, 0, NULL, 0) == 0)
-				match_list = dlist_add_head(match_list, imsg);
-			free(buf);
+	for (i = 0 ; i < num ; i++) {
+		struct swindow *swindow = swindows[i];
+		size_t len;
+		size_t off;
+
+		/* Map the spill segment here, rather than on a worker. */
+		if (swindow->spill != NULL && spill_first(swindow->spill) != NULL) {
+			struct swindow_scan *scan = swindow_scan_new(&match, i, NULL, 0);
+
+			scan->spill = swindow->spill;
+			scans = xrealloc(scans, (num_scans + 1) * sizeof(*scans));
+			scans[num_scans++] = scan;
+		}
+
+		lists[i] = swindow_scan_list(swindow, regex, options, &len);
+
+		for (off = 0 ; off < len ; off += SWINDOW_SCAN_MSGS) {
+			scans = xrealloc(scans, (num_scans + 1) * sizeof(*scans));
+			scans[num_scans++] = swindow_scan_new(&match, i, &lists[i][off],
+									min(len - off, SWINDOW_SCAN_MSGS));
+		}
+	}
+
+	pool_run(swindow_scan_run, (void **) scans, num_scans);
+
+	for (i = 0 ; i < num_scans ; i++)
+		total += scans[i]->num_hits;
+
+	ret = xmalloc((total + 1) * sizeof(*ret));
+	total = 0;
+
+	for (i = 0 ; i < num_scans ; i++) {
+		if (scans[i]->num_hits > 0) {
+			memcpy(&ret[total], scans[i]->hits,
+				scans[i]->num_hits * sizeof(*ret));
+			total += scans[i]->num_hits;
 		}
+
+		free(scans[i]->hits);
+		free(scans[i]);
 	}
 
-	regfree(&preg);
+	/*
+	** Serial numbers are handed out in order across all windows,
+	** so sorting by serial puts the matches in the order they
+	** were written.
+	*/
+
+	qsort(ret, total, sizeof(*ret), swindow_hit_cmp);
 
 	/*
-	** Better to compile a list of matches and print them after scanning
-	** the whole buffer. If we started scanning at the oldest message and
-	** printed matches as we traversed the scrollbuffer list, bad interactions
-	** with swindow_prune() could occur.
+	** Copy all the matches before the caller adds any of them to a
+	** window, as that could prune the messages they're copied from.
 	*/
-	cur = match_list;
-	while (cur != NULL) {
-		dlist_t *next = cur->next;
 
-		swindow_add(swindow, imsg_copy(swindow, cur->data), MSG_TYPE_LASTLOG);
-		free(cur);
-		cur = next;
+	for (i = 0 ; i < total ; i++) {
+		if (ret[i].rec != NULL) {
+			ret[i].imsg = spill_rec_imsg(ret[i].rec);
+			ret[i].imsg->serial = swindow_next_serial();
+			ret[i].rec = NULL;
+		} else
+			ret[i].imsg = imsg_copy(ret[i].imsg);
 	}
 
+	for (i = 0 ; i < num ; i++) {
+		if (swindows[i]->spill != NULL)
+			spill_done(swindows[i]->spill);
+
+		free(lists[i]);
+	}
+
+	free(lists);
+	free(scans);
+	match_free(&match);
+
+	*hits = ret;
+	*num_hits = total;
 	return (0);
 }
 
+/*
+** Print all messages in the buffer for this window that match
+** the specified regular expression.
+*/
+
+int swindow_print_matching(	struct swindow *swindow,
+							const char *regex,
+							uint32_t options)
+{
+	struct swindow_hit *hits;
+	size_t num_hits;
+	size_t i;
+
+	if (swindow_find(&swindow, 1, regex, options, &hits, &num_hits) != 0)
+		return (-1);
+
+	for (i = 0 ; i < num_hits ; i++) {
+		struct imsg *imsg = hits[i].imsg;
+
+		imsg->lines = imsg_lines(swindow, imsg);
+		swindow_add(swindow, imsg, MSG_TYPE_LASTLOG);
+	}
+
+	free(hits);
+	return (0);
+}
+
+/*
+** Start an incremental search. Nothing is looked for until a
+** pattern is given with swindow_search_set().
+*/
+
+void swindow_search_begin(struct swindow *swindow) {
+	struct swindow_search *search;
+
+	if (swindow->search != NULL)
+		return;
+
+	search = xcalloc(1, sizeof(*search));
+	search->saved_top = swindow->scrollbuf_top;
+	search->saved_top_hidden = swindow->top_hidden;
+	search->origin = swindow->scrollbuf_bot;
+	search->at_end = (swindow->bottom_hidden == 0 &&
+		swindow->scrollbuf_bot == ilist_first(&swindow->scrollbuf));
+
+	swindow->search = search;
+}
+
+static void swindow_search_free(struct swindow_search *search) {
+	if (search->compiled)
+		match_free(&search->match);
+
+	free(search->pattern);
+	free(search);
+}
+
+/*
+** Scroll to the end of the buffer, repainting the screen even if
+** it's already there.
+*/
+
+static void swindow_search_to_end(struct swindow *swindow) {
+	if (swindow->scrollbuf_bot != ilist_first(&swindow->scrollbuf) ||
+		swindow->bottom_hidden != 0)
+	{
+		swindow_scroll_to_end(swindow);
+		return;
+	}
+
+	wclear(swindow->win);
+	swindow_redraw(swindow);
+}
+
+/*
+** Put the screen back where it was when the search was started.
+*/
+
+static void swindow_search_restore(struct swindow *swindow) {
+	struct swindow_search *search = swindow->search;
+
+	if (search->at_end || search->saved_top == NULL) {
+		swindow_search_to_end(swindow);
+		return;
+	}
+
+	swindow->scrollbuf_top = search->saved_top;
+	swindow->top_hidden = search->saved_top_hidden;
+
+	wclear(swindow->win);
+	swindow_redraw(swindow);
+}
+
+/*
+** Bring "imsg" onto the screen, putting it on the top line unless
+** it's within a screen of the end of the buffer.
+*/
+
+static void swindow_search_show(struct swindow *swindow, struct imsg *imsg) {
+	uint32_t serial_top = swindow->scrollbuf_top->serial;
+	uint32_t serial_bot = swindow->scrollbuf_bot->serial;
+
+	if (imsg->serial < serial_top || imsg->serial > serial_bot ||
+		(imsg == swindow->scrollbuf_top && swindow->top_hidden != 0) ||
+		(imsg == swindow->scrollbuf_bot && swindow->bottom_hidden != 0))
+	{
+		struct imsg *cur = imsg;
+		uint32_t lines = 0;
+
+		while (cur != NULL && lines < swindow->rows) {
+			lines += cur->lines;
+			cur = ilist_prev(cur, link);
+		}
+
+		if (lines < swindow->rows) {
+			swindow_search_to_end(swindow);
+			return;
+		}
+
+		swindow->scrollbuf_top = imsg;
+		swindow->top_hidden = 0;
+	}
+
+	wclear(swindow->win);
+	swindow_redraw(swindow);
+}
+
+/*
+** Change the pattern that's being searched for, and start looking
+** for it from where the screen was when the search was started.
+** An empty pattern puts the screen back there. Returns -1 if the
+** pattern is no good.
+*/
+
+int swindow_search_set(	struct swindow *swindow,
+						const char *pattern,
+						uint32_t options)
+{
+	struct swindow_search *search = swindow->search;
+	uint32_t flags = 0;
+
+	if (search == NULL)
+		return (-1);
+
+	if (search->pattern != NULL && !strcmp(search->pattern, pattern) &&
+		search->options == options)
+	{
+		return (0);
+	}
+
+	if (search->compiled)
+		match_free(&search->match);
+
+	free(search->pattern);
+	search->pattern = xstrdup(pattern);
+	search->options = options;
+	search->compiled = 0;
+	search->failed = 0;
+	search->cur = NULL;
+	search->scan = NULL;
+
+	if (*pattern == '\0') {
+		swindow_search_restore(swindow);
+		return (0);
+	}
+
+	if (options & SWINDOW_FIND_ICASE)
+		flags |= MATCH_ICASE;
+
+	if (options & SWINDOW_FIND_BASIC)
+		flags |= MATCH_BASIC;
+
+	if (match_compile(&search->match, pattern, flags) == 0) {
+		search->compiled = 1;
+		search->dir = SWINDOW_SEARCH_OLDER;
+		search->scan = search->origin;
+	} else
+		search->failed = 1;
+
+	/* Take the old pattern's highlighting off the screen. */
+	if (swindow->scrollbuf_top != NULL) {
+		wclear(swindow->win);
+		swindow_redraw(swindow);
+	}
+
+	return (search->compiled ? 0 : -1);
+}
+
+/*
+** Look for the next match in the direction "dir", starting from
+** the current one.
+*/
+
+void swindow_search_next(struct swindow *swindow, int dir) {
+	struct swindow_search *search = swindow->search;
+
+	if (search == NULL || !search->compiled)
+		return;
+
+	search->dir = dir;
+
+	if (search->cur == NULL)
+		search->scan = search->origin;
+	else if (dir == SWINDOW_SEARCH_OLDER)
+		search->scan = ilist_next(search->cur, link);
+	else
+		search->scan = ilist_prev(search->cur, link);
+
+	if (search->scan == NULL)
+		search->failed = 1;
+}
+
+/*
+** Check the next slice of messages for a match, and scroll to it if
+** one is found. Returns non-zero if there's more left to check.
+*/
+
+int swindow_search_run(struct swindow *swindow) {
+	struct swindow_search *search = swindow->search;
+	struct imsg *cur;
+	uint32_t i;
+
+	if (search == NULL || search->scan == NULL)
+		return (0);
+
+	cur = search->scan;
+	for (i = 0 ; i < SWINDOW_SEARCH_SLICE && cur != NULL ; i++) {
+		if (match_exec(&search->match, cur->plain, NULL, NULL)) {
+			search->cur = cur;
+			search->scan = NULL;
+			search->failed = 0;
+			swindow_search_show(swindow, cur);
+			return (0);
+		}
+
+		if (search->dir == SWINDOW_SEARCH_OLDER)
+			cur = ilist_next(cur, link);
+		else
+			cur = ilist_prev(cur, link);
+	}
+
+	search->scan = cur;
+	if (cur == NULL) {
+		search->failed = 1;
+		return (0);
+	}
+
+	return (1);
+}
+
+int swindow_search_failed(struct swindow *swindow) {
+	return (swindow->search != NULL && swindow->search->failed);
+}
+
+/*
+** Finish the search. If "restore" is set, the screen goes back to
+** where it was when the search was started, otherwise it's left at
+** the last match.
+*/
+
+void swindow_search_end(struct swindow *swindow, int restore) {
+	struct swindow_search *search = swindow->search;
+
+	if (search == NULL)
+		return;
+
+	if (restore)
+		swindow_search_restore(swindow);
+
+	swindow->search = NULL;
+	swindow_search_free(search);
+
+	if (swindow->scrollbuf_top != NULL) {
+		wclear(swindow->win);
+		swindow_redraw(swindow);
+	}
+}
+
 /*
 ** Turn timestamping on or off, depending on the value of "value"
 */
@@ -781,36 +1761,127 @@ inline void swindow_set_wordwrap(struct swindow *swindow, uint32_t value) {
 ** dump everything in the window to the specified file.
 */
 
+static int swindow_dump_flush(struct swindow_dump *dump) {
+	char *p = dump->buf;
+	size_t len = dump->len;
+
+	while (len > 0 && dump->err == 0) {
+		ssize_t ret = write(dump->fd, p, len);
+
+		if (ret == -1) {
+			if (errno != EINTR)
+				dump->err = errno;
+			continue;
+		}
+
+		p += ret;
+		len -= ret;
+	}
+
+	dump->len = 0;
+	return (dump->err == 0 ? 0 : -1);
+}
+
+/*
+** Add a line to the dump, from its plain text if there is any, or
+** else from its text with the attributes stripped off.
+*/
+
+static void swindow_dump_line(	struct swindow_dump *dump,
+								const char *plain,
+								const chtype *text,
+								size_t len)
+{
+	while (len > 0) {
+		size_t n;
+		size_t copied;
+
+		if (dump->len == SWINDOW_DUMP_BUF && swindow_dump_flush(dump) != 0)
+			return;
+
+		n = min(len, SWINDOW_DUMP_BUF - dump->len);
+
+		if (plain != NULL) {
+			char *end = memccpy(dump->buf + dump->len, plain, '\0', n);
+
+			copied = (end != NULL) ? (size_t) (end - (dump->buf + dump->len)) - 1 : n;
+			plain += n;
+		} else {
+			copied = cstr_copy_plaintext(dump->buf + dump->len, text, n);
+			text += n;
+		}
+
+		dump->len += copied;
+		if (copied < n)
+			break;
+
+		len -= n;
+	}
+
+	if (dump->len == SWINDOW_DUMP_BUF && swindow_dump_flush(dump) != 0)
+		return;
+
+	dump->buf[dump->len++] = '\n';
+}
+
+/*
+** Write the window's history, including whatever's been spilled to
+** disk, to "file" as plain text. Messages that have a plain text copy
+** are written from it, so that compressed text doesn't have to be
+** decompressed.
+*/
+
 int swindow_dump_buffer(struct swindow *swindow, char *file) {
-  int fd;
-	dlist_t *cur;
-	struct iovec wvec[2];
+	struct swindow_dump dump;
+	struct imsg *imsg;
 
-	if (swindow->scrollbuf_end == NULL)
+	if (ilist_empty(&swindow->scrollbuf))
 		return (-1);
 
-	fd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0600);
-	if (fd == -1)
+	dump.fd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0600);
+	if (dump.fd == -1) {
+		screen_err_msg("Unable to open %s for writing: %s",
+			file, strerror(errno));
 		return (-1);
+	}
 
-	wvec[1].iov_base = "\n";
-	wvec[1].iov_len = 1;
-
-	for (cur = swindow->scrollbuf_end ; cur != NULL ; cur = cur->prev) {
-		struct imsg *imsg = cur->data;
+	dump.err = 0;
+	dump.len = 0;
+	dump.buf = xmalloc(SWINDOW_DUMP_BUF);
 
-		wvec[0].iov_base = cstr_to_plaintext(imsg->text, imsg->len);
-		wvec[0].iov_len = imsg->len;
+	if (swindow->spill != NULL) {
+		struct spill *spill = swindow->spill;
+		struct spill_rec *rec;
 
-		if (writev(fd, wvec, 2) != (int) imsg->len + 1) {
-			screen_err_msg("Error writing buffer to %s: %s",
-				file, strerror(errno));
+		for (rec = spill_first(spill) ; rec != NULL && dump.err == 0 ;
+			rec = spill_next(spill, rec))
+		{
+			swindow_dump_line(&dump, NULL, spill_rec_text(rec), rec->len);
 		}
 
-		free(wvec[0].iov_base);
+		spill_done(spill);
+	}
+
+	ilist_foreach_reverse(imsg, &swindow->scrollbuf, link) {
+		if (dump.err != 0)
+			break;
+
+		if (imsg->plain != NULL)
+			swindow_dump_line(&dump, imsg->plain, NULL, imsg->len);
+		else
+			swindow_dump_line(&dump, NULL, imsg_text(imsg), imsg->len);
+	}
+
+	swindow_dump_flush(&dump);
+	free(dump.buf);
+	close(dump.fd);
+
+	if (dump.err != 0) {
+		screen_err_msg("Error writing buffer to %s: %s",
+			file, strerror(dump.err));
+		return (-1);
 	}
 
-	close(fd);
 	return (0);
 }
 
@@ -833,38 +1904,167 @@ void swindow_set_logfile(struct swindow *swindow, char *logfile) {
 	}
 }
 
+/*
+** Fill the window with up to "max_lines" of the last messages in its
+** log file. The file is mapped and read backwards from the end, so only
+** the part that's needed is read, however big the log is. Returns the
+** number of messages that were restored.
+**
+** Only an empty window is filled. The restored lines are older than
+** anything already in the window, so they'd end up below it otherwise.
+*/
+
+size_t swindow_restore(struct swindow *swindow, uint32_t max_lines) {
+	struct log_line *lines;
+	struct imsg **imsgs;
+	struct stat st;
+	char *map;
+	size_t found;
+	size_t i;
+	int fd;
+
+	if (swindow->logfile == NULL || !ilist_empty(&swindow->scrollbuf))
+		return (0);
+
+	max_lines = min(max_lines, swindow->scrollbuf_max);
+	if (max_lines == 0)
+		return (0);
+
+	fd = open(swindow->logfile, O_RDONLY);
+	if (fd == -1)
+		return (0);
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return (0);
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		debug("mmap %s: %s", swindow->logfile, strerror(errno));
+		return (0);
+	}
+
+	lines = xmalloc(sizeof(*lines) * max_lines);
+
+	if (st.st_size >= BLOG_MAGIC_LEN &&
+		!memcmp(map, BLOG_MAGIC, BLOG_MAGIC_LEN))
+	{
+		found = blog_tail(map, st.st_size, lines, max_lines);
+	} else
+		found = log_tail(map, st.st_size, lines, max_lines);
+
+	imsgs = xmalloc(sizeof(*imsgs) * max(found, 1));
+	for (i = 0 ; i < found ; i++) {
+		const struct log_line *line = &lines[max_lines - found + i];
+
+		imsgs[i] = imsg_new_plain(swindow, line->text, line->len);
+	}
+
+	munmap(map, st.st_size);
+	free(lines);
+
+	swindow_add_bulk(swindow, imsgs, found);
+	free(imsgs);
+
+	return (found);
+}
+
+static size_t swindow_log_banner(const char *what, time_t when,
+	char *buf, size_t len)
+{
+	char stamp[64];
+	int ret;
+
+	strftime(stamp, sizeof(stamp), "%a %b %d %T %Z %Y", localtime(&when));
+	ret = snprintf(buf, len, "\n---------- Log %s on %s ----------\n\n",
+		what, stamp);
+
+	if (ret < 0)
+		return (0);
+
+	return (min((size_t) ret, len - 1));
+}
+
+/*
+** Rotate the window's text log, ending the old file and starting the
+** new one with the usual banners.
+*/
+
+static void swindow_rotate_log(struct swindow *swindow, time_t now) {
+	char path[PATH_MAX];
+	char timebuf[128];
+	struct iovec wvec;
+	size_t len;
+
+	if (log_rotate_path(swindow->log, now, path, sizeof(path)) != 0)
+		return;
+
+	wvec.iov_base = timebuf;
+	wvec.iov_len = swindow_log_banner("ended", now, timebuf, sizeof(timebuf));
+	log_writev(swindow->log, &wvec, 1);
+
+	len = swindow_log_banner("started", now, timebuf, sizeof(timebuf));
+	log_rotate(swindow->log, path, timebuf, len, now);
+}
+
 /*
 ** Turn logging for this window on, and open the logfile for writing.
 */
 
 int swindow_set_log(struct swindow *swindow) {
-	int fd;
-	time_t cur_time;
-	struct tm *tm;
+	struct log *log;
 	char timebuf[128];
-	uint32_t len;
+	struct iovec wvec;
 
 	if (swindow->logfile == NULL) {
 		screen_err_msg("No logfile has been specified for this window");
 		return (-1);
 	}
 
-	fd = open(swindow->logfile, O_CREAT | O_APPEND | O_WRONLY, 0600);
-	if (fd == -1) {
+	/* Restore history from earlier sessions before the log is reopened. */
+	if (!swindow->restored) {
+		swindow->restored = 1;
+
+		if (opt_get_int(OPT_SCROLLBUF_RESTORE) > 0)
+			swindow_restore(swindow, opt_get_int(OPT_SCROLLBUF_RESTORE));
+	}
+
+	/* Never append text to a binary log. */
+	if (!strcasecmp(opt_get_str(OPT_LOG_FORMAT), "binary") ||
+		blog_is_blog(swindow->logfile))
+	{
+		swindow->blog = blog_open(swindow->logfile);
+		if (swindow->blog == NULL) {
+			swindow->logged = 0;
+			if (errno == EINVAL) {
+				screen_err_msg("%s is not a binary log", swindow->logfile);
+			} else {
+				screen_err_msg("Unable to open %s for writing: %s",
+					swindow->logfile, strerror(errno));
+			}
+			return (-1);
+		}
+
+		swindow->logged = 1;
+		return (0);
+	}
+
+	log = log_open(swindow->logfile, 0);
+	if (log == NULL) {
 		swindow->logged = 0;
 		screen_err_msg("Unable to open %s for writing: %s",
 			swindow->logfile, strerror(errno));
 		return (-1);
 	}
 
-	cur_time = time(NULL);
-	tm = localtime(&cur_time);
-
-	len = strftime(timebuf, sizeof(timebuf),
-		"\n---------- Log started on %a %b %d %T %Z %Y ----------\n\n", tm);
-	write(fd, timebuf, len);
+	wvec.iov_base = timebuf;
+	wvec.iov_len = swindow_log_banner("started", time(NULL),
+		timebuf, sizeof(timebuf));
+	log_writev(log, &wvec, 1);
 
-	swindow->log_fd = fd;
+	swindow->log = log;
 	swindow->logged = 1;
 
 	return (0);
@@ -875,22 +2075,26 @@ int swindow_set_log(struct swindow *swindow) {
 */
 
 void swindow_end_log(struct swindow *swindow) {
-	time_t cur_time;
-	struct tm *tm;
 	char timebuf[128];
-	uint32_t len;
+	struct iovec wvec;
 
-	if (swindow->log_fd == -1)
+	if (swindow->blog != NULL) {
+		blog_close(swindow->blog);
+		swindow->blog = NULL;
+		swindow->logged = 0;
 		return;
+	}
 
-	cur_time = time(NULL);
-	tm = localtime(&cur_time);
+	if (swindow->log == NULL)
+		return;
 
-	len = strftime(timebuf, sizeof(timebuf),
-		"\n---------- Log ended on %a %b %d %T %Z %Y ----------\n\n", tm);
-	write(swindow->log_fd, timebuf, len);
+	wvec.iov_base = timebuf;
+	wvec.iov_len = swindow_log_banner("ended", time(NULL),
+		timebuf, sizeof(timebuf));
+	log_writev(swindow->log, &wvec, 1);
 
-	close(swindow->log_fd);
+	log_close(swindow->log);
+	swindow->log = NULL;
 	swindow->logged = 0;
 }
 
@@ -905,13 +2109,12 @@ void swindow_end_log(struct swindow *swindow) {
 void swindow_clear(struct swindow *swindow) {
 	struct imsg *imsg;
 
-	if (swindow->scrollbuf == NULL)
+	imsg = ilist_first(&swindow->scrollbuf);
+	if (imsg == NULL)
 		return;
 
-	imsg = swindow->scrollbuf->data;
-
-	swindow->scrollbuf_top = swindow->scrollbuf;
-	swindow->scrollbuf_bot = swindow->scrollbuf;
+	swindow->scrollbuf_top = imsg;
+	swindow->scrollbuf_bot = imsg;
 	swindow->top_hidden = imsg->lines;
 	swindow->bottom_hidden = 0;
 	swindow->held = 0;
@@ -922,14 +2125,30 @@ void swindow_clear(struct swindow *swindow) {
 }
 
 /*
-** Cleanup function for use with dlist_destroy()
+** Free all the messages in the scroll buffer.
+*/
+
+static void swindow_free(struct swindow *swindow) {
+	struct imsg *imsg;
+	struct imsg *next;
+
+	ilist_foreach_safe(imsg, next, &swindow->scrollbuf, link)
+		imsg_free(imsg);
+
+	ilist_init(&swindow->scrollbuf);
+}
+
+/*
+** Forget about any compression that's in progress.
 */
 
-static void swindow_free(void *param __notused, void *data) {
-	struct imsg *imsg = data;
+static void swindow_compress_cancel(struct swindow *swindow) {
+	if (swindow->zjob != NULL) {
+		swindow->zjob->data = NULL;
+		swindow->zjob = NULL;
+	}
 
-	free(imsg->text);
-	free(imsg);
+	swindow->zscan = NULL;
 }
 
 /*
@@ -938,22 +2157,34 @@ static void swindow_free(void *param __notused, void *data) {
 */
 
 void swindow_erase(struct swindow *swindow) {
-	dlist_destroy(swindow->scrollbuf, NULL, swindow_free);
+	swindow_compress_cancel(swindow);
+	swindow_free(swindow);
 
-	swindow->scrollbuf = NULL;
 	swindow->scrollbuf_top = NULL;
 	swindow->scrollbuf_bot = NULL;
-	swindow->scrollbuf_end = NULL;
 	swindow->top_hidden = 0;
 	swindow->bottom_hidden = 0;
 	swindow->scrollbuf_len = 0;
 	swindow->scrollbuf_lines = 0;
+	swindow_bytes -= swindow->scrollbuf_bytes;
+	swindow->scrollbuf_bytes = 0;
+	trgm_clear(swindow->trgm);
+
+	if (swindow->search != NULL) {
+		swindow->search->cur = NULL;
+		swindow->search->scan = NULL;
+		swindow->search->origin = NULL;
+		swindow->search->saved_top = NULL;
+	}
+
 	swindow->held = 0;
-	swindow->serial = 0;
 	swindow->activity = 0;
 	swindow->bottom_blank = swindow->rows;
 	swindow->dirty = 1;
 
+	if (swindow->spill != NULL)
+		spill_reset(swindow->spill);
+
 	wclear(swindow->win);
 }
 
@@ -961,7 +2192,18 @@ int swindow_destroy(struct swindow *swindow) {
 	if (swindow->logged)
 		swindow_end_log(swindow);
 
-	dlist_destroy(swindow->scrollbuf, NULL, swindow_free);
+	if (swindow->spill != NULL)
+		spill_close(swindow->spill);
+
+	swindow_compress_cancel(swindow);
+
+	swindow_free(swindow);
+	swindow_bytes -= swindow->scrollbuf_bytes;
+	trgm_free(swindow->trgm);
+
+	if (swindow->search != NULL)
+		swindow_search_free(swindow->search);
+
 	delwin(swindow->win);
 
 	return (0);
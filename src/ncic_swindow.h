@@ -14,11 +14,20 @@
 #define SWINDOW_FIND_ICASE		0x01
 #define SWINDOW_FIND_BASIC		0x02
 
+#define SWINDOW_SEARCH_OLDER	0
+#define SWINDOW_SEARCH_NEWER	1
+
 struct imsg;
+struct spill;
+struct zjob;
+struct trgm;
+struct spill_rec;
+struct swindow_search;
+struct log;
+struct blog;
 
 struct swindow {
 	WINDOW *win;
-	uint32_t serial;
 
 	uint32_t rows;
 	uint32_t cols;
@@ -26,6 +35,10 @@ struct swindow {
 	uint32_t scrollbuf_max;
 	uint32_t scrollbuf_len;
 	uint32_t scrollbuf_lines;
+	size_t scrollbuf_bytes;
+
+	/* when the window was last shown, for picking what to evict */
+	uint32_t viewed;
 
 	uint32_t held;
 	uint32_t bottom_blank;
@@ -38,24 +51,39 @@ struct swindow {
 	uint32_t top_hidden;
 	uint32_t bottom_hidden;
 
-	/* pointers to the head and tail of the message list */
-	dlist_t *scrollbuf;
-	dlist_t *scrollbuf_end;
+	/* the messages, newest first */
+	ILIST_HEAD(, imsg) scrollbuf;
 
-	/* pointers to the top and bottom lines currently displayed */
-	dlist_t *scrollbuf_top;
-	dlist_t *scrollbuf_bot;
+	/* the messages at the top and bottom of the screen */
+	struct imsg *scrollbuf_top;
+	struct imsg *scrollbuf_bot;
 
 	/* window-specific preferences */
 	uint32_t activity_type;
 	uint32_t log_type;
 
 	char *logfile;
-	int log_fd;
+	struct log *log;
+	struct blog *blog;
+
+	/* where pruned messages go, if spilling is enabled */
+	struct spill *spill;
+
+	/* the trigram index of the messages' plaintext */
+	struct trgm *trgm;
+
+	/* the incremental search in progress, if any */
+	struct swindow_search *search;
+
+	/* the run of messages being compressed, and where to look next */
+	struct zjob *zjob;
+	struct imsg *zscan;
 
 	char wordwrap_char;
 	uint32_t visible:1;
 	uint32_t dirty:1;
+	/* the window was changed while hidden and needs to be repainted */
+	uint32_t stale:1;
 	uint32_t activity:1;
 	uint32_t beep_on_output:1;
 	uint32_t scroll_on_input:1;
@@ -63,6 +91,20 @@ struct swindow {
 	uint32_t timestamp:1;
 	uint32_t logged:1;
 	uint32_t wordwrap:1;
+	/* history from the log has been restored (or there wasn't any) */
+	uint32_t restored:1;
+};
+
+/*
+** A message found by swindow_find(). "which" is the index of the
+** window it was found in.
+*/
+
+struct swindow_hit {
+	size_t which;
+	uint32_t serial;
+	struct imsg *imsg;
+	struct spill_rec *rec;
 };
 
 int swindow_init(	struct swindow *swindow,
@@ -73,8 +115,10 @@ int swindow_init(	struct swindow *swindow,
 
 int swindow_destroy(struct swindow *swindow);
 int swindow_add(struct swindow *swindow, struct imsg *imsg, uint32_t type);
+void swindow_add_bulk(struct swindow *swindow, struct imsg **imsgs, size_t n);
 int swindow_input(struct swindow *swindow);
 void swindow_redraw(struct swindow *swindow);
+void swindow_show(struct swindow *swindow);
 void swindow_clear(struct swindow *swindow);
 void swindow_erase(struct swindow *swindow);
 int swindow_refresh(struct swindow *swindow);
@@ -87,13 +131,35 @@ int swindow_print_matching(	struct swindow *swindow,
 							const char *regex,
 							uint32_t options);
 
+int swindow_find(	struct swindow **swindows,
+					size_t num,
+					const char *regex,
+					uint32_t options,
+					struct swindow_hit **hits,
+					size_t *num_hits);
+
+void swindow_search_begin(struct swindow *swindow);
+int swindow_search_set(	struct swindow *swindow,
+						const char *pattern,
+						uint32_t options);
+void swindow_search_next(struct swindow *swindow, int dir);
+int swindow_search_run(struct swindow *swindow);
+int swindow_search_failed(struct swindow *swindow);
+void swindow_search_end(struct swindow *swindow, int restore);
+
 int swindow_dump_buffer(struct swindow *swindow, char *file);
 int swindow_set_log(struct swindow *swindow);
+size_t swindow_restore(struct swindow *swindow, uint32_t max_lines);
 void swindow_end_log(struct swindow *swindow);
 void swindow_set_logfile(struct swindow *swindow, char *logfile);
 void swindow_set_timestamp(struct swindow *swindow, uint32_t value);
 void swindow_set_wordwrap(struct swindow *swindow, uint32_t value);
 void swindow_prune(struct swindow *swindow);
+void swindow_set_spill(struct swindow *swindow, uint32_t value);
+void swindow_compress(struct swindow *swindow, time_t cutoff);
+size_t swindow_evict(struct swindow *swindow, size_t bytes);
+size_t swindow_total_bytes(void);
+uint32_t swindow_next_serial(void);
 
 void swindow_scroll_to_end(struct swindow *swindow);
 void swindow_scroll_to_start(struct swindow *swindow);
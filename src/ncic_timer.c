@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "ncic.h"
 #include "ncic_util.h"
@@ -22,115 +23,238 @@
 
 static u_int32_t last_refnum;
 
-static int timer_find_cb(void *l, void *r) {
-	char *str = l;
-	struct timer_entry *timer = r;
+static u_int64_t timer_now_msec(void) {
+	struct timespec ts;
 
-	return (strcmp(str, timer->command));
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u_int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
-static int timer_find_refnum_cb(void *l, void *r) {
+static int timer_refnum_compare(void *l, void *r) {
 	u_int32_t refnum = POINTER_TO_UINT(l);
 	struct timer_entry *timer = r;
 
-	return (refnum - timer->refnum);
+	return (refnum != timer->refnum);
 }
 
-static void timer_destroy_cb(void *param __notused, void *data) {
-	struct timer_entry *timer = data;
-
+static void timer_free(struct timer_entry *timer) {
 	free(timer->command);
 	free(timer);
 }
 
-u_int32_t timer_add(dlist_t **timer_list,
+static inline void timer_heap_set(	struct timer_list *timer_list,
+									u_int32_t slot,
+									struct timer_entry *timer)
+{
+	timer_list->heap[slot] = timer;
+	timer->slot = slot;
+}
+
+static void timer_heap_up(struct timer_list *timer_list, u_int32_t slot) {
+	struct timer_entry *timer = timer_list->heap[slot];
+
+	while (slot > 0) {
+		u_int32_t parent = (slot - 1) / 2;
+
+		if (timer_list->heap[parent]->expires <= timer->expires)
+			break;
+
+		timer_heap_set(timer_list, slot, timer_list->heap[parent]);
+		slot = parent;
+	}
+
+	timer_heap_set(timer_list, slot, timer);
+}
+
+static void timer_heap_down(struct timer_list *timer_list, u_int32_t slot) {
+	struct timer_entry *timer = timer_list->heap[slot];
+
+	while (1) {
+		u_int32_t child = slot * 2 + 1;
+
+		if (child >= timer_list->num)
+			break;
+
+		if (child + 1 < timer_list->num &&
+			timer_list->heap[child + 1]->expires <
+			timer_list->heap[child]->expires)
+		{
+			child++;
+		}
+
+		if (timer->expires <= timer_list->heap[child]->expires)
+			break;
+
+		timer_heap_set(timer_list, slot, timer_list->heap[child]);
+		slot = child;
+	}
+
+	timer_heap_set(timer_list, slot, timer);
+}
+
+static void timer_heap_add(	struct timer_list *timer_list,
+							struct timer_entry *timer)
+{
+	if (timer_list->num == timer_list->size) {
+		timer_list->size = max(timer_list->size * 2, 16);
+		timer_list->heap = xrealloc(timer_list->heap,
+			timer_list->size * sizeof(*timer_list->heap));
+	}
+
+	timer_heap_set(timer_list, timer_list->num++, timer);
+	timer_heap_up(timer_list, timer->slot);
+}
+
+static void timer_heap_remove(	struct timer_list *timer_list,
+								struct timer_entry *timer)
+{
+	struct timer_entry *last;
+
+	last = timer_list->heap[--timer_list->num];
+	if (last == timer)
+		return;
+
+	timer_heap_set(timer_list, timer->slot, last);
+	timer_heap_up(timer_list, last->slot);
+	timer_heap_down(timer_list, last->slot);
+}
+
+static void timer_remove(	struct timer_list *timer_list,
+							struct timer_entry *timer)
+{
+	timer_heap_remove(timer_list, timer);
+	hash_remove(&timer_list->refnums, UINT_TO_POINTER(timer->refnum));
+}
+
+void timer_init(struct timer_list *timer_list) {
+	memset(timer_list, 0, sizeof(*timer_list));
+	hash_init(&timer_list->refnums, 3, int_hash, timer_refnum_compare, NULL);
+}
+
+/*
+** Add a timer to run "command" every "interval" milliseconds, "times"
+** times, or forever if "times" is 0.
+*/
+
+u_int32_t timer_add(struct timer_list *timer_list,
 					char *command,
-					time_t interval,
+					u_int32_t interval,
 					u_int32_t times)
 {
 	struct timer_entry *timer = xcalloc(1, sizeof(*timer));
 
-	timer->last_run = time(NULL);
 	timer->command = xstrdup(command);
 	timer->refnum = last_refnum++;
-	timer->interval = interval;
+	timer->interval = max(interval, TIMER_MIN_INTERVAL);
+	timer->expires = timer_now_msec() + timer->interval;
 	timer->times = times;
 
-	*timer_list = dlist_add_head(*timer_list, timer);
+	timer_heap_add(timer_list, timer);
+	hash_add(&timer_list->refnums, UINT_TO_POINTER(timer->refnum), timer);
 
 	return (timer->refnum);
 }
 
-int timer_del(dlist_t **timer_list, char *command) {
-	dlist_t *node;
-	struct timer_entry *timer;
-
-	node = dlist_find(*timer_list, command, timer_find_cb);
-	if (node == NULL)
-		return (-1);
+int timer_del(struct timer_list *timer_list, char *command) {
+	u_int32_t i;
 
-	timer = node->data;
+	for (i = 0 ; i < timer_list->num ; i++) {
+		struct timer_entry *timer = timer_list->heap[i];
 
-	*timer_list = dlist_remove(*timer_list, node);
+		if (!strcmp(command, timer->command)) {
+			timer_remove(timer_list, timer);
+			timer_free(timer);
+			return (0);
+		}
+	}
 
-	free(timer->command);
-	free(timer);
-	return (0);
+	return (-1);
 }
 
-int timer_del_refnum(dlist_t **timer_list, u_int32_t refnum) {
-	dlist_t *node;
+int timer_del_refnum(struct timer_list *timer_list, u_int32_t refnum) {
 	struct timer_entry *timer;
 
-	node = dlist_find(*timer_list, UINT_TO_POINTER(refnum),
-				timer_find_refnum_cb);
-	if (node == NULL)
+	timer = hash_find(&timer_list->refnums, UINT_TO_POINTER(refnum));
+	if (timer == NULL)
 		return (-1);
 
-	timer = node->data;
-
-	*timer_list = dlist_remove(*timer_list, node);
-
-	free(timer->command);
-	free(timer);
-
+	timer_remove(timer_list, timer);
+	timer_free(timer);
 	return (0);
 }
 
-int timer_run(dlist_t **timer_list) {
-	dlist_t *cur = *timer_list;
+/*
+** Run every timer that's due. A timer is rescheduled, or taken out
+** if that was its last run, before its command runs, so the command
+** is free to add and delete timers, itself included.
+*/
+
+int timer_run(struct timer_list *timer_list) {
+	u_int64_t now = timer_now_msec();
 	int triggered = 0;
 
-	while (cur != NULL) {
-		dlist_t *next = cur->next;
-		struct timer_entry *timer = cur->data;
+	while (timer_list->num > 0 && timer_list->heap[0]->expires <= now) {
+		struct timer_entry *timer = timer_list->heap[0];
+		char *command = xstrdup(timer->command);
 
-		if (timer->last_run + timer->interval <= time(NULL)) {
-			char *command = xstrdup(timer->command);
+		triggered++;
 
-			triggered++;
+		if (timer->times != 1) {
+			/* Keep to the schedule, unless it's fallen behind. */
+			timer->expires += timer->interval;
+			if (timer->expires <= now)
+				timer->expires = now + timer->interval;
 
-			run_mcommand(command);
-			free(command);
+			if (timer->times > 1)
+				timer->times--;
 
-			if (timer->times != 1) {
-				time(&timer->last_run);
-				if (timer->times > 1)
-					timer->times--;
-			} else {
-				*timer_list = dlist_remove(*timer_list, cur);
-				free(timer->command);
-				free(timer);
-			}
+			timer_heap_down(timer_list, 0);
+		} else {
+			timer_remove(timer_list, timer);
+			timer_free(timer);
 		}
 
-		cur = next;
+		run_mcommand(command);
+		free(command);
 	}
 
 	return (triggered);
 }
 
-void timer_destroy(dlist_t **timer_list) {
-	dlist_destroy(*timer_list, NULL, timer_destroy_cb);
-	*timer_list = NULL;
+/*
+** Shorten the I/O timeout so that the main loop wakes up
+** when the next timer is due.
+*/
+
+void timer_wait(struct timer_list *timer_list, struct timeval *tv) {
+	u_int64_t now;
+	u_int64_t delay;
+
+	if (timer_list->num == 0)
+		return;
+
+	now = timer_now_msec();
+	if (timer_list->heap[0]->expires <= now)
+		delay = 0;
+	else
+		delay = timer_list->heap[0]->expires - now;
+
+	if (delay * 1000 < (u_int64_t) tv->tv_sec * 1000000 + tv->tv_usec) {
+		tv->tv_sec = delay / 1000;
+		tv->tv_usec = (delay % 1000) * 1000;
+	}
+}
+
+/*
+** Delete every timer.
+*/
+
+void timer_destroy(struct timer_list *timer_list) {
+	u_int32_t i;
+
+	for (i = 0 ; i < timer_list->num ; i++)
+		timer_free(timer_list->heap[i]);
+
+	timer_list->num = 0;
+	hash_clear(&timer_list->refnums);
 }
@@ -11,21 +11,43 @@
 #ifndef __NCIC_TIMER_H__
 #define __NCIC_TIMER_H__
 
+#include <sys/time.h>
+
+/*
+** Timers are kept in a binary min-heap ordered by when they're next
+** due, on the monotonic clock, with a hash of them by refnum so they
+** can be deleted without searching.
+*/
+
+#define TIMER_MIN_INTERVAL	10
+
 struct timer_entry {
 	char *command;
 	u_int32_t refnum;
-	time_t interval;
-	time_t last_run;
+	/* in milliseconds */
+	u_int32_t interval;
+	u_int64_t expires;
 	u_int32_t times;
+	/* where it is in the heap */
+	u_int32_t slot;
+};
+
+struct timer_list {
+	struct timer_entry **heap;
+	u_int32_t num;
+	u_int32_t size;
+	hash_t refnums;
 };
 
-int timer_run(dlist_t **timer_list);
-void timer_destroy(dlist_t **timer_list);
-int timer_del_refnum(dlist_t **timer_list, u_int32_t refnum);
-int timer_del(dlist_t **timer_list, char *command);
-u_int32_t timer_add(dlist_t **timer_list,
+void timer_init(struct timer_list *timer_list);
+int timer_run(struct timer_list *timer_list);
+void timer_wait(struct timer_list *timer_list, struct timeval *tv);
+void timer_destroy(struct timer_list *timer_list);
+int timer_del_refnum(struct timer_list *timer_list, u_int32_t refnum);
+int timer_del(struct timer_list *timer_list, char *command);
+u_int32_t timer_add(struct timer_list *timer_list,
 					char *command,
-					time_t interval,
+					u_int32_t interval,
 					u_int32_t count);
 
 #endif /* __NCIC_TIMER_H__ */
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_trgm.h"
+
+#define TRGM_MIN_ORDER		10
+
+static inline uint32_t trgm_fold(char c) {
+	if (c >= 'A' && c <= 'Z')
+		c += 'a' - 'A';
+
+	return ((unsigned char) c);
+}
+
+static inline uint32_t trgm_key(const char *p) {
+	return ((trgm_fold(p[0]) << 16) | (trgm_fold(p[1]) << 8) | trgm_fold(p[2]));
+}
+
+static inline uint32_t trgm_hash(struct trgm *trgm, uint32_t key) {
+	return ((key * 2654435761U) >> (32 - trgm->order));
+}
+
+/*
+** Find the lowest position in "v" whose serial isn't less than "serial".
+** Returns non-zero if it's there.
+*/
+
+static int trgm_search(const uint32_t *v, uint32_t n, uint32_t serial, uint32_t *pos) {
+	uint32_t lo = 0;
+	uint32_t hi = n;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (v[mid] < serial)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*pos = lo;
+	return (lo < n && v[lo] == serial);
+}
+
+static struct trgm_post *trgm_lookup(struct trgm *trgm, uint32_t key, int create) {
+	uint32_t mask = (1 << trgm->order) - 1;
+	uint32_t i = trgm_hash(trgm, key);
+
+	for (;;) {
+		struct trgm_post *post = &trgm->table[i];
+
+		if (post->key == key)
+			return (post);
+
+		if (post->key == 0) {
+			if (!create)
+				return (NULL);
+
+			post->key = key;
+			trgm->used++;
+			return (post);
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+** Rebuild the table, large enough to be at most half full,
+** dropping the trigrams that no longer appear in any message.
+*/
+
+static void trgm_rehash(struct trgm *trgm) {
+	struct trgm_post *old = trgm->table;
+	uint32_t old_size = 1 << trgm->order;
+	uint32_t live = 0;
+	uint32_t i;
+
+	for (i = 0 ; i < old_size ; i++) {
+		if (old[i].len > 0)
+			live++;
+	}
+
+	trgm->order = TRGM_MIN_ORDER;
+	while ((1U << trgm->order) < live * 2 + 2)
+		trgm->order++;
+
+	trgm->table = xcalloc(1 << trgm->order, sizeof(*trgm->table));
+	trgm->bytes += ((1 << trgm->order) - old_size) * sizeof(*old);
+	trgm->used = 0;
+
+	for (i = 0 ; i < old_size ; i++) {
+		struct trgm_post *post;
+
+		if (old[i].len == 0)
+			continue;
+
+		post = trgm_lookup(trgm, old[i].key, 1);
+		*post = old[i];
+	}
+
+	free(old);
+}
+
+struct trgm *trgm_new(void) {
+	struct trgm *trgm;
+
+	trgm = xcalloc(1, sizeof(*trgm));
+	trgm->order = TRGM_MIN_ORDER;
+	trgm->table = xcalloc(1 << trgm->order, sizeof(*trgm->table));
+	trgm->bytes = (1 << trgm->order) * sizeof(*trgm->table);
+
+	return (trgm);
+}
+
+void trgm_clear(struct trgm *trgm) {
+	uint32_t i;
+
+	for (i = 0 ; i < (1U << trgm->order) ; i++)
+		free(trgm->table[i].serials);
+
+	free(trgm->table);
+
+	trgm->order = TRGM_MIN_ORDER;
+	trgm->used = 0;
+	trgm->table = xcalloc(1 << trgm->order, sizeof(*trgm->table));
+	trgm->bytes = (1 << trgm->order) * sizeof(*trgm->table);
+}
+
+void trgm_free(struct trgm *trgm) {
+	uint32_t i;
+
+	for (i = 0 ; i < (1U << trgm->order) ; i++)
+		free(trgm->table[i].serials);
+
+	free(trgm->table);
+	free(trgm);
+}
+
+static void trgm_post_add(struct trgm *trgm, struct trgm_post *post, uint32_t serial) {
+	uint32_t *v;
+	uint32_t pos;
+
+	/* Messages are almost always indexed oldest first. */
+	if (post->len == 0)
+		pos = 0;
+	else {
+		uint32_t last;
+
+		v = &post->serials[post->off];
+		last = v[post->len - 1];
+
+		if (last == serial)
+			return;
+
+		if (last < serial)
+			pos = post->len;
+		else if (trgm_search(v, post->len, serial, &pos))
+			return;
+	}
+
+	if (pos == 0 && post->off > 0) {
+		post->serials[--post->off] = serial;
+		post->len++;
+		return;
+	}
+
+	if (post->off + post->len == post->size) {
+		/*
+		** Only slide the list back to the start of the array once
+		** at least half of it has been pruned from the front.
+		*/
+
+		if (post->off > 0 && post->off >= post->len) {
+			memmove(post->serials, &post->serials[post->off],
+				post->len * sizeof(uint32_t));
+			post->off = 0;
+		} else {
+			uint32_t size = post->size == 0 ? 4 : post->size * 2;
+
+			post->serials = xrealloc(post->serials, size * sizeof(uint32_t));
+			trgm->bytes += (size - post->size) * sizeof(uint32_t);
+			post->size = size;
+		}
+	}
+
+	v = &post->serials[post->off];
+	memmove(&v[pos + 1], &v[pos], (post->len - pos) * sizeof(uint32_t));
+	v[pos] = serial;
+	post->len++;
+}
+
+static void trgm_post_del(struct trgm *trgm, struct trgm_post *post, uint32_t serial) {
+	uint32_t *v;
+	uint32_t pos;
+
+	if (post->len == 0)
+		return;
+
+	v = &post->serials[post->off];
+
+	/* Messages are almost always pruned oldest first. */
+	if (v[0] == serial) {
+		post->off++;
+		post->len--;
+	} else if (trgm_search(v, post->len, serial, &pos)) {
+		memmove(&v[pos], &v[pos + 1], (post->len - pos - 1) * sizeof(uint32_t));
+		post->len--;
+	} else
+		return;
+
+	if (post->len == 0) {
+		free(post->serials);
+		trgm->bytes -= post->size * sizeof(uint32_t);
+		post->serials = NULL;
+		post->size = 0;
+		post->off = 0;
+	}
+}
+
+/*
+** Index the message with serial number "serial" whose plaintext is "text".
+*/
+
+void trgm_add(struct trgm *trgm, uint32_t serial, const char *text) {
+	for (; text[0] != '\0' && text[1] != '\0' && text[2] != '\0' ; text++) {
+		if ((trgm->used + 1) * 4 > (1U << trgm->order) * 3)
+			trgm_rehash(trgm);
+
+		trgm_post_add(trgm, trgm_lookup(trgm, trgm_key(text), 1), serial);
+	}
+}
+
+void trgm_del(struct trgm *trgm, uint32_t serial, const char *text) {
+	for (; text[0] != '\0' && text[1] != '\0' && text[2] != '\0' ; text++) {
+		struct trgm_post *post = trgm_lookup(trgm, trgm_key(text), 0);
+
+		if (post != NULL)
+			trgm_post_del(trgm, post, serial);
+	}
+}
+
+/*
+** Look up each trigram in a run of literal characters from a pattern.
+*/
+
+static void trgm_flush(	struct trgm *trgm,
+						const char *run,
+						size_t *run_len,
+						struct trgm_post **posts,
+						size_t *num,
+						int *missing)
+{
+	size_t i;
+
+	for (i = 0 ; i + 2 < *run_len ; i++) {
+		struct trgm_post *post = trgm_lookup(trgm, trgm_key(&run[i]), 0);
+
+		if (post == NULL || post->len == 0)
+			*missing = 1;
+		else
+			posts[(*num)++] = post;
+	}
+
+	*run_len = 0;
+}
+
+static int trgm_post_cmp(const void *l, const void *r) {
+	const struct trgm_post *pl = *(struct trgm_post * const *) l;
+	const struct trgm_post *pr = *(struct trgm_post * const *) r;
+
+	return ((pl->len > pr->len) - (pl->len < pr->len));
+}
+
+/*
+** Return the serials, in ascending order, of the messages that could
+** match the regular expression "regex", and store how many there are in
+** "count". Only the runs of literal characters that every match must
+** contain are used, so the expression still has to be run against each
+** of them. Returns NULL if the expression has no literal run that's
+** long enough to narrow the search (or is too hard to pick apart), in
+** which case every message has to be checked.
+*/
+
+uint32_t *trgm_candidates(	struct trgm *trgm,
+							const char *regex,
+							int extended,
+							size_t *count)
+{
+	size_t len = strlen(regex);
+	char *run = xmalloc(len + 1);
+	struct trgm_post **posts = xmalloc((len + 1) * sizeof(*posts));
+	const char *p = regex;
+	size_t run_len = 0;
+	size_t num = 0;
+	size_t i;
+	int missing = 0;
+	uint32_t *ret = NULL;
+	char c;
+
+
+	while ((c = *p++) != '\0') {
+		switch (c) {
+			case '\\':
+				c = *p++;
+				if (c == '\0' || isalnum((unsigned char) c) ||
+					strchr("<>`'", c) != NULL ||
+					(!extended && strchr("(){}|+?", c) != NULL))
+				{
+					goto out;
+				}
+
+				run[run_len++] = c;
+				break;
+
+			case '[':
+				trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+
+				if (*p == '^')
+					p++;
+				if (*p == ']')
+					p++;
+
+				while (*p != '\0' && *p != ']') {
+					if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+						char end = p[1];
+
+						for (p += 2 ; *p != '\0' ; p++) {
+							if (p[0] == end && p[1] == ']')
+								break;
+						}
+
+						if (*p == '\0')
+							goto out;
+						p += 2;
+					} else
+						p++;
+				}
+
+				if (*p == '\0')
+					goto out;
+				p++;
+				break;
+
+			case '*':
+				if (run_len > 0)
+					run_len--;
+				trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+				break;
+
+			case '?':
+			case '{':
+				if (!extended) {
+					run[run_len++] = c;
+					break;
+				}
+
+				if (run_len > 0)
+					run_len--;
+				trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+
+				if (c == '{') {
+					p = strchr(p, '}');
+					if (p == NULL)
+						goto out;
+					p++;
+				}
+				break;
+
+			case '+':
+				if (extended)
+					trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+				else
+					run[run_len++] = c;
+				break;
+
+			case '(':
+			case ')':
+			case '|':
+				if (extended)
+					goto out;
+
+				run[run_len++] = c;
+				break;
+
+			case '.':
+			case '^':
+			case '$':
+				trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+				break;
+
+			default:
+				/* Only ASCII is folded, so leave anything else to the regex. */
+				if (c & 0x80)
+					trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+				else
+					run[run_len++] = c;
+				break;
+		}
+	}
+
+	trgm_flush(trgm, run, &run_len, posts, &num, &missing);
+
+	if (missing) {
+		*count = 0;
+		ret = xmalloc(sizeof(uint32_t));
+		goto out;
+	}
+
+	if (num == 0)
+		goto out;
+
+	/* Start with the rarest trigram and check the rest against it. */
+	qsort(posts, num, sizeof(*posts), trgm_post_cmp);
+
+	ret = xmalloc(posts[0]->len * sizeof(uint32_t));
+	memcpy(ret, &posts[0]->serials[posts[0]->off], posts[0]->len * sizeof(uint32_t));
+	*count = posts[0]->len;
+
+	for (i = 1 ; i < num && *count > 0 ; i++) {
+		const uint32_t *v = &posts[i]->serials[posts[i]->off];
+		size_t kept = 0;
+		size_t j;
+
+		for (j = 0 ; j < *count ; j++) {
+			uint32_t pos;
+
+			if (trgm_search(v, posts[i]->len, ret[j], &pos))
+				ret[kept++] = ret[j];
+		}
+
+		*count = kept;
+	}
+
+out:
+	free(run);
+	free(posts);
+	return (ret);
+}
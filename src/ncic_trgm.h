@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_TRGM_H__
+#define __NCIC_TRGM_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+** A trigram index over the plaintext of a window's scroll buffer.
+** Every three-character sequence (folded to lower case) maps to the
+** sorted list of serials of the messages that contain it. A search
+** pattern's literal parts are used to narrow the messages that the
+** regular expression has to be run against.
+*/
+
+struct trgm_post {
+	uint32_t key;
+	uint32_t off;
+	uint32_t len;
+	uint32_t size;
+	uint32_t *serials;
+};
+
+struct trgm {
+	uint32_t order;
+	uint32_t used;
+	struct trgm_post *table;
+	size_t bytes;
+};
+
+struct trgm *trgm_new(void);
+void trgm_free(struct trgm *trgm);
+void trgm_clear(struct trgm *trgm);
+void trgm_add(struct trgm *trgm, uint32_t serial, const char *text);
+void trgm_del(struct trgm *trgm, uint32_t serial, const char *text);
+uint32_t *trgm_candidates(	struct trgm *trgm,
+							const char *regex,
+							int extended,
+							size_t *count);
+
+#endif /* __NCIC_TRGM_H__ */
@@ -168,24 +168,92 @@ int blank_str(const char *str) {
 	return (1);
 }
 
+#define HASH_C1		0x87c37b91114253d5ULL
+#define HASH_C2		0x4cf5ad432745937fULL
+
+static inline uint64_t rotl64(uint64_t val, int n) {
+	return ((val << n) | (val >> (64 - n)));
+}
+
+static inline uint64_t hash_word(uint64_t hash, uint64_t word) {
+	word *= HASH_C1;
+	word = rotl64(word, 31);
+	word *= HASH_C2;
+
+	hash ^= word;
+	return (rotl64(hash, 27) * 5 + 0x52dce729);
+}
+
+/* MurmurHash3's finalizer, folded to 32 bits. */
+static inline uint32_t hash_final(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	return ((uint32_t) (hash ^ (hash >> 32)));
+}
+
 /*
-** Hash by Karl Nelson <kenelson@ece.ucdavis.edu>
-**
-** See http://mail.gnome.org/archives/gtk-devel-list/2000-February/msg00057.html
-** for details.
+** Hash "len" bytes a 64 bit word at a time, after the MurmurHash3
+** block function. If "fold" is set, ASCII letters hash the same in
+** either case.
 */
 
-uint32_t string_hash(const char *str, uint32_t order) {
-	uint32_t hash = 0;
+static inline uint32_t mem_hash_words(const void *buf, size_t len, int fold) {
+	const unsigned char *p = buf;
+	uint64_t hash = len * HASH_C2;
+	uint64_t word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, p, sizeof(word));
+		if (fold)
+			word = word_tolower(word);
 
-	while (*str != '\0')
-		hash = (hash << 5) - hash + *str++;
+		hash = hash_word(hash, word);
+		p += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	if (len > 0) {
+		word = 0;
+		memcpy(&word, p, len);
+		if (fold)
+			word = word_tolower(word);
+
+		hash = hash_word(hash, word);
+	}
+
+	return (hash_final(hash));
+}
 
-	return (hash & ((1 << order) - 1));
+uint32_t mem_hash(const void *buf, size_t len) {
+	return (mem_hash_words(buf, len, 0));
 }
 
-uint32_t int_hash(int num, uint32_t order) {
-	return (num & ((1 << order) - 1));
+uint32_t mem_hash_nocase(const void *buf, size_t len) {
+	return (mem_hash_words(buf, len, 1));
+}
+
+uint32_t string_hash(const void *key) {
+	return (mem_hash_words(key, strlen(key), 0));
+}
+
+/*
+** For tables whose keys are compared with strcasecmp().
+*/
+
+uint32_t string_hash_nocase(const void *key) {
+	return (mem_hash_words(key, strlen(key), 1));
+}
+
+/*
+** For tables keyed by integers cast to pointers.
+*/
+
+uint32_t int_hash(const void *key) {
+	return ((uint32_t) (intptr_t) key);
 }
 
 int str_to_uint(const char *str, uint32_t *val) {
@@ -200,6 +268,33 @@ int str_to_uint(const char *str, uint32_t *val) {
 	return (0);
 }
 
+/*
+** Parse a time interval into milliseconds. A plain number is in
+** seconds, and may have a fractional part; "ms" or "s" may follow
+** it to say which unit it's in.
+*/
+
+int str_to_msec(const char *str, uint32_t *msec) {
+	char *end;
+	double temp;
+
+	temp = strtod(str, &end);
+	if (end == str)
+		return (-1);
+
+	if (*end == '\0' || !strcmp(end, "s"))
+		temp *= 1000;
+	else if (strcmp(end, "ms"))
+		return (-1);
+
+	/* Written this way round so "nan" is refused too. */
+	if (!(temp >= 0 && temp <= UINT32_MAX))
+		return (-1);
+
+	*msec = (uint32_t) temp;
+	return (0);
+}
+
 int str_to_int(const char *str, int *val) {
 	char *end;
 	int temp;
@@ -44,10 +44,33 @@ int expand_path(char *path, char *dest, size_t len);
 
 int blank_str(const char *str);
 
-uint32_t string_hash(const char *str, uint32_t order);
-uint32_t int_hash(int num, uint32_t order);
+uint32_t mem_hash(const void *buf, size_t len);
+uint32_t mem_hash_nocase(const void *buf, size_t len);
+uint32_t string_hash(const void *key);
+uint32_t string_hash_nocase(const void *key);
+uint32_t int_hash(const void *key);
+
+/*
+** Lowercase the ASCII letters in a word of 8 characters at once, the
+** way strcasecmp() sees them. Each byte is tested for being in 'A'..'Z'
+** with a pair of additions that can't carry into the next byte, since
+** the high bits are masked off first. Bytes with the high bit set are
+** left alone.
+*/
+
+static inline uint64_t word_tolower(uint64_t word) {
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t highs = 0x8080808080808080ULL;
+	uint64_t low7 = word & ~highs;
+	uint64_t ge_a = low7 + ones * (0x80 - 'A');
+	uint64_t gt_z = low7 + ones * (0x7f - 'Z');
+	uint64_t upper = (ge_a ^ gt_z) & ~word & highs;
+
+	return (word | (upper >> 2));
+}
 
 int str_to_uint(const char *str, uint32_t *val);
 int str_to_int(const char *str, int *val);
+int str_to_msec(const char *str, uint32_t *msec);
 
 #endif /* __NCIC_UTIL_H__ */
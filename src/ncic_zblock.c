@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <ncurses.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "ncic.h"
+#include "ncic_util.h"
+#include "ncic_list.h"
+#include "ncic_queue.h"
+#include "ncic_io.h"
+#include "ncic_imsg.h"
+#include "ncic_lz.h"
+#include "ncic_zblock.h"
+
+struct zstats zstats;
+
+/*
+** Jobs are handed to the compression thread on "pending" and handed
+** back on "finished". A byte written to the pipe wakes up the main
+** loop, which finishes them off from zblock_finished().
+*/
+
+static pthread_t zthread;
+static pthread_mutex_t zlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zcond = PTHREAD_COND_INITIALIZER;
+static pork_queue_t *pending;
+static pork_queue_t *finished;
+static int zpipe[2] = { -1, -1 };
+static int zthread_running;
+static int zthread_quit;
+
+/*
+** The most recently decompressed block is cached, so that drawing
+** or searching a run of messages from the same block only pays
+** for decompressing it once.
+*/
+
+static struct zblock *cache_block;
+static char *cache_data;
+static size_t cache_size;
+
+static void *zblock_thread(void *arg __notused) {
+	while (1) {
+		struct zjob *job = NULL;
+
+		pthread_mutex_lock(&zlock);
+		while (!zthread_quit && (job = queue_get(pending)) == NULL)
+			pthread_cond_wait(&zcond, &zlock);
+		pthread_mutex_unlock(&zlock);
+
+		if (job == NULL)
+			break;
+
+		job->zdata = xmalloc(lz_bound(job->raw_len));
+		job->zlen = lz_compress(job->raw, job->raw_len,
+						job->zdata, lz_bound(job->raw_len));
+
+		pthread_mutex_lock(&zlock);
+		queue_add(finished, job);
+		pthread_mutex_unlock(&zlock);
+
+		if (write(zpipe[1], "", 1) == -1 && errno != EAGAIN)
+			debug("write: %s", strerror(errno));
+	}
+
+	return (NULL);
+}
+
+static void zblock_finished(int fd, u_int32_t cond __notused,
+							void *data __notused)
+{
+	char buf[64];
+	struct zjob *job;
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	while (1) {
+		pthread_mutex_lock(&zlock);
+		job = queue_get(finished);
+		pthread_mutex_unlock(&zlock);
+
+		if (job == NULL)
+			break;
+
+		job->done(job);
+	}
+}
+
+static int zblock_start(void) {
+	if (pipe(zpipe) != 0) {
+		debug("pipe: %s", strerror(errno));
+		return (-1);
+	}
+
+	fcntl(zpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(zpipe[1], F_SETFL, O_NONBLOCK);
+
+	pending = queue_new(0);
+	finished = queue_new(0);
+
+	if (pthread_create(&zthread, NULL, zblock_thread, NULL) != 0) {
+		debug("pthread_create failed");
+		close(zpipe[0]);
+		close(zpipe[1]);
+		queue_destroy(pending, NULL);
+		queue_destroy(finished, NULL);
+		return (-1);
+	}
+
+	pork_io_add(zpipe[0], IO_COND_READ, NULL, &zpipe, zblock_finished);
+	zthread_running = 1;
+	return (0);
+}
+
+/*
+** Queue a job for the compression thread, starting it if it's
+** not running yet. Its done() function will be called from the
+** main loop once it's been compressed.
+*/
+
+int zblock_submit(struct zjob *job) {
+	if (!zthread_running && zblock_start() != 0)
+		return (-1);
+
+	pthread_mutex_lock(&zlock);
+	queue_add(pending, job);
+	pthread_cond_signal(&zcond);
+	pthread_mutex_unlock(&zlock);
+
+	return (0);
+}
+
+void zjob_free(struct zjob *job) {
+	free(job->raw);
+	free(job->zdata);
+	free(job);
+}
+
+/*
+** Make a block out of a finished job. The block takes
+** the compressed data from the job.
+*/
+
+struct zblock *zblock_new(struct zjob *job) {
+	struct zblock *zblock;
+
+	zblock = xmalloc(sizeof(*zblock));
+	zblock->data = xrealloc(job->zdata, job->zlen);
+	zblock->len = job->zlen;
+	zblock->raw_len = job->raw_len;
+	zblock->refs = 0;
+	job->zdata = NULL;
+
+	zstats.blocks++;
+	zstats.raw_bytes += zblock->raw_len;
+	zstats.bytes += zblock->len;
+
+	return (zblock);
+}
+
+static void zblock_free(struct zblock *zblock) {
+	if (cache_block == zblock)
+		cache_block = NULL;
+
+	zstats.blocks--;
+	zstats.raw_bytes -= zblock->raw_len;
+	zstats.bytes -= zblock->len;
+
+	free(zblock->data);
+	free(zblock);
+}
+
+/*
+** Return a pointer to the uncompressed text of a message. It's only
+** good until the next call, as it points into the block cache.
+*/
+
+chtype *zblock_text(struct imsg *imsg) {
+	struct zblock *zblock = imsg->zblock;
+
+	if (cache_block != zblock) {
+		struct timeval start;
+		struct timeval end;
+		uint32_t usec;
+
+		gettimeofday(&start, NULL);
+
+		if (cache_size < zblock->raw_len) {
+			cache_data = xrealloc(cache_data, zblock->raw_len);
+			cache_size = zblock->raw_len;
+		}
+
+		if (lz_decompress(zblock->data, zblock->len,
+			cache_data, zblock->raw_len) != 0)
+		{
+			/* This can't happen unless memory is corrupt. */
+			debug("corrupt block %p", zblock);
+			memset(cache_data, 0, zblock->raw_len);
+		}
+
+		cache_block = zblock;
+
+		gettimeofday(&end, NULL);
+		usec = (end.tv_sec - start.tv_sec) * 1000000 +
+				(end.tv_usec - start.tv_usec);
+
+		zstats.thawed++;
+		zstats.thaw_usec += usec;
+		if (usec > zstats.thaw_max_usec)
+			zstats.thaw_max_usec = usec;
+	}
+
+	return ((chtype *) (cache_data + imsg->zoff * sizeof(chtype)));
+}
+
+/*
+** Drop a message's reference to the block its text is stored in.
+*/
+
+void zblock_release(struct imsg *imsg) {
+	struct zblock *zblock = imsg->zblock;
+
+	imsg->zblock = NULL;
+	if (--zblock->refs == 0)
+		zblock_free(zblock);
+}
+
+/*
+** Give a message its own uncompressed copy of its text again.
+*/
+
+void zblock_thaw(struct imsg *imsg) {
+	size_t len = (imsg->len + 1) * sizeof(chtype);
+
+	imsg->text = xmalloc(len);
+	memcpy(imsg->text, zblock_text(imsg), len);
+	zblock_release(imsg);
+}
+
+void zblock_destroy(void) {
+	if (!zthread_running)
+		return;
+
+	pthread_mutex_lock(&zlock);
+	zthread_quit = 1;
+	pthread_cond_signal(&zcond);
+	pthread_mutex_unlock(&zlock);
+
+	pthread_join(zthread, NULL);
+	zthread_running = 0;
+
+	pork_io_del(&zpipe);
+	close(zpipe[0]);
+	close(zpipe[1]);
+
+	queue_destroy(pending, (void (*)(void *)) zjob_free);
+	queue_destroy(finished, (void (*)(void *)) zjob_free);
+
+	free(cache_data);
+	cache_data = NULL;
+	cache_block = NULL;
+	cache_size = 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 Devin Smith <devin@devinsmith.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __NCIC_ZBLOCK_H__
+#define __NCIC_ZBLOCK_H__
+
+#include <time.h>
+
+struct imsg;
+
+/*
+** A run of scroll buffer messages whose text has been compressed
+** together. Each message in the run points at the block and knows
+** its offset in the uncompressed data.
+*/
+
+struct zblock {
+	void *data;
+	uint32_t len;
+	uint32_t raw_len;
+	uint32_t refs;
+};
+
+/*
+** A run of messages waiting to be compressed. The text is copied
+** into "raw" before the job is handed to the compression thread,
+** so the thread never touches the scroll buffer itself.
+*/
+
+struct zjob {
+	/* the owner of the messages, or NULL if the job was cancelled */
+	void *data;
+	void (*done)(struct zjob *job);
+
+	struct imsg *first;
+	uint32_t count;
+	uint32_t first_serial;
+	uint32_t last_serial;
+	time_t started;
+
+	char *raw;
+	size_t raw_len;
+	void *zdata;
+	size_t zlen;
+};
+
+struct zstats {
+	uint32_t blocks;
+	uint64_t raw_bytes;
+	uint64_t bytes;
+	uint32_t thawed;
+	uint64_t thaw_usec;
+	uint32_t thaw_max_usec;
+};
+
+extern struct zstats zstats;
+
+int zblock_submit(struct zjob *job);
+void zjob_free(struct zjob *job);
+struct zblock *zblock_new(struct zjob *job);
+chtype *zblock_text(struct imsg *imsg);
+void zblock_thaw(struct imsg *imsg);
+void zblock_release(struct imsg *imsg);
+void zblock_destroy(void);
+
+#endif /* __NCIC_ZBLOCK_H__ */